@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <analysis/band_set.hpp>
+
+namespace brainviz::analysis
+{
+    // reasons a frame was flagged, combined into a per frame bit mask
+    enum class ArtifactFlag : std::uint8_t
+    {
+        None = 0,
+        Amplitude = 1 << 0, // a sample strays too far from the window mean (blinks, electrode pops)
+        Kurtosis = 1 << 1, // heavy tailed window, a short transient on an otherwise quiet channel
+        Muscle = 1 << 2 // too much of the band power sits at EMG frequencies
+    };
+
+    [[nodiscard]] constexpr bool has_artifact_flag(const std::uint8_t mask, const ArtifactFlag flag)
+    {
+        return (mask & static_cast<std::uint8_t>(flag)) != 0;
+    }
+
+    struct ArtifactOptions
+    {
+        double amplitude_threshold = 100.0; // max |sample - window mean|, recording units (uV), 0 disables
+        double kurtosis_threshold = 5.0; // excess kurtosis of the window, 0 disables
+        double muscle_ratio_threshold = 0.5; // share of the band power in bands starting at muscle_min_freq, 0 disables
+        double muscle_min_freq = 30.0;
+    };
+
+    /**
+     * @brief Flags frames that hold blinks, pops or muscle bursts
+     *
+     * Meant to run right after a run of frames has been analyzed. Amplitude and kurtosis come from the frames' raw
+     * samples: the signal is summed once into blocks of gcd(window, hop) samples and every frame merges the blocks
+     * it covers, so overlapping frames dont re-read their samples. The muscle ratio comes from the band amplitudes
+     * that were just stored, so no extra transform is needed; it only sees bands that start at muscle_min_freq.
+     */
+    class ArtifactDetector
+    {
+    public:
+        ArtifactDetector() = default;
+
+        ArtifactDetector(const BandSet& bands, ArtifactOptions options);
+
+        [[nodiscard]] const ArtifactOptions& get_options() const
+        {
+            return m_options;
+        }
+
+        // amplitude and kurtosis bits of consecutive frames, frame f covers [f * hop, f * hop + window) of samples
+        void classify_samples(
+            std::span<const double> samples,
+            size_t window_size,
+            size_t hop_size,
+            std::span<std::uint8_t> flags) const;
+
+        // muscle bit of one frame from its band amplitudes
+        [[nodiscard]] std::uint8_t classify_bands(std::span<const double> band_amplitudes) const;
+
+    private:
+        ArtifactOptions m_options;
+
+        // bands counted as EMG for the muscle ratio
+        std::vector<bool> m_muscle_bands;
+    };
+} // namespace brainviz::analysis
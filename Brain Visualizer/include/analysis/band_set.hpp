@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <data/interface.hpp>
+
+namespace brainviz::analysis
+{
+    struct BandDefinition
+    {
+        std::string name;
+        double min_freq; // Hz, inclusive
+        double max_freq; // Hz, inclusive
+    };
+
+    /**
+     * @brief Ordered list of frequency bands the analyzers reduce spectra into
+     *
+     * Any number of bands is allowed and they may overlap (e.g. mu inside alpha). The five classic bands are
+     * available through standard(), in FrequencyBand order, and any set that keeps their names can still be
+     * queried through the FrequencyBand overloads.
+     */
+    class BandSet
+    {
+    public:
+        BandSet() = default;
+
+        explicit BandSet(std::vector<BandDefinition> bands);
+
+        // delta, theta, alpha, beta, gamma with the ranges from data::FrequencyRange
+        [[nodiscard]] static BandSet standard();
+
+        // append a band, returns its index
+        size_t add(std::string_view name, double min_freq, double max_freq);
+
+        [[nodiscard]] size_t size() const
+        {
+            return m_bands.size();
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return m_bands.empty();
+        }
+
+        [[nodiscard]] const BandDefinition& operator[](const size_t index) const
+        {
+            return m_bands[index];
+        }
+
+        [[nodiscard]] auto begin() const
+        {
+            return m_bands.begin();
+        }
+
+        [[nodiscard]] auto end() const
+        {
+            return m_bands.end();
+        }
+
+        [[nodiscard]] std::optional<size_t> find(std::string_view name) const;
+
+        // index of each FrequencyBand in this set, if the set has a band with that name
+        [[nodiscard]] std::array<std::optional<size_t>, 5> standard_indices() const;
+
+        [[nodiscard]] static std::string_view standard_name(data::FrequencyBand band);
+
+    private:
+        std::vector<BandDefinition> m_bands;
+    };
+
+    /**
+     * @brief Bin edges of every band of a set for one (sample rate, window size)
+     *
+     * Built once when the analyzer is configured. reduce() then walks the power spectrum a single time,
+     * keeping a running prefix sum and reading each band off as the difference of the sums at its edges,
+     * so the cost is O(bins + bands) no matter how many bands overlap.
+     */
+    class BandBinTable
+    {
+    public:
+        BandBinTable() = default;
+
+        BandBinTable(const BandSet& bands, double sampling_rate, size_t window_size);
+
+        [[nodiscard]] size_t get_band_count() const
+        {
+            return m_first_bin.size();
+        }
+
+        // one-sided spectrum length the table was built for
+        [[nodiscard]] size_t get_bin_count() const
+        {
+            return m_bin_count;
+        }
+
+        [[nodiscard]] bool is_band_empty(const size_t band) const
+        {
+            return m_first_bin[band] > m_last_bin[band];
+        }
+
+        [[nodiscard]] size_t first_bin(const size_t band) const
+        {
+            return m_first_bin[band];
+        }
+
+        [[nodiscard]] size_t last_bin(const size_t band) const
+        {
+            return m_last_bin[band];
+        }
+
+        // amplitudes[b] = sqrt(sum of power over band b's bins)
+        void reduce(std::span<const double> power_spectrum, std::span<double> amplitudes) const;
+
+    private:
+        size_t m_bin_count = 0;
+        std::vector<size_t> m_first_bin;
+        std::vector<size_t> m_last_bin;
+
+        // prefix sum positions at which some band starts or ends, sorted by position
+        struct Edge
+        {
+            size_t position; // prefix index, sum of bins [0, position)
+            size_t band;
+            double sign; // -1 at the start of a band, +1 one past its end
+        };
+
+        std::vector<Edge> m_edges;
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace brainviz::analysis
+{
+    // index of a channel in an analyzer's results, stays valid for the lifetime of the analyzer
+    using ChannelHandle = size_t;
+
+    // non-owning view over every stride-th element of a buffer, e.g. one band of a channel across frames
+    template <typename T>
+    class StridedSpan
+    {
+    public:
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::remove_cv_t<T>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T*;
+            using reference = T&;
+
+            iterator() = default;
+
+            iterator(T* ptr, const size_t stride)
+                : m_ptr(ptr), m_stride(stride)
+            {
+            }
+
+            reference operator*() const
+            {
+                return *m_ptr;
+            }
+
+            iterator& operator++()
+            {
+                m_ptr += m_stride;
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                iterator previous = *this;
+                m_ptr += m_stride;
+                return previous;
+            }
+
+            bool operator==(const iterator& other) const
+            {
+                return m_ptr == other.m_ptr;
+            }
+
+        private:
+            T* m_ptr = nullptr;
+            size_t m_stride = 1;
+        };
+
+        StridedSpan() = default;
+
+        StridedSpan(T* data, const size_t size, const size_t stride)
+            : m_data(data), m_size(size), m_stride(stride)
+        {
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return m_size;
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        [[nodiscard]] size_t stride() const
+        {
+            return m_stride;
+        }
+
+        [[nodiscard]] T& operator[](const size_t index) const
+        {
+            return m_data[index * m_stride];
+        }
+
+        [[nodiscard]] T& front() const
+        {
+            return m_data[0];
+        }
+
+        [[nodiscard]] T& back() const
+        {
+            return m_data[(m_size - 1) * m_stride];
+        }
+
+        [[nodiscard]] iterator begin() const
+        {
+            return iterator(m_data, m_stride);
+        }
+
+        [[nodiscard]] iterator end() const
+        {
+            return iterator(m_data + m_size * m_stride, m_stride);
+        }
+
+    private:
+        T* m_data = nullptr;
+        size_t m_size = 0;
+        size_t m_stride = 1;
+    };
+
+    /**
+     * @brief Band amplitudes of every channel in one contiguous [channel][frame][band] buffer
+     *
+     * Each channel owns a block of frame_capacity frames, so a frame's bands are adjacent and a channel's
+     * frames follow each other. Reading every band of one frame is a single span, one band over time is a
+     * stride of band_count, and the same (frame, band) across all channels is a stride of one channel block.
+     * Channels can hold different numbers of frames (a streaming channel may be a block behind the others);
+     * the capacity grows for all channels at once when one of them outgrows it.
+     *
+     * Accessors dont bounds check, the analyzers validate handles and indices before reading.
+     */
+    class BandTensor
+    {
+    public:
+        BandTensor() = default;
+
+        explicit BandTensor(size_t band_count, size_t frame_capacity = 0);
+
+        // add an empty channel, returns its handle
+        ChannelHandle add_channel();
+
+        [[nodiscard]] size_t get_channel_count() const
+        {
+            return m_frame_counts.size();
+        }
+
+        [[nodiscard]] size_t get_band_count() const
+        {
+            return m_band_count;
+        }
+
+        [[nodiscard]] size_t get_frame_capacity() const
+        {
+            return m_frame_capacity;
+        }
+
+        [[nodiscard]] size_t get_frame_count(const ChannelHandle channel) const
+        {
+            return m_frame_counts[channel];
+        }
+
+        // grow every channel block to hold at least this many frames
+        void reserve_frames(size_t frames);
+
+        // set the number of frames of a channel, frames past the old count are zeroed
+        void resize_frames(ChannelHandle channel, size_t frames);
+
+        // add a zeroed frame at the end of a channel and return its bands
+        std::span<double> append_frame(ChannelHandle channel);
+
+        // drop the oldest frames of a channel, the remaining frames move to the front of its block
+        void drop_front(ChannelHandle channel, size_t frames);
+
+        // every band of one frame
+        [[nodiscard]] std::span<double> frame(const ChannelHandle channel, const size_t frame)
+        {
+            return {m_data.data() + offset(channel, frame), m_band_count};
+        }
+
+        [[nodiscard]] std::span<const double> frame(const ChannelHandle channel, const size_t frame) const
+        {
+            return {m_data.data() + offset(channel, frame), m_band_count};
+        }
+
+        // one band of a channel over all of its frames
+        [[nodiscard]] StridedSpan<const double> band(const ChannelHandle channel, const size_t band) const
+        {
+            return {m_data.data() + offset(channel, 0) + band, m_frame_counts[channel], m_band_count};
+        }
+
+        // all frames of a channel, [frame][band]
+        [[nodiscard]] std::span<const double> channel(const ChannelHandle channel) const
+        {
+            return {m_data.data() + offset(channel, 0), m_frame_counts[channel] * m_band_count};
+        }
+
+        // one (frame, band) for every channel, only meaningful if every channel has that frame
+        [[nodiscard]] StridedSpan<const double> across_channels(const size_t frame, const size_t band) const
+        {
+            return {m_data.data() + offset(0, frame) + band, get_channel_count(), m_frame_capacity * m_band_count};
+        }
+
+    private:
+        size_t m_band_count = 0;
+        size_t m_frame_capacity = 0;
+        std::vector<size_t> m_frame_counts;
+        std::vector<double> m_data;
+
+        [[nodiscard]] size_t offset(const ChannelHandle channel, const size_t frame) const
+        {
+            return (channel * m_frame_capacity + frame) * m_band_count;
+        }
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <analysis/band_tensor.hpp>
+
+namespace brainviz::analysis
+{
+    class FrequencyAnalyzer;
+
+    enum class BaselineMode
+    {
+        Exponential, // exponentially weighted mean and variance, time_constant_seconds
+        Window // plain mean and variance of the last window_seconds of frames
+    };
+
+    struct BaselineOptions
+    {
+        BaselineMode mode = BaselineMode::Exponential;
+        double time_constant_seconds = 30.0;
+        double window_seconds = 30.0;
+
+        // z scores in [-z_range, z_range] span the whole radius and alpha range, beyond that they clip
+        double z_range = 3.0;
+
+        // z score the log of the band amplitude, band power is closer to log normal than normal
+        bool log_amplitude = true;
+    };
+
+    /**
+     * @brief Per channel, per band z scores of an analyzer's frames against a running baseline
+     *
+     * The per frame visualization divides every band by the largest band of the same frame, so a channel whose
+     * power doubles across the board looks the same. This instead keeps a baseline mean and variance for every
+     * (channel, standard band) and scores each frame against the baseline before the frame is folded in, then
+     * maps the z score onto the same radius and alpha range. State is kept as flat [channel][band] arrays and a
+     * frame is a handful of passes over them, O(channels x bands) and vectorizable.
+     *
+     * Frames are meant to be fed in playback order. Stepping back (playback looping, scrubbing) restarts the
+     * baselines. Artifact frames and frames that arent analyzed yet leave their channel's baseline and scores as
+     * they were.
+     */
+    class BaselineNormalizer
+    {
+    public:
+        static constexpr size_t BANDS = 5;
+
+        explicit BaselineNormalizer(const FrequencyAnalyzer& analyzer, BaselineOptions options = {});
+
+        // score frame_index and fold it into the baselines
+        void update(size_t frame_index);
+
+        // forget every baseline, the next frame starts them again
+        void reset();
+
+        [[nodiscard]] const BaselineOptions& get_options() const
+        {
+            return m_options;
+        }
+
+        [[nodiscard]] size_t get_channel_count() const
+        {
+            return m_channels;
+        }
+
+        // last frame passed to update(), max while nothing was
+        [[nodiscard]] size_t get_last_frame() const
+        {
+            return m_last_frame;
+        }
+
+        // every standard band of a channel, in FrequencyBand order
+        [[nodiscard]] std::span<const float> z_scores(ChannelHandle channel) const
+        {
+            return std::span(m_z).subspan(channel * BANDS, BANDS);
+        }
+
+        [[nodiscard]] std::span<const float> radii(ChannelHandle channel) const
+        {
+            return std::span(m_radii).subspan(channel * BANDS, BANDS);
+        }
+
+        [[nodiscard]] std::span<const float> alphas(ChannelHandle channel) const
+        {
+            return std::span(m_alphas).subspan(channel * BANDS, BANDS);
+        }
+
+    private:
+        const FrequencyAnalyzer& m_analyzer;
+        BaselineOptions m_options;
+
+        size_t m_channels = 0;
+        size_t m_last_frame = std::numeric_limits<size_t>::max();
+
+        float m_rate = 0.0f; // exponential weight of a new frame
+        size_t m_window_frames = 1;
+
+        // all [channel][band]
+        std::vector<float> m_values; // current frame, after the log
+        std::vector<float> m_valid; // 1 where the current frame counts, 0 for artifacts and missing bands
+        std::vector<float> m_mean;
+        std::vector<float> m_variance;
+        std::vector<float> m_count; // frames in the baseline, capped at the window for windowed baselines
+        std::vector<float> m_z;
+        std::vector<float> m_radii;
+        std::vector<float> m_alphas;
+
+        // windowed baselines: running sums and the values they hold, [slot][channel][band]
+        std::vector<double> m_sum;
+        std::vector<double> m_sum_squares;
+        std::vector<float> m_history;
+        std::vector<float> m_history_valid;
+        size_t m_history_slot = 0;
+
+        // size the state for channels a streaming analyzer added since the last frame
+        void resize(size_t channels);
+    };
+} // namespace brainviz::analysis
@@ -1,16 +1,18 @@
 #pragma once
 
-#include <kfr/all.hpp>
-#include <tsl/robin_map.h>
-#include <array>
-#include <string>
 #include <string_view>
+#include <vector>
 
 #include <data/interface.hpp>
+#include <analysis/frequency_analyzer.hpp>
+#include <analysis/spectral_estimator.hpp>
+#include <analysis/spectrogram_store.hpp>
+#include <analysis/peak_tracker.hpp>
+#include <analysis/feature_extractor.hpp>
 
 namespace brainviz::analysis
 {
-    class BatchAnalyzer
+    class BatchAnalyzer final : public FrequencyAnalyzer
     {
     public:
         // ctor with configurable window size and overlap percentage
@@ -20,102 +22,133 @@ namespace brainviz::analysis
             double overlap_percentage = 75.0
         );
 
-        // process all channels
+        // process all channels, channels are spread across worker threads
         void process_all_channels();
 
         // Process a specific channel
         void process_channel(std::string_view channel_name);
 
-        // Get the amplitude data for a specific band and channel
-        [[nodiscard]] const kfr::univector<double>& get_band_amplitude(
-            data::FrequencyBand band,
-            std::string_view channel_name) const;
+        // STFT mode: keep the full power spectrum of every frame processed from now on, see SpectrogramStore
+        void enable_spectrogram(SpectrogramOptions options = {});
 
-        // Get the dominant frequency band at a specific time
-        [[nodiscard]] data::FrequencyBand get_dominant_band(
-            std::string_view channel_name,
-            size_t time_index) const;
+        void disable_spectrogram();
 
-        // Visualization information structure
-        struct VisualizationInfo
+        [[nodiscard]] bool is_spectrogram_enabled() const
         {
-            double radius_multiplier;
-            double transparency;
-            data::FrequencyBand band;
-        };
+            return m_spectrogram_enabled;
+        }
 
-        // get visualization information for all bands at a specific time
-        [[nodiscard]] std::array<VisualizationInfo, 5> get_visualization_info(
-            std::string_view channel_name,
-            size_t time_index) const;
+        // empty unless channels were processed in STFT mode
+        [[nodiscard]] const SpectrogramStore& get_spectrogram() const
+        {
+            return m_spectrogram;
+        }
 
-        // get the maximum frame index available in the processed data
-        [[nodiscard]] size_t get_max_frame_index() const;
+        // find every band's spectral peak in the same pass as its power, for frames processed from now on
+        void enable_peak_tracking(PeakOptions options = {});
 
-        // conv time index to frame index
-        [[nodiscard]] size_t time_index_to_frame(size_t time_index) const;
+        void disable_peak_tracking();
 
-        [[nodiscard]] size_t get_window_size() const
+        [[nodiscard]] bool is_peak_tracking_enabled() const
         {
-            return m_window_size;
+            return m_peak_tracking;
         }
 
-        // TODO: get radius multiplier for the main unprocessed data based on the intensity of amplitude
+        // peak frequency (Hz) of a band over time, NaN at frames where the band has no peak. empty for channels
+        // processed without peak tracking
+        [[nodiscard]] StridedSpan<const double> get_peak_frequency(size_t band_index, ChannelHandle channel) const;
+
+        [[nodiscard]] StridedSpan<const double> get_peak_frequency(size_t band_index, std::string_view channel_name) const;
+
+        // peak power of a band over time, above the aperiodic component when it is fitted
+        [[nodiscard]] StridedSpan<const double> get_peak_power(size_t band_index, ChannelHandle channel) const;
+
+        [[nodiscard]] StridedSpan<const double> get_peak_power(size_t band_index, std::string_view channel_name) const;
+
+        // aperiodic exponent and offset over time, zeros unless PeakOptions::fit_aperiodic
+        [[nodiscard]] StridedSpan<const double> get_aperiodic_exponent(ChannelHandle channel) const;
+
+        [[nodiscard]] StridedSpan<const double> get_aperiodic_offset(ChannelHandle channel) const;
 
-        [[nodiscard]] size_t get_hop_size() const
+        // compute a row of features for every frame processed from now on, see FeatureExtractor. throws if a band
+        // ratio names a band the band set doesnt have
+        void enable_feature_extraction(FeatureOptions options = {});
+
+        void disable_feature_extraction();
+
+        [[nodiscard]] bool is_feature_extraction_enabled() const
         {
-            return m_hop_size;
+            return m_feature_extraction;
         }
 
-        [[nodiscard]] double get_frequency_resolution() const
+        // column names and layout of the feature rows
+        [[nodiscard]] const FeatureExtractor& get_feature_extractor() const
         {
-            return m_sampling_rate / m_window_size;
+            return m_feature_extractor;
         }
 
-        [[nodiscard]] double get_sampling_rate() const
+        // every feature of every frame, [channel][frame][feature]; a channel's rows are one contiguous matrix
+        [[nodiscard]] const BandTensor& get_features() const
         {
-            return m_sampling_rate;
+            return m_features;
         }
 
-        [[nodiscard]] const data::EEGData& get_eeg_data() const
+        // one feature column of a channel over time, empty for channels processed without feature extraction
+        [[nodiscard]] StridedSpan<const double> get_feature(size_t feature_index, ChannelHandle channel) const;
+
+        [[nodiscard]] StridedSpan<const double> get_feature(Feature feature, ChannelHandle channel) const;
+
+        // with a spectrogram the new bands are reduced from the stored spectra, otherwise channels need processing again
+        void set_band_set(BandSet bands) override;
+
+        // TODO: get radius multiplier for the main unprocessed data based on the intensity of amplitude
+
+        [[nodiscard]] const data::EEGData& get_eeg_data() const override
         {
             return m_eeg_data;
         }
 
     private:
         const data::EEGData& m_eeg_data;
-        double m_sampling_rate;
 
-        // FFT params
-        size_t m_window_size; // window size (power of 2)
-        size_t m_hop_size; // hop size (for overlap)
-
-        // struct to hold amplitude values for each frequency band
-        struct BandAmplitudes
-        {
-            kfr::univector<double> delta;
-            kfr::univector<double> theta;
-            kfr::univector<double> alpha;
-            kfr::univector<double> beta;
-            kfr::univector<double> gamma;
-        };
-
-        // map of channel name to band amplitudes
-        tsl::robin_map<std::string, BandAmplitudes> m_channel_amplitudes;
-
-        // calc band amplitude from the power spectrum
-        [[nodiscard]] static double calculate_band_amplitude(
-            const kfr::univector<double>& power_spectrum,
-            double freq_resolution,
-            double min_freq,
-            double max_freq);
-
-        // calculate radius multiplier based on relative amplitude
-        [[nodiscard]] static double calculate_radius_multiplier(double amplitude, double max_amplitude);
-
-        // calculate transparency based on relative amplitude
-        [[nodiscard]] static double calculate_transparency(double amplitude, double max_amplitude);
-
-        [[nodiscard]] static size_t round_to_power_of_2(size_t value);
+        bool m_spectrogram_enabled = false;
+        SpectrogramStore m_spectrogram;
+
+        bool m_peak_tracking = false;
+        PeakTracker m_peak_tracker; // configured copy, every worker tracks with its own
+        BandTensor m_peak_frequencies; // [channel][frame][band]
+        BandTensor m_peak_powers; // [channel][frame][band]
+        BandTensor m_aperiodic; // [channel][frame][offset, exponent]
+
+        bool m_feature_extraction = false;
+        FeatureExtractor m_feature_extractor;
+        BandTensor m_features; // [channel][frame][feature]
+
+        // register a channel and size its results (spectrogram, peaks) for its frames, not thread safe
+        ChannelHandle prepare_channel(std::string_view channel_name, size_t frames);
+
+        // fill the frames of a prepared channel, channels can be analyzed concurrently
+        void analyze_channel(
+            ChannelHandle channel,
+            const std::vector<double>& raw_data,
+            SpectralEstimator& estimator,
+            PeakTracker& peak_tracker);
+
+        // size the peak and feature tensors of a channel, zero frames for what is off so stale rows dont stick
+        void prepare_derived(ChannelHandle channel, size_t frames);
+
+        // peaks and features of one stored frame, safe for different channels from different threads
+        void derive_frame(
+            PeakTracker& peak_tracker,
+            ChannelHandle channel,
+            size_t frame,
+            std::span<const double> samples,
+            std::span<const double> power_spectrum);
+
+        // one column of a peak or feature tensor over time, empty for channels the tensor has no rows of
+        [[nodiscard]] StridedSpan<const double> derived_series(
+            const BandTensor& tensor,
+            size_t column,
+            ChannelHandle channel) const;
     };
 } // namespace brainviz::analysis
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <kfr/all.hpp>
+#include <span>
+#include <vector>
+
+#include <analysis/spectral_estimator.hpp>
+
+namespace brainviz::analysis
+{
+    /**
+     * @brief Autoregressive spectrum from Burg's method over the newest samples of a frame
+     *
+     * Only the last segment_size samples of the frame are fitted, so band powers follow the signal with the delay
+     * of that segment instead of the whole window, while the model spectrum is still evaluated on the window's
+     * bin grid. Each bin gets the model spectrum averaged over its width (OVERSAMPLE points), so narrow model
+     * peaks integrate to their power instead of depending on where they fall between bins. The result is scaled
+     * to the periodogram's units: white noise of variance v gives v times the hann reference energy per bin.
+     */
+    class BurgEstimator final : public SpectralEstimator
+    {
+    public:
+        static constexpr size_t OVERSAMPLE = 4;
+
+        BurgEstimator(size_t window_size, size_t segment_size = 0, size_t order = 0);
+
+        const kfr::univector<double>& compute(std::span<const double> frame) override;
+
+        [[nodiscard]] size_t get_segment_size() const
+        {
+            return m_segment_size;
+        }
+
+        [[nodiscard]] size_t get_order() const
+        {
+            return m_order;
+        }
+
+        // a[0] = 1, ..., a[order] of the last fitted model, x[t] + sum a[m] x[t - m] = e[t]
+        [[nodiscard]] std::span<const double> get_coefficients() const
+        {
+            return m_coefficients;
+        }
+
+    private:
+        size_t m_segment_size;
+        size_t m_order;
+
+        // [lag][point] cos and sin of the OVERSAMPLE points spread over every bin
+        std::vector<double> m_cos;
+        std::vector<double> m_sin;
+
+        std::vector<double> m_forward;
+        std::vector<double> m_backward;
+        std::vector<double> m_coefficients;
+        std::vector<double> m_previous;
+        std::vector<double> m_response_re;
+        std::vector<double> m_response_im;
+
+        // fit m_coefficients to the segment, returns the prediction error power
+        double fit(std::span<const double> segment);
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <analysis/band_tensor.hpp>
+
+namespace brainviz::analysis
+{
+    class FrequencyAnalyzer;
+
+    struct ConnectivityOptions
+    {
+        // frames whose cross spectra are averaged into one estimate, ending at the frame itself. a single
+        // frame gives a coherence of 1 for every pair, so this trades time resolution for meaning
+        size_t averaging_frames = 8;
+    };
+
+    /**
+     * @brief Magnitude squared coherence and phase locking value of every channel pair, per band and frame
+     *
+     * Uses the analyzer's frame grid and hann window, each frame of each channel is transformed once (two channels
+     * per complex FFT) and its in-band bins are reused by every pair and every averaging window it falls in.
+     * For a frame the cross spectra of the last averaging_frames frames are summed per bin, and the per bin
+     * estimates are averaged over each band's bins:
+     *
+     *     coherence = |sum X conj(Y)|^2 / (sum |X|^2 * sum |Y|^2),  plv = |mean (X / |X|) conj(Y / |Y|)|
+     *
+     * The pairwise sums are products over the [channel][bin] rows of a frame; they are computed in tiles of
+     * TILE x TILE channels so the rows stay in cache, slide over the frames by adding the newest frame and removing
+     * the oldest, and the tiles run in parallel.
+     *
+     * Results are kept for the last computed frame range only, all pairs of a recording over all frames would not
+     * fit in memory. Pairs (a, b) have a < b in channel handle order.
+     */
+    class ConnectivityEngine
+    {
+    public:
+        static constexpr size_t TILE = 8;
+
+        ConnectivityEngine(const FrequencyAnalyzer& analyzer, ConnectivityOptions options = {});
+
+        // compute frames [first_frame, first_frame + frame_count), replaces the previous range
+        void compute(size_t first_frame, size_t frame_count);
+
+        [[nodiscard]] size_t get_channel_count() const
+        {
+            return m_channels;
+        }
+
+        [[nodiscard]] size_t get_pair_count() const
+        {
+            return m_channels * (m_channels - 1) / 2;
+        }
+
+        [[nodiscard]] size_t get_band_count() const
+        {
+            return m_band_bins.size();
+        }
+
+        [[nodiscard]] size_t pair_index(ChannelHandle a, ChannelHandle b) const;
+
+        [[nodiscard]] std::pair<ChannelHandle, ChannelHandle> get_pair(size_t pair) const;
+
+        [[nodiscard]] size_t get_first_frame() const
+        {
+            return m_first_frame;
+        }
+
+        [[nodiscard]] size_t get_frame_count() const
+        {
+            return m_frame_count;
+        }
+
+        // bands of one pair at a computed frame (absolute index)
+        [[nodiscard]] std::span<const float> get_coherence(size_t frame, size_t pair) const;
+
+        [[nodiscard]] std::span<const float> get_phase_locking(size_t frame, size_t pair) const;
+
+        // [pair][band] of a computed frame
+        [[nodiscard]] std::span<const float> coherence_frame(size_t frame) const;
+
+        [[nodiscard]] std::span<const float> phase_locking_frame(size_t frame) const;
+
+    private:
+        const FrequencyAnalyzer& m_analyzer;
+        ConnectivityOptions m_options;
+
+        size_t m_channels;
+        size_t m_window_size;
+        size_t m_hop_size;
+
+        // tracked bins [m_first_bin, m_first_bin + m_bin_count), union of all bands
+        size_t m_first_bin = 0;
+        size_t m_bin_count = 0;
+        std::vector<std::pair<size_t, size_t> > m_band_bins; // [first, last) relative to m_first_bin, empty if equal
+
+        size_t m_first_frame = 0;
+        size_t m_frame_count = 0;
+        std::vector<float> m_coherence; // [frame][pair][band]
+        std::vector<float> m_phase_locking;
+
+        [[nodiscard]] size_t result_offset(size_t frame, size_t pair) const;
+    };
+} // namespace brainviz::analysis
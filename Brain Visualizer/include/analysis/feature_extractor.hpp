@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <analysis/band_set.hpp>
+
+namespace brainviz::analysis
+{
+    // fixed columns of a feature row, the configured band ratios follow them
+    enum class Feature : size_t
+    {
+        HjorthActivity, // variance of the frame's samples
+        HjorthMobility, // sqrt(var(x') / var(x)), per sample differences
+        HjorthComplexity, // mobility of x' over mobility of x
+        SpectralEntropy, // shannon entropy of the normalized power over the spectral range, 0..1
+        SpectralEdge // Hz below which edge_fraction of the power in the spectral range lies
+    };
+
+    // power of one band over the power of another, by band name
+    struct BandRatio
+    {
+        std::string numerator;
+        std::string denominator;
+    };
+
+    struct FeatureOptions
+    {
+        // range of the spectral entropy and edge frequency, a max of 0 is nyquist
+        double min_freq = 0.5;
+        double max_freq = 0.0;
+
+        double edge_fraction = 0.95;
+
+        std::vector<BandRatio> band_ratios = {{"Theta", "Beta"}};
+    };
+
+    /**
+     * @brief Per frame features for downstream classifiers, from the samples and spectrum the analyzer already has
+     *
+     * extract() takes a frame's raw samples, its power spectrum and its band amplitudes and writes one row of
+     * get_feature_count() values: the Feature columns, then one column per band ratio. Hjorth parameters are a
+     * single pass over the samples (two for a mean free variance), entropy and edge frequency a pass over the
+     * bins of the spectral range, and ratios reuse the band amplitudes, so no extra transform is needed.
+     *
+     * Undefined values (a ratio over a silent band, the edge of an empty spectrum) are NaN. Stateless, one
+     * extractor can be shared across threads.
+     */
+    class FeatureExtractor
+    {
+    public:
+        static constexpr size_t FIXED_FEATURES = 5;
+
+        FeatureExtractor() = default;
+
+        // throws if a band ratio names a band the set doesnt have
+        FeatureExtractor(const BandSet& bands, double sampling_rate, size_t window_size, FeatureOptions options = {});
+
+        void extract(
+            std::span<const double> samples,
+            std::span<const double> power_spectrum,
+            std::span<const double> band_amplitudes,
+            std::span<double> features) const;
+
+        // the hjorth columns, from the samples only
+        void extract_temporal(std::span<const double> samples, std::span<double> features) const;
+
+        // the spectral and band ratio columns, from the spectrum and band amplitudes only
+        void extract_spectral(
+            std::span<const double> power_spectrum,
+            std::span<const double> band_amplitudes,
+            std::span<double> features) const;
+
+        [[nodiscard]] size_t get_feature_count() const
+        {
+            return m_names.size();
+        }
+
+        // column names, in row order
+        [[nodiscard]] const std::vector<std::string>& get_feature_names() const
+        {
+            return m_names;
+        }
+
+        [[nodiscard]] const FeatureOptions& get_options() const
+        {
+            return m_options;
+        }
+
+    private:
+        FeatureOptions m_options;
+        double m_frequency_resolution = 1.0;
+
+        // bins of the spectral range
+        size_t m_first_bin = 0;
+        size_t m_last_bin = 0;
+
+        // band indices of every ratio
+        std::vector<std::pair<size_t, size_t> > m_ratios;
+
+        std::vector<std::string> m_names;
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <tsl/robin_map.h>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <data/interface.hpp>
+#include <analysis/spectral_estimator.hpp>
+#include <analysis/band_set.hpp>
+#include <analysis/band_tensor.hpp>
+#include <analysis/artifact_detector.hpp>
+#include <analysis/visualization_table.hpp>
+
+namespace brainviz::analysis
+{
+    /**
+     * @brief Common query surface shared by the batch and streaming analyzers, the UI only talks to this
+     *
+     * Results of every channel live in one BandTensor owned here. Channels are addressed by an integer
+     * ChannelHandle; resolve it once with get_channel_handle() and use the handle overloads in per frame code,
+     * the name overloads hash the name on every call.
+     *
+     * get_frame_count(), get_frame(), get_artifact_flags() and find_visualization_table() are the per frame read
+     * path and work for every analyzer. Analyzers that dont keep every frame (LazyAnalyzer) override them and
+     * leave the whole channel views, get_results(), get_band_amplitude() and get_artifact_mask(), empty.
+     */
+    class FrequencyAnalyzer
+    {
+    public:
+        FrequencyAnalyzer(const FrequencyAnalyzer&) = delete;
+
+        FrequencyAnalyzer& operator=(const FrequencyAnalyzer&) = delete;
+
+        virtual ~FrequencyAnalyzer() = default;
+
+        // handle of an analyzed channel, throws if the channel has no results
+        [[nodiscard]] ChannelHandle get_channel_handle(std::string_view channel_name) const;
+
+        [[nodiscard]] std::optional<ChannelHandle> find_channel(std::string_view channel_name) const;
+
+        [[nodiscard]] const std::string& get_channel_name(ChannelHandle channel) const;
+
+        [[nodiscard]] size_t get_channel_count() const
+        {
+            return m_channel_names.size();
+        }
+
+        // all results, [channel][frame][band]. holds no frames for analyzers that only keep some of them
+        [[nodiscard]] const BandTensor& get_results() const
+        {
+            return m_results;
+        }
+
+        // frames of a channel, 0 for unknown handles
+        [[nodiscard]] virtual size_t get_frame_count(ChannelHandle channel) const;
+
+        // every band of one frame of a channel, in band set order. frames that arent analyzed read as zeros
+        [[nodiscard]] virtual std::span<const double> get_frame(ChannelHandle channel, size_t frame_index) const;
+
+        // Get the amplitude data for a band of the configured band set and a channel, over every frame
+        [[nodiscard]] StridedSpan<const double> get_band_amplitude(size_t band_index, ChannelHandle channel) const;
+
+        [[nodiscard]] StridedSpan<const double> get_band_amplitude(
+            size_t band_index,
+            std::string_view channel_name) const;
+
+        // Get the amplitude data for one of the five standard bands, throws if the band set doesnt have it
+        [[nodiscard]] StridedSpan<const double> get_band_amplitude(
+            data::FrequencyBand band,
+            ChannelHandle channel) const;
+
+        [[nodiscard]] StridedSpan<const double> get_band_amplitude(
+            data::FrequencyBand band,
+            std::string_view channel_name) const;
+
+        // get the maximum frame index every channel has reached
+        [[nodiscard]] size_t get_max_frame_index() const;
+
+        // call before reading a frame. analyzers that compute frames on demand analyze it (and queue the frames
+        // after it), the others already have every frame they report
+        virtual void prepare_frame(size_t /*frame_index*/)
+        {
+        }
+
+        // false while a frame below get_max_frame_index() still reads as zeros
+        [[nodiscard]] virtual bool is_frame_ready(const size_t frame_index) const
+        {
+            return frame_index <= get_max_frame_index();
+        }
+
+        // raw samples the frames were computed from
+        [[nodiscard]] virtual const data::EEGData& get_eeg_data() const = 0;
+
+        // Get the dominant frequency band at a specific time
+        [[nodiscard]] data::FrequencyBand get_dominant_band(ChannelHandle channel, size_t time_index) const;
+
+        [[nodiscard]] data::FrequencyBand get_dominant_band(
+            std::string_view channel_name,
+            size_t time_index) const;
+
+        // Visualization information structure
+        struct VisualizationInfo
+        {
+            double radius_multiplier;
+            double transparency;
+            size_t band_index; // into get_band_set()
+        };
+
+        // get visualization information for every band of the band set at a specific time, in band set order.
+        // radius and transparency are relative to the largest band of the frame
+        [[nodiscard]] std::vector<VisualizationInfo> get_visualization_info(
+            ChannelHandle channel,
+            size_t time_index) const;
+
+        [[nodiscard]] std::vector<VisualizationInfo> get_visualization_info(
+            std::string_view channel_name,
+            size_t time_index) const;
+
+        // same as get_visualization_info but by frame, frames the channel doesnt have and artifact frames come back
+        // as zeros
+        [[nodiscard]] std::vector<VisualizationInfo> get_frame_visualization_info(
+            ChannelHandle channel,
+            size_t frame_index) const;
+
+        // same, into get_band_count() entries of info, for callers filling many frames
+        void get_frame_visualization_info(
+            ChannelHandle channel,
+            size_t frame_index,
+            std::span<VisualizationInfo> info) const;
+
+        // bake get_frame_visualization_info for every frame and channel into a table, see VisualizationTable.
+        // optional, the table is dropped again whenever the results change
+        void build_visualization_table();
+
+        // the baked table holding a frame, null if no table covers it. only after build_visualization_table() and
+        // before the next change to the results, LazyAnalyzer bakes one per analyzed block on its own
+        [[nodiscard]] virtual const VisualizationTable* find_visualization_table(size_t frame_index) const;
+
+        // conv time index to frame index
+        [[nodiscard]] size_t time_index_to_frame(size_t time_index) const;
+
+        [[nodiscard]] size_t get_window_size() const
+        {
+            return m_window_size;
+        }
+
+        [[nodiscard]] size_t get_hop_size() const
+        {
+            return m_hop_size;
+        }
+
+        [[nodiscard]] double get_frequency_resolution() const
+        {
+            return m_sampling_rate / m_window_size;
+        }
+
+        [[nodiscard]] double get_sampling_rate() const
+        {
+            return m_sampling_rate;
+        }
+
+        // frames a signal of this many samples yields, a signal shorter than one window still gets one frame
+        [[nodiscard]] static size_t frame_count(size_t samples, size_t window_size, size_t hop_size);
+
+        // pick the spectral estimator used for frames processed from now on
+        virtual void set_spectral_options(const SpectralOptions& options)
+        {
+            m_spectral_options = options;
+        }
+
+        [[nodiscard]] const SpectralOptions& get_spectral_options() const
+        {
+            return m_spectral_options;
+        }
+
+        // replace the bands frames are reduced into, rebuilds the bin table for this sample rate and window.
+        // every channel keeps its handle but loses its frames
+        virtual void set_band_set(BandSet bands);
+
+        [[nodiscard]] const BandSet& get_band_set() const
+        {
+            return m_bands;
+        }
+
+        [[nodiscard]] size_t get_band_count() const
+        {
+            return m_bands.size();
+        }
+
+        [[nodiscard]] const BandBinTable& get_band_table() const
+        {
+            return m_band_table;
+        }
+
+        // index of one of the five standard bands in the band set, if the set has it
+        [[nodiscard]] std::optional<size_t> get_band_index(const data::FrequencyBand band) const
+        {
+            return m_standard_indices[static_cast<size_t>(band)];
+        }
+
+        // flag blink, pop and muscle frames as they are analyzed, applies to frames computed from now on
+        virtual void enable_artifact_detection(ArtifactOptions options = {});
+
+        virtual void disable_artifact_detection();
+
+        [[nodiscard]] bool is_artifact_detection_enabled() const
+        {
+            return m_artifact_detection;
+        }
+
+        // ArtifactFlag bits of a frame, 0 for clean frames and frames that were never checked
+        [[nodiscard]] virtual std::uint8_t get_artifact_flags(ChannelHandle channel, size_t frame_index) const;
+
+        // artifact frames should be left out of rendering and of any normalization across frames
+        [[nodiscard]] bool is_artifact(const ChannelHandle channel, const size_t frame_index) const
+        {
+            return get_artifact_flags(channel, frame_index) != 0;
+        }
+
+        // ArtifactFlag bits of every checked frame of a channel, empty for analyzers that only keep some frames
+        [[nodiscard]] std::span<const std::uint8_t> get_artifact_mask(ChannelHandle channel) const;
+
+    protected:
+        FrequencyAnalyzer(double sampling_rate, size_t window_size, double overlap_percentage);
+
+        double m_sampling_rate;
+
+        // FFT params
+        size_t m_window_size; // window size (power of 2)
+        size_t m_hop_size; // hop size (for overlap)
+
+        SpectralOptions m_spectral_options;
+
+        BandSet m_bands;
+        BandBinTable m_band_table;
+        std::array<std::optional<size_t>, 5> m_standard_indices; // FrequencyBand -> index into m_bands
+
+        BandTensor m_results;
+        tsl::robin_map<std::string, ChannelHandle> m_channel_handles;
+        std::vector<std::string> m_channel_names; // by handle
+
+        VisualizationTable m_visualization_table;
+
+        bool m_artifact_detection = false;
+        ArtifactDetector m_artifact_detector;
+        std::vector<std::vector<std::uint8_t> > m_artifact_masks; // [channel][frame] ArtifactFlag bits
+
+        // frames a channel of this many samples yields with this analyzer's window and hop
+        [[nodiscard]] size_t frame_count(const size_t samples) const
+        {
+            return frame_count(samples, m_window_size, m_hop_size);
+        }
+
+        // handle of a channel, adding an empty one to the results if it isnt known yet
+        ChannelHandle add_channel_results(const std::string& channel_name);
+
+        // reduce one power spectrum into the band amplitudes of an existing frame
+        void store_frame(ChannelHandle channel, size_t frame, std::span<const double> power_spectrum);
+
+        // flag frames [first_frame, first_frame + frame_count) of a channel once their band amplitudes are stored.
+        // samples start at first_frame's first sample. no-op with detection off, safe to call for different
+        // channels from different threads
+        void detect_artifacts(
+            ChannelHandle channel,
+            std::span<const double> samples,
+            size_t first_frame,
+            size_t frame_count);
+
+        // redo only the muscle bit of the first frame_count frames of a channel from their stored band amplitudes,
+        // the amplitude and kurtosis bits dont depend on the bands and are kept
+        void redetect_muscle_artifacts(ChannelHandle channel, size_t frame_count);
+
+        // factor turning the variance of a band limited signal into the summed hann periodogram power of its bins,
+        // lets the time domain engines report amplitudes on the FFT path's scale
+        [[nodiscard]] double variance_to_band_power() const;
+
+        // calculate radius multiplier based on relative amplitude
+        [[nodiscard]] static double calculate_radius_multiplier(double amplitude, double max_amplitude);
+
+        // calculate transparency based on relative amplitude
+        [[nodiscard]] static double calculate_transparency(double amplitude, double max_amplitude);
+    };
+} // namespace brainviz::analysis
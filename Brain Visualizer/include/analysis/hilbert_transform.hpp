@@ -0,0 +1,44 @@
+#pragma once
+
+#include <kfr/all.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+
+namespace brainviz::analysis
+{
+    /**
+     * @brief Analytic signal of a whole real signal through a zero padded FFT
+     *
+     * The signal is padded to the next power of two and transformed, DC and nyquist are kept, the positive
+     * frequencies doubled and the negative ones dropped, and the result is transformed back. Plans are built once
+     * per transform size and owned by the transform, so they go away with the engine that uses it. Thread safe,
+     * one transform can be shared by every worker as long as each brings its own Workspace.
+     */
+    class HilbertTransform
+    {
+    public:
+        // per thread scratch, the analytic signal is left in analytic
+        struct Workspace
+        {
+            kfr::univector<kfr::complex<double> > analytic;
+            kfr::univector<kfr::complex<double> > spectrum;
+            kfr::univector<std::uint8_t> temp;
+        };
+
+        HilbertTransform() = default;
+
+        // fills workspace.analytic with the analytic signal, the first signal.size() values belong to the signal.
+        // unnormalized, every value is scaled by the transform size, workspace.analytic.size()
+        void analytic_signal(std::span<const double> signal, Workspace& workspace) const;
+
+    private:
+        mutable std::mutex m_plan_mutex;
+        mutable std::map<size_t, std::shared_ptr<const kfr::dft_plan<double> > > m_plans;
+
+        [[nodiscard]] std::shared_ptr<const kfr::dft_plan<double> > get_plan(size_t size) const;
+    };
+} // namespace brainviz::analysis
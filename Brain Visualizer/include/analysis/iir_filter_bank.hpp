@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <analysis/band_set.hpp>
+
+namespace brainviz::analysis
+{
+    // one second order section, a0 normalized to 1, run in transposed direct form II
+    struct Biquad
+    {
+        double b0, b1, b2;
+        double a1, a2;
+    };
+
+    // how a band passed signal is turned into an amplitude envelope
+    enum class EnvelopeMode
+    {
+        Hilbert, // magnitude of the analytic signal, needs the whole signal so batch only
+        Rms // root mean square over a sliding window, works sample by sample
+    };
+
+    /**
+     * @brief Butterworth band-pass sections for one band
+     *
+     * The order's low-pass prototype is moved to the band with the low-pass to band-pass transform and
+     * discretized with the prewarped bilinear transform, giving order sections with -3 dB at both edges and unit
+     * gain at the geometric centre. A band starting at 0 Hz becomes a low-pass and one reaching nyquist a
+     * high-pass. Designs are cached per (sampling rate, edges, order) and shared.
+     */
+    [[nodiscard]] std::shared_ptr<const std::vector<Biquad> > design_band_pass(
+        double sampling_rate,
+        double low_freq,
+        double high_freq,
+        size_t order);
+
+    // notches at frequency and its harmonics below nyquist, one section each, -3 dB width frequency / quality
+    [[nodiscard]] std::shared_ptr<const std::vector<Biquad> > design_notch(
+        double sampling_rate,
+        double frequency,
+        size_t harmonics = 1,
+        double quality = 30.0);
+
+    /**
+     * @brief Bank of IIR band-pass filters, one cascade of biquads per band, run for many channels at once
+     *
+     * Streaming: push() steps every channel one sample through every band. Filter state is laid out
+     * [band][section][channel] so the inner loop runs over contiguous channels and vectorizes like the sliding
+     * DFT bank does.
+     *
+     * Batch: filter_block() runs a whole signal of up to LANES channels through one band, interleaved so every
+     * section update is one SIMD operation across the channels, optionally forward and backward for zero phase.
+     */
+    class IirFilterBank
+    {
+    public:
+        // channels filter_block() processes together
+        static constexpr size_t LANES = 8;
+
+        IirFilterBank() = default;
+
+        IirFilterBank(double sampling_rate, const BandSet& bands, size_t order = 4);
+
+        // add a channel slot, returns its index
+        size_t add_channel();
+
+        [[nodiscard]] size_t get_channel_count() const
+        {
+            return m_channels;
+        }
+
+        [[nodiscard]] size_t get_band_count() const
+        {
+            return m_sections.size();
+        }
+
+        [[nodiscard]] const std::vector<Biquad>& get_sections(const size_t band) const
+        {
+            return *m_sections[band];
+        }
+
+        // push one sample for every channel at once, samples[slot]
+        void push(std::span<const double> samples);
+
+        // push one sample for a single channel
+        void push_channel(size_t slot, double sample);
+
+        // band passed value of the last pushed sample, [slot]
+        [[nodiscard]] std::span<const double> get_output(const size_t band) const
+        {
+            return std::span(m_output).subspan(band * m_channels, m_channels);
+        }
+
+        [[nodiscard]] double get_output(const size_t band, const size_t slot) const
+        {
+            return m_output[band * m_channels + slot];
+        }
+
+        // zero every channel's filter state
+        void reset();
+
+        // filter up to LANES signals of sample_count samples through one band in place, independent of push() state
+        void filter_block(size_t band, std::span<double* const> signals, size_t sample_count, bool zero_phase) const;
+
+    private:
+        size_t m_channels = 0;
+
+        std::vector<std::shared_ptr<const std::vector<Biquad> > > m_sections; // per band
+        std::vector<size_t> m_state_offset; // first state row of each band
+
+        // [row][channel], two rows (z1, z2) per section
+        std::vector<double> m_state;
+        size_t m_state_rows = 0;
+
+        // [band][channel]
+        std::vector<double> m_output;
+
+        void resize_channels(size_t channels);
+    };
+
+    // run up to IirFilterBank::LANES signals through a cascade in place, interleaved so each section step is one
+    // SIMD operation across the signals. state is [section][z1, z2][lane] and carries over between calls
+    void run_cascade(
+        std::span<const Biquad> sections,
+        std::span<double* const> signals,
+        size_t sample_count,
+        std::span<double> state,
+        bool backward = false);
+} // namespace brainviz::analysis
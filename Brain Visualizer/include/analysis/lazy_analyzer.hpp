@@ -0,0 +1,190 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <data/interface.hpp>
+#include <analysis/frequency_analyzer.hpp>
+#include <analysis/spectral_estimator.hpp>
+
+namespace brainviz::analysis
+{
+    struct LazyOptions
+    {
+        size_t block_frames = 64; // frames analyzed together, every channel at once
+        size_t prefetch_blocks = 4; // blocks analyzed ahead of the playhead in the playback direction
+
+        // blocks kept analyzed before the playhead in frame order, for views of the recent history like the band
+        // amplitude plot. queued after the prefetches
+        size_t trailing_blocks = 2;
+
+        // analyzed blocks kept, the ones furthest from the playhead are freed first and analyzed again when the
+        // playhead comes back. bounds the results to max_cached_blocks x block_frames x channels x bands. 0 keeps
+        // every block
+        size_t max_cached_blocks = 256;
+    };
+
+    /**
+     * @brief Analyzes frames on demand around the playhead instead of the whole recording up front
+     *
+     * Every channel is registered with the frame count of its samples at construction, so frame indices, the frame
+     * count and the per frame reads (get_frame(), get_artifact_flags(), find_visualization_table()) are the same as
+     * after BatchAnalyzer::process_all_channels(), but frames read as zero until prepare_frame() asks for them.
+     * Startup only allocates the state of each block, nothing per frame.
+     *
+     * Frames are analyzed in blocks of block_frames across all channels: the block under the playhead is computed
+     * on the spot if it is missing, the next prefetch_blocks blocks in the playback direction are queued for a
+     * background thread. Only resident blocks are stored, each one owning its amplitudes, artifact flags and
+     * visualization table, baked as it is published. Finished blocks are moved in on the next prepare_frame(), so
+     * the store is only ever written from the thread that reads it, and the block furthest from the playhead is
+     * freed once more than max_cached_blocks are resident. The whole channel views of FrequencyAnalyzer
+     * (get_results(), get_band_amplitude(), get_artifact_mask()) hold no frames.
+     *
+     * Changing the bands, the spectral options or the artifact detection frees every block.
+     */
+    class LazyAnalyzer final : public FrequencyAnalyzer
+    {
+    public:
+        LazyAnalyzer(
+            const data::EEGData& eeg_data,
+            size_t window_size,
+            double overlap_percentage = 75.0,
+            LazyOptions options = {});
+
+        // analyze the block of frame_index if needed, publish finished prefetches and queue the next blocks
+        void prepare_frame(size_t frame_index) override;
+
+        [[nodiscard]] bool is_frame_ready(size_t frame_index) const override;
+
+        [[nodiscard]] size_t get_block_count() const
+        {
+            return m_block_states.size();
+        }
+
+        [[nodiscard]] size_t get_cached_block_count() const
+        {
+            return m_resident.size();
+        }
+
+        [[nodiscard]] const LazyOptions& get_options() const
+        {
+            return m_options;
+        }
+
+        void set_spectral_options(const SpectralOptions& options) override;
+
+        void set_band_set(BandSet bands) override;
+
+        void enable_artifact_detection(ArtifactOptions options = {}) override;
+
+        void disable_artifact_detection() override;
+
+        [[nodiscard]] size_t get_frame_count(ChannelHandle channel) const override;
+
+        [[nodiscard]] std::span<const double> get_frame(ChannelHandle channel, size_t frame_index) const override;
+
+        [[nodiscard]] std::uint8_t get_artifact_flags(ChannelHandle channel, size_t frame_index) const override;
+
+        [[nodiscard]] const VisualizationTable* find_visualization_table(size_t frame_index) const override;
+
+        [[nodiscard]] const data::EEGData& get_eeg_data() const override
+        {
+            return m_eeg_data;
+        }
+
+    private:
+        enum class BlockState : std::uint8_t
+        {
+            Empty,
+            Queued, // waiting for or on the background thread
+            Ready
+        };
+
+        // what a block is analyzed with, copied so the background thread never reads the analyzer's own state
+        struct Settings
+        {
+            size_t window_size;
+            size_t hop_size;
+            size_t band_count;
+            SpectralOptions spectral_options;
+            BandBinTable band_table;
+            bool artifact_detection;
+            ArtifactDetector artifact_detector;
+        };
+
+        struct Block
+        {
+            size_t index;
+            size_t generation;
+            std::vector<double> amplitudes; // [channel][frame][band], empty if analysis failed
+            std::vector<std::uint8_t> flags; // [channel][frame]
+            VisualizationTable table; // baked once the block is resident
+        };
+
+        struct BlockStatus
+        {
+            BlockState state = BlockState::Empty;
+            size_t slot = 0; // into m_resident while Ready
+        };
+
+        const data::EEGData& m_eeg_data;
+        LazyOptions m_options;
+
+        std::vector<const std::vector<double>*> m_raw_data; // by handle
+        std::vector<size_t> m_frame_counts; // by handle
+
+        // owned by the thread calling prepare_frame()
+        std::vector<BlockStatus> m_block_states;
+        std::vector<Block> m_resident; // ready blocks, the only frames kept
+        std::vector<double> m_zero_frame; // read for frames whose block isnt resident
+        size_t m_last_block = 0;
+        bool m_backward = false;
+
+        // shared with the background thread
+        std::mutex m_mutex;
+        std::condition_variable_any m_wake;
+        std::shared_ptr<const Settings> m_settings;
+        size_t m_generation = 0;
+        std::deque<size_t> m_queue;
+        std::optional<size_t> m_in_flight; // block the background thread is analyzing
+        std::vector<Block> m_finished;
+
+        // last so it is joined before anything it uses is destroyed
+        std::jthread m_worker;
+
+        // queue a block for the background thread if it isnt analyzed or queued yet, m_mutex held
+        void queue_block(size_t index);
+
+        // snapshot the current settings, drop every block and every queued or finished one. only touches the blocks
+        // that arent empty, so it costs the same however long the recording is
+        void reset_blocks();
+
+        // analyze channels [first_channel, last_channel) of a block into its buffers
+        void analyze_block(
+            const Settings& settings,
+            SpectralEstimator& estimator,
+            Block& block,
+            size_t first_channel,
+            size_t last_channel) const;
+
+        [[nodiscard]] Block make_block(const Settings& settings, size_t index, size_t generation) const;
+
+        // resident block holding a frame, null if it isnt analyzed
+        [[nodiscard]] const Block* find_block(size_t frame_index) const;
+
+        // move a block into the store, bake its table and mark it ready
+        void publish_block(Block block);
+
+        // free the resident block in a slot, the last one moves into its slot
+        void evict_block(size_t slot);
+
+        void run_worker(const std::stop_token& stop);
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <kfr/all.hpp>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace brainviz::analysis
+{
+    struct CwtOptions
+    {
+        double min_freq = 0.5;
+        double max_freq = 100.0; // clamped to 0.45 * sampling rate
+        size_t voices_per_octave = 8;
+        double cycles = 7.0; // wavelet width, more cycles trade time localization for frequency resolution
+    };
+
+    /**
+     * @brief Continuous wavelet transform with complex Morlet wavelets at log spaced frequencies
+     *
+     * A channel is transformed once with a zero padded FFT, then every scale is the inverse FFT of that spectrum
+     * times the scale's Gaussian wavelet spectrum. The wavelet spectrum is only non zero in a narrow window of
+     * bins, so each scale is inverted at the smallest power of two that holds that window (and still gives a few
+     * samples per hop); the frequency shift this implies only changes the phase, not |W|^2. Wavelet spectra and
+     * inverse plans are built once per (FFT size, hop) and shared between threads.
+     *
+     * Wavelets are analytic and scaled so a sinusoid of amplitude A at a scale's frequency gives |W| = A.
+     */
+    class MorletCwt
+    {
+    public:
+        // per thread scratch for transform_signal / frame_power
+        struct Workspace
+        {
+            kfr::univector<kfr::complex<double> > input;
+            kfr::univector<kfr::complex<double> > output;
+            kfr::univector<uint8_t> temp;
+            std::vector<double> prefix;
+        };
+
+        MorletCwt(double sampling_rate, CwtOptions options = {});
+
+        [[nodiscard]] const std::vector<double>& get_frequencies() const
+        {
+            return m_frequencies;
+        }
+
+        [[nodiscard]] size_t get_scale_count() const
+        {
+            return m_frequencies.size();
+        }
+
+        [[nodiscard]] const CwtOptions& get_options() const
+        {
+            return m_options;
+        }
+
+        // weight turning a sum of |W|^2 over neighbouring scales into signal variance, corrects for scale overlap
+        [[nodiscard]] double get_variance_weight(const size_t scale) const
+        {
+            return m_variance_weights[scale];
+        }
+
+        // zero padded FFT length for a signal, long enough that the widest wavelet doesnt wrap around
+        [[nodiscard]] size_t get_fft_size(size_t sample_count) const;
+
+        // forward transform of one channel, spectrum gets get_fft_size(samples.size()) bins
+        void transform_signal(
+            std::span<const double> samples,
+            kfr::univector<kfr::complex<double> >& spectrum,
+            Workspace& workspace) const;
+
+        // mean |W|^2 of one scale over each frame window [f * hop, f * hop + window) of the first sample_count samples
+        void frame_power(
+            const kfr::univector<kfr::complex<double> >& spectrum,
+            size_t scale,
+            size_t sample_count,
+            size_t window_size,
+            size_t hop_size,
+            std::span<double> power,
+            Workspace& workspace) const;
+
+    private:
+        // wavelet spectra for one (FFT size, hop)
+        struct Plan
+        {
+            struct Scale
+            {
+                size_t first_bin; // first non zero bin of the wavelet spectrum
+                std::vector<double> spectrum; // wavelet spectrum from first_bin on, 1 / fft_size included
+                std::shared_ptr<const kfr::dft_plan<double> > inverse; // power of two length the scale is inverted at
+            };
+
+            std::vector<Scale> scales;
+        };
+
+        double m_sampling_rate;
+        CwtOptions m_options;
+
+        std::vector<double> m_frequencies;
+        std::vector<double> m_variance_weights;
+
+        mutable std::mutex m_cache_mutex;
+        mutable std::map<size_t, std::shared_ptr<const kfr::dft_plan<double> > > m_dfts;
+        mutable std::map<std::pair<size_t, size_t>, std::shared_ptr<const Plan> > m_plans;
+
+        // cached, thread safe
+        [[nodiscard]] std::shared_ptr<const kfr::dft_plan<double> > get_dft(size_t size) const;
+
+        [[nodiscard]] std::shared_ptr<const Plan> get_plan(size_t fft_size, size_t hop_size) const;
+
+        // m_cache_mutex held
+        [[nodiscard]] std::shared_ptr<const kfr::dft_plan<double> > get_dft_locked(size_t size) const;
+
+        [[nodiscard]] double bandwidth(size_t scale) const
+        {
+            return m_frequencies[scale] / m_options.cycles;
+        }
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <data/interface.hpp>
+#include <analysis/frequency_analyzer.hpp>
+#include <analysis/spectral_estimator.hpp>
+
+namespace brainviz::analysis
+{
+    struct MultiResolutionOptions
+    {
+        // cycles of a band's lowest frequency its window should hold, decides how far the band is decimated
+        double min_cycles = 3.0;
+
+        // FFT size of every resolution, 0 is half the analyzer's window
+        size_t fft_size = 0;
+
+        size_t max_decimation = 32; // power of two
+
+        // a band must stay below this share of its decimated nyquist frequency, the rest is the half-band's
+        // transition
+        double nyquist_margin = 0.7;
+    };
+
+    // how one band is analyzed, sizes in raw samples unless noted
+    struct BandResolution
+    {
+        size_t decimation; // power of two
+        size_t fft_size; // in decimated samples
+        size_t window_size; // fft_size * decimation
+        size_t hop_size; // the analyzer's hop * decimation
+    };
+
+    /**
+     * @brief Batch analyzer with a window length per band: long windows for slow bands, short ones for fast bands
+     *
+     * Every band gets the smallest power of two decimation D whose window of fft_size decimated samples holds
+     * min_cycles of the band's lowest frequency, as long as the band still fits below the decimated nyquist.
+     * Bands with the same D share one resolution: the channel is decimated by a cascade of half-band low-passes
+     * (each stage reuses the previous one), and frames of fft_size samples are taken every D hops of the
+     * analyzer's grid. Band powers are rescaled to the periodogram scale of the analyzer's window, so amplitudes
+     * stay comparable across resolutions and with the other analyzers.
+     *
+     * A resolution at decimation D transforms fft_size points every D hops, so all resolutions together cost at
+     * most 2 x (fft_size log fft_size) / (window log window) of the single window path, less than it with the
+     * default half size FFT, plus the half-band stages at a few multiply-adds per raw sample.
+     *
+     * Results are reported on the analyzer's common (window, hop) grid so the query surface and
+     * time_index_to_frame() mean the same as for BatchAnalyzer: a band's value at a common frame is interpolated
+     * linearly between its two nearest native frames, whose centres sit on every D-th common frame. The native
+     * frames of each band and their own time mapping are available too.
+     */
+    class MultiResolutionAnalyzer final : public FrequencyAnalyzer
+    {
+    public:
+        MultiResolutionAnalyzer(
+            const data::EEGData& eeg_data,
+            size_t window_size,
+            double overlap_percentage = 75.0,
+            MultiResolutionOptions options = {});
+
+        // process all channels, channels are spread across worker threads
+        void process_all_channels();
+
+        void process_channel(std::string_view channel_name);
+
+        [[nodiscard]] const BandResolution& get_band_resolution(size_t band) const;
+
+        // native frame of a band whose centre is nearest time_index
+        [[nodiscard]] size_t band_time_index_to_frame(size_t band, size_t time_index) const;
+
+        // centre sample of a native frame of a band
+        [[nodiscard]] size_t band_frame_to_time_index(size_t band, size_t frame) const;
+
+        // a band of a channel on its own frame grid
+        [[nodiscard]] StridedSpan<const double> get_native_band_amplitude(size_t band, ChannelHandle channel) const;
+
+        [[nodiscard]] size_t get_resolution_count() const
+        {
+            return m_resolutions.size();
+        }
+
+        [[nodiscard]] const MultiResolutionOptions& get_options() const
+        {
+            return m_options;
+        }
+
+        void set_band_set(BandSet bands) override;
+
+        [[nodiscard]] const data::EEGData& get_eeg_data() const override
+        {
+            return m_eeg_data;
+        }
+
+    private:
+        struct Resolution
+        {
+            BandResolution shape;
+            std::vector<size_t> bands; // analyzer band indices, in order
+            BandBinTable band_table; // of the bands above at the decimated rate
+            double amplitude_scale; // to the analyzer window's periodogram scale
+            BandTensor native; // [channel][native frame][band of this resolution]
+        };
+
+        const data::EEGData& m_eeg_data;
+        MultiResolutionOptions m_options;
+        size_t m_fft_size;
+
+        std::vector<Resolution> m_resolutions; // by increasing decimation
+        std::vector<size_t> m_band_resolution; // band -> resolution
+        std::vector<size_t> m_band_slot; // band -> index within its resolution
+
+        // pick every band's decimation and group the bands into resolutions
+        void build_resolutions();
+
+        void process_channels(const std::vector<std::string>& channel_names);
+
+        // fill the native frames of every resolution of a prepared channel
+        void analyze_channel(
+            ChannelHandle channel,
+            const std::vector<double>& raw_data,
+            std::span<const std::unique_ptr<SpectralEstimator> > estimators);
+
+        // interpolate the native frames of a channel onto the common grid
+        void resample_channel(ChannelHandle channel);
+
+        // low-pass with a half-band FIR and keep every second sample, edges are extended with the end samples
+        static void decimate_by_two(std::span<const double> input, std::vector<double>& output);
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <kfr/all.hpp>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <analysis/spectral_estimator.hpp>
+
+namespace brainviz::analysis
+{
+    // discrete prolate spheroidal sequences for one (window size, NW, K)
+    struct DpssTapers
+    {
+        size_t window_size = 0;
+        size_t count = 0;
+        std::vector<double> tapers; // [taper][window_size], unit energy
+        std::vector<double> concentrations; // fraction of each taper's energy inside the [-W, W] band
+    };
+
+    /**
+     * @brief Thomson multitaper estimator
+     *
+     * Every frame is multiplied by K orthogonal DPSS tapers and the K periodograms are averaged, which trades a
+     * little frequency resolution (2W) for a K-fold drop in variance. Tapers are computed once per
+     * (window size, NW, K) and shared between estimators through get_tapers.
+     */
+    class MultitaperEstimator final : public SpectralEstimator
+    {
+    public:
+        MultitaperEstimator(
+            size_t window_size,
+            double time_bandwidth = 2.0,
+            size_t taper_count = 0,
+            SpectralAveraging averaging = SpectralAveraging::Mean
+        );
+
+        const kfr::univector<double>& compute(std::span<const double> frame) override;
+
+        [[nodiscard]] const DpssTapers& get_dpss() const
+        {
+            return *m_tapers;
+        }
+
+        // cached DPSS tapers, thread safe
+        [[nodiscard]] static std::shared_ptr<const DpssTapers> get_tapers(
+            size_t window_size,
+            double time_bandwidth,
+            size_t taper_count);
+
+    private:
+        std::shared_ptr<const DpssTapers> m_tapers;
+        SpectralAveraging m_averaging;
+    };
+} // namespace brainviz::analysis
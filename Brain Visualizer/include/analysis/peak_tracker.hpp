@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <analysis/band_set.hpp>
+
+namespace brainviz::analysis
+{
+    struct PeakOptions
+    {
+        // fit a 1/f^exponent aperiodic component to every frame and look for peaks above it instead of in the raw
+        // spectrum, so a band whose spectrum only slopes down has no peak
+        bool fit_aperiodic = false;
+
+        // frequency range of the aperiodic fit
+        double fit_min_freq = 2.0;
+        double fit_max_freq = 40.0;
+    };
+
+    /**
+     * @brief Spectral peak of every band of a frame, with sub-bin frequency
+     *
+     * A band's peak is its highest bin that is a local maximum of the spectrum (its neighbours may lie outside
+     * the band). The frequency and height are refined by fitting a parabola through the log power of the peak
+     * bin and its two neighbours, which is close to exact for the gaussian-like main lobe of a hann window.
+     *
+     * With fit_aperiodic the frame's log power is first fitted with a line over log frequency, dropping the bins
+     * that stick out more than one residual deviation above a first fit (the peaks) before fitting again. Peaks
+     * are then searched in the flattened spectrum and their power is reported above the aperiodic component.
+     *
+     * Bands without a peak report a NaN frequency and 0 power. Keeps a scratch buffer, one tracker per thread.
+     */
+    class PeakTracker
+    {
+    public:
+        // aperiodic values per frame: offset (log10 power at 1 Hz) and exponent
+        static constexpr size_t APERIODIC_COUNT = 2;
+
+        PeakTracker() = default;
+
+        PeakTracker(const BandSet& bands, double sampling_rate, size_t window_size, PeakOptions options = {});
+
+        // peak frequency (Hz) and power of every band of one power spectrum, and the aperiodic fit when enabled
+        // (zeros otherwise)
+        void track(
+            std::span<const double> power_spectrum,
+            std::span<double> frequencies,
+            std::span<double> powers,
+            std::span<double> aperiodic);
+
+        [[nodiscard]] const PeakOptions& get_options() const
+        {
+            return m_options;
+        }
+
+        [[nodiscard]] size_t get_band_count() const
+        {
+            return m_table.get_band_count();
+        }
+
+    private:
+        BandBinTable m_table;
+        PeakOptions m_options;
+        double m_frequency_resolution = 1.0;
+
+        // bins the aperiodic fit runs over, and the bins of every band and their neighbours
+        size_t m_fit_first = 1;
+        size_t m_fit_last = 0;
+        size_t m_first_bin = 0;
+        size_t m_last_bin = 0;
+
+        std::vector<double> m_log_frequency; // log10 of every bin's frequency, bin 0 unused
+        std::vector<double> m_residual; // log10 power, minus the aperiodic fit when enabled
+
+        // offset and exponent of log10 power ~ offset - exponent * log10 f over the fit bins
+        void fit_aperiodic(std::span<const double> power_spectrum, double& offset, double& exponent);
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <kfr/all.hpp>
+#include <span>
+
+#include <analysis/spectral_estimator.hpp>
+
+namespace brainviz::analysis
+{
+    // hann windowed one-sided power spectrum of a single frame
+    // holds the plan and scratch buffers so repeated frames dont allocate
+    class Periodogram final : public SpectralEstimator
+    {
+    public:
+        explicit Periodogram(size_t window_size);
+
+        // frames shorter than the window are zero padded, returns window_size / 2 + 1 bins
+        const kfr::univector<double>& compute(std::span<const double> frame) override;
+
+    private:
+        kfr::univector<double> m_window;
+    };
+} // namespace brainviz::analysis
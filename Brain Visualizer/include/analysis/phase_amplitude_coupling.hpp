@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <tsl/robin_map.h>
+
+#include <data/interface.hpp>
+#include <analysis/hilbert_transform.hpp>
+#include <analysis/iir_filter_bank.hpp>
+
+namespace brainviz::analysis
+{
+    struct PacOptions
+    {
+        // band whose phase modulates, Hz
+        double phase_min_freq = 4.0;
+        double phase_max_freq = 8.0;
+
+        // band whose amplitude is modulated, Hz. should be at least twice the phase band's top wide so the
+        // sidebands of the modulation pass
+        double amplitude_min_freq = 30.0;
+        double amplitude_max_freq = 80.0;
+
+        size_t phase_bins = 18; // 20 degree bins
+        size_t order = 4; // butterworth order of both band-passes, run forward and backward
+
+        // sliding modulation index windows, seconds. a window should hold enough slow cycles to fill every bin
+        double window_seconds = 10.0;
+        double hop_seconds = 1.0;
+    };
+
+    // frequency grids of a comodulogram, band centres from start to stop (inclusive) in steps
+    struct ComodulogramGrid
+    {
+        double phase_start = 2.0;
+        double phase_stop = 14.0;
+        double phase_step = 1.0;
+        double phase_bandwidth = 2.0;
+
+        double amplitude_start = 20.0;
+        double amplitude_stop = 120.0;
+        double amplitude_step = 5.0;
+        double amplitude_bandwidth = 0.0; // 0 is twice the highest phase frequency
+    };
+
+    struct Comodulogram
+    {
+        std::vector<double> phase_freqs;
+        std::vector<double> amplitude_freqs;
+        std::vector<double> modulation_index; // [phase][amplitude]
+
+        [[nodiscard]] double at(const size_t phase, const size_t amplitude) const
+        {
+            return modulation_index[phase * amplitude_freqs.size() + amplitude];
+        }
+    };
+
+    /**
+     * @brief Phase-amplitude coupling as the Tort modulation index, per channel over sliding windows
+     *
+     * Each channel is band passed into the phase and the amplitude band (zero phase, shared cached designs) and
+     * turned into an analytic signal, giving the instantaneous phase of the slow band and the envelope of the fast
+     * one. The mean envelope in each of phase_bins phase bins forms a distribution P, and the index is its
+     * normalized distance from uniform, (log N - H(P)) / log N: 0 without coupling, 1 if all amplitude sits in one
+     * bin. Windows merge per block sums of gcd(window, hop) samples, so overlapping windows dont re-read samples.
+     *
+     * Channels are filtered IirFilterBank::LANES at a time and the groups run in parallel. A comodulogram filters
+     * every phase and every amplitude frequency of the grid once and then runs the (phase, amplitude) cells in
+     * parallel, so its cost is (phase + amplitude) filter passes plus one cheap pass per cell.
+     */
+    class PacEngine
+    {
+    public:
+        PacEngine(const data::EEGData& eeg_data, PacOptions options = {});
+
+        void process_all_channels();
+
+        void process_channel(std::string_view channel_name);
+
+        // modulation index of each window of a processed channel
+        [[nodiscard]] std::span<const double> get_modulation_index(std::string_view channel_name) const;
+
+        // over samples [first_sample, first_sample + sample_count) of a channel, the whole channel by default
+        [[nodiscard]] Comodulogram compute_comodulogram(
+            std::string_view channel_name,
+            const ComodulogramGrid& grid = {},
+            size_t first_sample = 0,
+            size_t sample_count = std::numeric_limits<size_t>::max()) const;
+
+        [[nodiscard]] const PacOptions& get_options() const
+        {
+            return m_options;
+        }
+
+        // window and hop in samples
+        [[nodiscard]] size_t get_window_size() const
+        {
+            return m_window_size;
+        }
+
+        [[nodiscard]] size_t get_hop_size() const
+        {
+            return m_hop_size;
+        }
+
+        // first sample of a window
+        [[nodiscard]] size_t get_window_start(const size_t window) const
+        {
+            return window * m_hop_size;
+        }
+
+        // tort modulation index of mean amplitudes per phase bin
+        [[nodiscard]] static double modulation_index(std::span<const double> bin_amplitudes);
+
+    private:
+        const data::EEGData& m_eeg_data;
+        PacOptions m_options;
+        double m_sampling_rate;
+
+        size_t m_window_size;
+        size_t m_hop_size;
+
+        std::shared_ptr<const std::vector<Biquad> > m_phase_filter;
+        std::shared_ptr<const std::vector<Biquad> > m_amplitude_filter;
+
+        HilbertTransform m_hilbert;
+
+        tsl::robin_map<std::string, std::vector<double> > m_modulation_index;
+
+        void process_channels(const std::vector<std::string>& channel_names);
+    };
+} // namespace brainviz::analysis
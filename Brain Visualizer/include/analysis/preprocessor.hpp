@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <tsl/robin_map.h>
+
+#include <data/interface.hpp>
+#include <analysis/iir_filter_bank.hpp>
+
+namespace brainviz::analysis
+{
+    enum class Reference
+    {
+        None, // keep the recording reference
+        CommonAverage, // subtract the mean of all channels
+        LinkedMastoids // subtract the mean of the two mastoid channels
+    };
+
+    struct PreprocessingOptions
+    {
+        double line_frequency = 50.0; // mains, Hz, 0 disables the notch
+        size_t line_harmonics = 3; // notch the mains and its harmonics up to this multiple (below nyquist)
+        double notch_quality = 30.0;
+
+        double high_pass = 0.5; // detrending cutoff, Hz, 0 disables
+        size_t high_pass_order = 2;
+
+        Reference reference = Reference::None;
+        std::array<std::string, 2> mastoid_channels = {"M1", "M2"};
+    };
+
+    /**
+     * @brief Cleans raw channels before analysis: mains notch, high-pass detrend and re-reference
+     *
+     * All three stages work in place on the channels of an EEGData. The filters run IirFilterBank::LANES channels
+     * at a time through run_cascade; re-referencing walks each channel contiguously against a shared reference
+     * row. process() treats the data as one recording, process_block() carries the filter state of each channel
+     * over from the previous block so a stream comes out the same as the recording it was cut from.
+     *
+     * The wall time and sample count of every stage is accumulated and can be read back with get_stage_costs().
+     */
+    class Preprocessor
+    {
+    public:
+        struct StageCost
+        {
+            std::string_view name;
+            double seconds = 0.0;
+            size_t samples = 0; // channel samples processed
+
+            [[nodiscard]] double get_ns_per_sample() const
+            {
+                return samples > 0 ? seconds * 1e9 / static_cast<double>(samples) : 0.0;
+            }
+        };
+
+        Preprocessor(double sampling_rate, PreprocessingOptions options = {});
+
+        // whole recording, filter state starts from zero
+        void process(data::EEGData& data);
+
+        // next block of a stream, filter state continues from the previous block of each channel
+        void process_block(data::EEGData& block);
+
+        // forget the filter state of every stream channel
+        void reset();
+
+        [[nodiscard]] const PreprocessingOptions& get_options() const
+        {
+            return m_options;
+        }
+
+        // notch, high-pass, re-reference
+        [[nodiscard]] const std::array<StageCost, 3>& get_stage_costs() const
+        {
+            return m_stage_costs;
+        }
+
+        void reset_stage_costs();
+
+    private:
+        double m_sampling_rate;
+        PreprocessingOptions m_options;
+
+        std::shared_ptr<const std::vector<Biquad> > m_notch;
+        std::shared_ptr<const std::vector<Biquad> > m_high_pass;
+
+        // per stream channel filter state, [section][z1, z2], notch sections first
+        tsl::robin_map<std::string, std::vector<double> > m_stream_state;
+
+        std::array<StageCost, 3> m_stage_costs;
+
+        // filter the channels through one stage, state is per channel and null for a fresh start
+        void run_filter_stage(
+            size_t stage,
+            const std::vector<Biquad>& sections,
+            size_t state_offset,
+            std::span<std::vector<double>* const> channels,
+            std::span<std::vector<double>* const> states);
+
+        void rereference(std::span<std::vector<double>* const> channels, std::span<const std::string> names);
+
+        void run(data::EEGData& data, bool stream);
+    };
+} // namespace brainviz::analysis
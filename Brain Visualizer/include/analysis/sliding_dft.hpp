@@ -0,0 +1,85 @@
+#pragma once
+
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <analysis/band_set.hpp>
+
+namespace brainviz::analysis
+{
+    /**
+     * @brief Bank of recursive sliding DFT filters restricted to the in-band bins
+     *
+     * Every pushed sample updates only the DFT bins that fall inside the bands of the BandBinTable it
+     * is built from (plus one neighbour on each side, needed to apply the hann window in the frequency domain),
+     * so a sample costs O(bins) instead of a full FFT per frame. State is laid out [bin][channel]
+     * and the per-sample update runs over contiguous channels, which the compiler vectorizes.
+     *
+     * A damping factor slightly below one keeps the recursion from accumulating rounding error
+     * over long sessions.
+     */
+    class SlidingDftBank
+    {
+    public:
+        // empty bank without bands or channels, for analyzers that run another engine
+        SlidingDftBank() = default;
+
+        SlidingDftBank(const BandBinTable& bands, size_t window_size, double damping = 0.9999999);
+
+        // add a channel slot, returns its index
+        size_t add_channel();
+
+        [[nodiscard]] size_t get_channel_count() const
+        {
+            return m_channels;
+        }
+
+        [[nodiscard]] size_t get_bin_count() const
+        {
+            return m_bins.size();
+        }
+
+        // push one sample for every channel at once, samples[slot]
+        void push(std::span<const double> samples);
+
+        // push one sample for a single channel
+        void push_channel(size_t slot, double sample);
+
+        [[nodiscard]] size_t get_band_count() const
+        {
+            return m_band_slots.size();
+        }
+
+        // periodic hann windowed band amplitudes over the last window_size samples of a channel, the same window and
+        // scale as the FFT path (see periodic_hann)
+        void band_amplitudes(size_t slot, std::span<double> amplitudes) const;
+
+    private:
+        size_t m_window_size = 0;
+        size_t m_channels = 0;
+        double m_damping = 1.0;
+        double m_damping_n = 1.0; // damping ^ window_size, applied to the sample leaving the window
+
+        // absolute DFT bin of each tracked slot
+        std::vector<size_t> m_bins;
+        std::vector<double> m_cos;
+        std::vector<double> m_sin;
+
+        // [first, last] tracked slot of each band, hann needs one slot of margin on each side
+        std::vector<std::pair<size_t, size_t> > m_band_slots;
+        std::vector<bool> m_band_empty;
+
+        // [bin][channel]
+        std::vector<double> m_real;
+        std::vector<double> m_imag;
+
+        // circular delay line [channel][sample], plus a per channel write position
+        std::vector<double> m_delay;
+        std::vector<size_t> m_delay_pos;
+
+        std::vector<double> m_delta; // scratch for push()
+
+        void resize_channels(size_t channels);
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <kfr/all.hpp>
+#include <memory>
+#include <span>
+
+namespace brainviz::analysis
+{
+    enum class SpectralMethod
+    {
+        Periodogram, // single hann window over the whole frame
+        Welch, // averaged, overlapping hann segments
+        Multitaper, // averaged DPSS (slepian) tapers
+        Burg // autoregressive model fit to the newest part of the frame, fine resolution from short segments
+    };
+
+    enum class SpectralAveraging
+    {
+        Mean,
+        Median, // robust to a single corrupted segment/taper, bias corrected
+        EigenvalueWeighted // multitaper only, weights each taper by its concentration, welch treats it as mean
+    };
+
+    struct SpectralOptions
+    {
+        SpectralMethod method = SpectralMethod::Periodogram;
+        SpectralAveraging averaging = SpectralAveraging::Mean;
+
+        // welch, 0 picks half the window
+        size_t welch_segment_size = 0;
+        double welch_overlap_percentage = 50.0;
+
+        // multitaper, 0 tapers picks 2NW - 1
+        double time_bandwidth = 2.0;
+        size_t taper_count = 0;
+
+        // burg, 0 segment picks a quarter of the window, 0 order picks a quarter of the segment (at most 16)
+        size_t burg_segment_size = 0;
+        size_t ar_order = 0;
+    };
+
+    // periodic hann, 0.5 - 0.5 cos(2 pi i / size). the sliding DFT can only apply this one (as a 3 tap kernel over
+    // its bins), so every FFT path uses it too instead of kfr's symmetric window_hann and the engines agree
+    [[nodiscard]] kfr::univector<double> periodic_hann(size_t size);
+
+    /**
+     * @brief Turns one frame of samples into a one-sided power spectrum
+     *
+     * Every estimator returns window_size / 2 + 1 bins on the same grid and rescales its tapers to the energy
+     * of a full length hann window, so band amplitudes stay comparable whichever method is picked.
+     *
+     * Estimators that need several tapered copies of a frame write them as rows of one contiguous batch and
+     * transform them together, two real rows packed into each complex FFT.
+     */
+    class SpectralEstimator
+    {
+    public:
+        explicit SpectralEstimator(size_t window_size);
+
+        SpectralEstimator(const SpectralEstimator&) = delete;
+
+        SpectralEstimator& operator=(const SpectralEstimator&) = delete;
+
+        virtual ~SpectralEstimator() = default;
+
+        // frames shorter than the window are zero padded
+        virtual const kfr::univector<double>& compute(std::span<const double> frame) = 0;
+
+        [[nodiscard]] size_t get_window_size() const
+        {
+            return m_window_size;
+        }
+
+        [[nodiscard]] size_t get_bin_count() const
+        {
+            return m_window_size / 2 + 1;
+        }
+
+    protected:
+        size_t m_window_size;
+
+        // sum of squares of the full length hann window, the common scale of all estimators
+        double m_reference_energy;
+
+        kfr::univector<double> m_power_spectrum;
+
+        // [row][window_size] tapered real input, filled by the estimator before transform_batch
+        kfr::univector<double> m_batch;
+
+        // [row][bins] power of each row after transform_batch
+        kfr::univector<double> m_batch_power;
+
+        void reserve_batch(size_t rows);
+
+        // transform the first `rows` rows of m_batch into m_batch_power
+        void transform_batch(size_t rows);
+
+        // combine the rows of m_batch_power into m_power_spectrum
+        void average_batch(size_t rows, SpectralAveraging averaging, std::span<const double> weights, double scale);
+
+    private:
+        kfr::dft_plan<double> m_dft;
+        kfr::univector<uint8_t> m_temp;
+        kfr::univector<kfr::complex<double> > m_input;
+        kfr::univector<kfr::complex<double> > m_output;
+        kfr::univector<double> m_scratch; // median
+    };
+
+    [[nodiscard]] std::unique_ptr<SpectralEstimator> make_spectral_estimator(
+        size_t window_size,
+        const SpectralOptions& options);
+} // namespace brainviz::analysis
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <utils/mapped_buffer.hpp>
+#include <analysis/band_tensor.hpp>
+
+namespace brainviz::analysis
+{
+    enum class SpectrogramFormat
+    {
+        Float32, // power as float, exact to float precision
+        LogQuantized16 // log10(power) quantized to 16 bits, half the size, ~0.1% relative error over the default range
+    };
+
+    struct SpectrogramOptions
+    {
+        SpectrogramFormat format = SpectrogramFormat::Float32;
+
+        // log10(power) range the 16 bit codes span, power at or below 10^log_floor reads back as 0
+        double log_floor = -12.0;
+        double log_ceiling = 12.0;
+
+        // scratch file backing the mapping so the OS can page it out, empty keeps it in anonymous memory
+        std::filesystem::path backing_file;
+    };
+
+    /**
+     * @brief One-sided power spectrum of every frame and channel, [channel][frame][bin]
+     *
+     * Filled by an analyzer in STFT mode as frames are computed, and read back to draw spectrograms or to reduce
+     * the spectra into a different band set without going back to the raw samples. Storage is a single
+     * MappedBuffer; each channel owns a block of frame_capacity frames like BandTensor does.
+     *
+     * Writing different frames from different threads is safe, reserve() is not.
+     */
+    class SpectrogramStore
+    {
+    public:
+        SpectrogramStore() = default;
+
+        SpectrogramStore(size_t bin_count, SpectrogramOptions options);
+
+        // make room for at least this many channels and frames per channel, stored frames are kept
+        void reserve(size_t channels, size_t frames);
+
+        // number of valid frames of a channel, must fit the reserved capacity
+        void set_frame_count(ChannelHandle channel, size_t frames);
+
+        [[nodiscard]] size_t get_bin_count() const
+        {
+            return m_bin_count;
+        }
+
+        [[nodiscard]] size_t get_channel_count() const
+        {
+            return m_frame_counts.size();
+        }
+
+        [[nodiscard]] size_t get_frame_capacity() const
+        {
+            return m_frame_capacity;
+        }
+
+        [[nodiscard]] size_t get_frame_count(const ChannelHandle channel) const
+        {
+            return channel < m_frame_counts.size() ? m_frame_counts[channel] : 0;
+        }
+
+        [[nodiscard]] const SpectrogramOptions& get_options() const
+        {
+            return m_options;
+        }
+
+        // bytes the store has mapped
+        [[nodiscard]] size_t get_byte_size() const
+        {
+            return m_buffer.size();
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return m_frame_counts.empty();
+        }
+
+        // power spectrum of one frame, power.size() bins starting at bin 0
+        void write_frame(ChannelHandle channel, size_t frame, std::span<const double> power);
+
+        // decode out.size() bins of a frame starting at first_bin
+        void read_frame(ChannelHandle channel, size_t frame, std::span<double> out, size_t first_bin = 0) const;
+
+        void read_frame(ChannelHandle channel, size_t frame, std::span<float> out, size_t first_bin = 0) const;
+
+    private:
+        size_t m_bin_count = 0;
+        size_t m_frame_capacity = 0;
+        std::vector<size_t> m_frame_counts;
+
+        SpectrogramOptions m_options;
+        double m_code_scale = 0.0; // codes per decade
+
+        utils::MappedBuffer m_buffer;
+
+        [[nodiscard]] size_t element_size() const
+        {
+            return m_options.format == SpectrogramFormat::Float32 ? sizeof(float) : sizeof(std::uint16_t);
+        }
+
+        [[nodiscard]] size_t offset(const ChannelHandle channel, const size_t frame) const
+        {
+            return (channel * m_frame_capacity + frame) * m_bin_count;
+        }
+
+        template <typename T>
+        void decode(ChannelHandle channel, size_t frame, std::span<T> out, size_t first_bin) const;
+    };
+} // namespace brainviz::analysis
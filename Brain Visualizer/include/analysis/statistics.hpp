@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <tsl/robin_map.h>
+
+#include <data/interface.hpp>
+
+namespace brainviz::analysis
+{
+    class FrequencyAnalyzer;
+
+    /**
+     * @brief Count, mean, variance and extremes in one pass (Welford), mergeable across threads (Chan et al.)
+     *
+     * The running mean and the sum of squared deviations are updated per value, so the variance doesnt suffer
+     * the cancellation of sum(x^2) - n mean^2 on signals with a large offset.
+     */
+    class RunningStats
+    {
+    public:
+        void push(const double value)
+        {
+            ++m_count;
+
+            const double delta = value - m_mean;
+            m_mean += delta / static_cast<double>(m_count);
+            m_m2 += delta * (value - m_mean);
+
+            m_min = std::min(m_min, value);
+            m_max = std::max(m_max, value);
+        }
+
+        void push(std::span<const double> values);
+
+        // fold in stats of other values, as if they had been pushed here
+        void merge(const RunningStats& other);
+
+        [[nodiscard]] size_t get_count() const
+        {
+            return m_count;
+        }
+
+        [[nodiscard]] double get_mean() const
+        {
+            return m_mean;
+        }
+
+        // population variance, 0 for fewer than two values
+        [[nodiscard]] double get_variance() const
+        {
+            return m_count > 1 ? m_m2 / static_cast<double>(m_count) : 0.0;
+        }
+
+        [[nodiscard]] double get_stddev() const
+        {
+            return std::sqrt(get_variance());
+        }
+
+        [[nodiscard]] double get_rms() const
+        {
+            return std::sqrt(get_variance() + m_mean * m_mean);
+        }
+
+        // +inf / -inf while empty
+        [[nodiscard]] double get_min() const
+        {
+            return m_min;
+        }
+
+        [[nodiscard]] double get_max() const
+        {
+            return m_max;
+        }
+
+        // distance from the mean in standard deviations, 0 without spread
+        [[nodiscard]] double z_score(const double value) const
+        {
+            const double stddev = get_stddev();
+            return stddev > 0.0 ? (value - m_mean) / stddev : 0.0;
+        }
+
+    private:
+        size_t m_count = 0;
+        double m_mean = 0.0;
+        double m_m2 = 0.0; // sum of squared deviations from the mean
+        double m_min = std::numeric_limits<double>::infinity();
+        double m_max = -std::numeric_limits<double>::infinity();
+    };
+
+    /**
+     * @brief Approximate quantiles of a stream in bounded memory, a merging t-digest
+     *
+     * Values are buffered and periodically merged into a sorted list of centroids (mean, weight). The arcsine scale
+     * function lets centroids near the median grow large while those at the tails stay small, so the error is
+     * smallest for extreme percentiles, which are what auto-scaling reads. Memory is O(compression), and digests of
+     * separate chunks merge into one with about the same accuracy as a single pass.
+     */
+    class QuantileSketch
+    {
+    public:
+        explicit QuantileSketch(double compression = 100.0);
+
+        void push(double value);
+
+        void push(std::span<const double> values);
+
+        void merge(const QuantileSketch& other);
+
+        // merge the buffered values into the centroids, quantile() is cheaper afterwards
+        void flush();
+
+        // value below which a fraction q of the values fall, NaN while empty
+        [[nodiscard]] double quantile(double q) const;
+
+        [[nodiscard]] double get_total_weight() const
+        {
+            return m_merged_weight + m_buffer_weight;
+        }
+
+        [[nodiscard]] size_t get_centroid_count() const
+        {
+            return m_centroids.size();
+        }
+
+    private:
+        struct Centroid
+        {
+            double mean;
+            double weight;
+        };
+
+        double m_compression;
+
+        std::vector<Centroid> m_centroids; // sorted by mean
+        double m_merged_weight = 0.0;
+
+        std::vector<Centroid> m_buffer; // not merged yet
+        double m_buffer_weight = 0.0;
+
+        double m_min = std::numeric_limits<double>::infinity();
+        double m_max = -std::numeric_limits<double>::infinity();
+
+        [[nodiscard]] size_t buffer_limit() const;
+
+        // merge sorted centroids of total weight into as few as the scale function allows
+        static void compress(std::vector<Centroid>& centroids, double total_weight, double compression);
+    };
+
+    // moments and quantiles of one series
+    struct SummaryStatistics
+    {
+        RunningStats moments;
+        QuantileSketch quantiles;
+
+        void push(std::span<const double> values)
+        {
+            moments.push(values);
+            quantiles.push(values);
+        }
+
+        void merge(const SummaryStatistics& other)
+        {
+            moments.merge(other.moments);
+            quantiles.merge(other.quantiles);
+        }
+    };
+
+    /**
+     * @brief Per channel statistics of the raw samples and per band statistics of an analyzer's frames
+     *
+     * Everything accumulates: adding more samples or frames of the same channel updates its statistics without
+     * revisiting what was added before, so a recording can be summarized block by block as it streams in. Sample
+     * chunks of every channel are summarized in parallel and merged in order, so the result doesnt depend on the
+     * thread count.
+     */
+    class ChannelStatistics
+    {
+    public:
+        // samples summarized per task, each gets its own digest before the merge
+        static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+        explicit ChannelStatistics(double compression = 100.0);
+
+        // every channel of a recording
+        void add_samples(const data::EEGData& eeg_data);
+
+        void add_samples(std::string_view channel_name, std::span<const double> samples);
+
+        // band amplitudes of frames [first_frame, first_frame + frame_count) of every analyzed channel. artifact
+        // frames and frames an on demand analyzer hasnt computed yet are left out
+        void add_bands(
+            const FrequencyAnalyzer& analyzer,
+            size_t first_frame = 0,
+            size_t frame_count = std::numeric_limits<size_t>::max());
+
+        [[nodiscard]] bool has_channel(std::string_view channel_name) const;
+
+        // throws if no samples of the channel were added
+        [[nodiscard]] const SummaryStatistics& get_channel(std::string_view channel_name) const;
+
+        // throws if no frames of the channel were added, band in the analyzer's band set order
+        [[nodiscard]] const SummaryStatistics& get_band(std::string_view channel_name, size_t band_index) const;
+
+        void clear();
+
+    private:
+        double m_compression;
+
+        tsl::robin_map<std::string, SummaryStatistics> m_channels;
+        tsl::robin_map<std::string, std::vector<SummaryStatistics> > m_bands; // [band] per channel
+    };
+} // namespace brainviz::analysis
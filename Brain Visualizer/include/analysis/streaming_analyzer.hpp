@@ -0,0 +1,168 @@
+#pragma once
+
+#include <kfr/all.hpp>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <data/interface.hpp>
+#include <analysis/frequency_analyzer.hpp>
+#include <analysis/spectral_estimator.hpp>
+#include <analysis/sliding_dft.hpp>
+#include <analysis/iir_filter_bank.hpp>
+#include <analysis/preprocessor.hpp>
+
+namespace brainviz::analysis
+{
+    // how the streaming analyzer turns samples into band amplitudes
+    enum class BandPowerEngine
+    {
+        Fft, // spectral estimator (periodogram by default) over the whole window once per hop
+        SlidingDft, // recursive in-band DFT bins updated every sample, cheap enough for a hop of 1
+        FilterBank // IIR band-pass per band stepped every sample, amplitude from the RMS envelope over the window
+    };
+
+    /**
+     * @brief Incremental band analyzer for live data
+     *
+     * Samples are pushed in blocks as they arrive. Each channel keeps the raw samples of its
+     * retained frames plus the pending tail, and a new frame is emitted as soon as a full hop
+     * has arrived, so the latency is one hop plus one FFT. Only the newest history_frames
+     * frames are kept; older frames and the raw samples behind them are dropped.
+     *
+     * With the sliding DFT engine every sample updates a bank of in-band DFT bins and a frame
+     * is just a readout of that bank, so the hop can be made very small for smooth live traces. The filter bank
+     * engine works the same way with causal band-pass filters and a running window of squared outputs.
+     *
+     * Frame and time indices are relative to the oldest retained frame, which makes the
+     * retained history look exactly like a BatchAnalyzer run over get_eeg_data().
+     *
+     * With preprocessing enabled every block goes through Preprocessor::process_block() before it is
+     * retained or analyzed, so the history holds the cleaned samples.
+     */
+    class StreamingAnalyzer final : public FrequencyAnalyzer
+    {
+    public:
+        StreamingAnalyzer(
+            double sampling_rate,
+            size_t window_size,
+            double overlap_percentage = 75.0,
+            size_t history_frames = 1024,
+            BandPowerEngine engine = BandPowerEngine::Fft
+        );
+
+        // append a block holding new samples for one or more channels, returns the number of new frames
+        size_t push_block(const data::EEGData& block);
+
+        // append new samples for a single channel, returns the number of new frames
+        size_t push_samples(std::string_view channel_name, std::span<const double> samples);
+
+        // notch, high-pass and re-reference every block pushed from now on, the filter state of each channel carries
+        // over between blocks. re-referencing needs every channel in one block, so push_samples() throws if the
+        // options re-reference
+        void enable_preprocessing(PreprocessingOptions options = {});
+
+        void disable_preprocessing();
+
+        // null while preprocessing is off, the stage costs accumulate over every preprocessed block
+        [[nodiscard]] const Preprocessor* get_preprocessor() const
+        {
+            return m_preprocessor ? &*m_preprocessor : nullptr;
+        }
+
+        // retained samples, sample 0 is the start of the oldest retained frame
+        [[nodiscard]] const data::EEGData& get_eeg_data() const override
+        {
+            return m_history;
+        }
+
+        void set_spectral_options(const SpectralOptions& options) override;
+
+        // only allowed before the first push, the bands of past frames cant be recomputed
+        void set_band_set(BandSet bands) override;
+
+        [[nodiscard]] size_t get_history_frames() const
+        {
+            return m_history_frames;
+        }
+
+        [[nodiscard]] BandPowerEngine get_engine() const
+        {
+            return m_engine;
+        }
+
+        // number of frames that have been dropped from the front of a channel's history
+        [[nodiscard]] size_t get_dropped_frames(std::string_view channel_name) const;
+
+    private:
+        // per channel bookkeeping, indexed by ChannelHandle
+        struct ChannelState
+        {
+            size_t next_frame_start = 0; // offset of the next frame into the retained samples
+            size_t dropped_frames = 0;
+
+            // sliding DFT and filter bank only
+            size_t slot = 0; // column in the bank
+            size_t fed = 0; // offset of the next retained sample the bank hasnt seen
+            size_t envelope_pos = 0; // write position in the channel's envelope ring
+        };
+
+        size_t m_history_frames;
+
+        // history is only compacted once it overshoots by this many frames, keeps trimming amortized
+        size_t m_trim_slack;
+
+        BandPowerEngine m_engine;
+
+        data::EEGData m_history;
+        std::vector<ChannelState> m_channels;
+        std::unique_ptr<SpectralEstimator> m_estimator;
+        std::optional<Preprocessor> m_preprocessor;
+
+        // only the bank of the selected engine is built, the other stays empty
+        SlidingDftBank m_sliding_dft;
+        IirFilterBank m_filter_bank;
+        std::vector<double> m_slot_samples; // one sample per bank slot, scratch for the vectorized path
+
+        // filter bank only: squared band outputs of the last window, [slot][band][window] rings
+        std::vector<double> m_envelope;
+        double m_variance_scale;
+
+        // (re)build the bank of the selected engine for the current bands
+        void build_engine();
+
+        ChannelHandle get_or_add_channel(const std::string& name);
+
+        // push_block() and push_samples() once the samples are preprocessed
+        size_t analyze_block(const data::EEGData& block);
+
+        size_t analyze_samples(std::string_view channel_name, std::span<const double> samples);
+
+        // emit every frame whose window is complete, FFT engine
+        size_t emit_fft_frames(ChannelHandle channel, const std::vector<double>& samples);
+
+        // feed the bank the samples it hasnt seen and emit completed frames, sliding DFT and filter bank engines
+        size_t emit_bank_frames(ChannelHandle channel, const std::vector<double>& samples);
+
+        // push one sample per bank slot, or one sample of one channel
+        void push_bank();
+
+        void push_bank_channel(ChannelHandle channel, double sample);
+
+        // record the filter bank's latest outputs of a channel in its envelope ring
+        void record_envelope(ChannelHandle channel);
+
+        // read the bank out into a new frame if the channel just completed a window
+        bool emit_bank_frame_if_ready(ChannelHandle channel);
+
+        // flag the frames a push added, samples are the channel's retained samples
+        void detect_new_artifacts(ChannelHandle channel, const std::vector<double>& samples, size_t first_new_frame);
+
+        void finish_push(ChannelHandle channel, std::vector<double>& samples);
+
+        void trim_history(ChannelHandle channel, std::vector<double>& samples);
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <electrode/electrode.hpp>
+
+namespace brainviz::analysis
+{
+    struct TopographyOptions
+    {
+        size_t spline_order = 4; // m of the perrin spline, higher is smoother
+        size_t legendre_terms = 50;
+        double regularization = 1e-5; // added to the spline matrix diagonal, 0 interpolates exactly
+
+        // head circle radius in units of the equator's, where the renderer puts electrodes below the equator.
+        // 1.2 like the app's head outline, 1 leaves just the upper hemisphere
+        double rim_radius = 1.2;
+    };
+
+    /**
+     * @brief Spherical-spline scalp map onto a fixed pixel grid
+     *
+     * Pixels cover the head from above the same way the electrode renderer places electrodes: x = sin(inclination)
+     * cos(azimuth), y = sin(inclination) sin(azimuth) with +y up, so the unit disk is the upper hemisphere. The
+     * renderer moves electrodes below the equator onto the head circle instead of folding them back inside, so the
+     * ring from the unit disk out to rim_radius unfolds the sphere from the equator down to the lowest electrode
+     * and they land where they are drawn. The image spans [-rim_radius, rim_radius], pixels outside the head
+     * circle are left at 0. The spline system (Perrin et al.) is solved once for the montage and folded with
+     * the spline kernel of every pixel into a single [channel][pixel] matrix, so a frame is one matrix-vector
+     * product: each channel's column is scaled and added to the image, which vectorizes without reordering sums,
+     * and the pixel rows are split across threads.
+     */
+    class TopographicMap
+    {
+    public:
+        TopographicMap(
+            std::span<const electrode::Electrode> electrodes,
+            size_t width,
+            size_t height,
+            TopographyOptions options = {});
+
+        // values[electrode] in the constructor's electrode order, image[row][column] of width x height
+        void interpolate(std::span<const float> values, std::span<float> image) const;
+
+        [[nodiscard]] std::vector<float> interpolate(std::span<const float> values) const;
+
+        [[nodiscard]] size_t get_width() const
+        {
+            return m_width;
+        }
+
+        [[nodiscard]] size_t get_height() const
+        {
+            return m_height;
+        }
+
+        [[nodiscard]] size_t get_channel_count() const
+        {
+            return m_channels;
+        }
+
+        // 1 for pixels on the head, [row][column]
+        [[nodiscard]] std::span<const std::uint8_t> get_mask() const
+        {
+            return m_mask;
+        }
+
+    private:
+        size_t m_width;
+        size_t m_height;
+        size_t m_channels;
+
+        std::vector<std::uint8_t> m_mask;
+        std::vector<size_t> m_pixels; // image index of every head pixel
+
+        // [channel][head pixel] weights
+        std::vector<float> m_weights;
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <analysis/band_tensor.hpp>
+
+namespace brainviz::analysis
+{
+    class FrequencyAnalyzer;
+
+    /**
+     * @brief Radius and alpha of every band of the band set for a run of frames and every channel, baked once
+     *
+     * Stored as floats laid out [frame][channel][band], bands in band set order, so everything the renderer needs
+     * to advance one frame is a single contiguous block per table instead of a per electrode get_visualization_info()
+     * call. Values are exactly what get_visualization_info() returns for the same frame; channels that dont reach a
+     * frame get zeros, like get_visualization_info() does. Artifact frames are baked as zeros and flagged so the
+     * renderer can hold the last clean frame instead.
+     *
+     * A table covers frames [get_first_frame(), get_first_frame() + get_frame_count()), accessors take the absolute
+     * frame index. The whole recording is one table, LazyAnalyzer keeps one per analyzed block.
+     */
+    class VisualizationTable
+    {
+    public:
+        VisualizationTable() = default;
+
+        // bake frames [0, get_max_frame_index()] of every channel, frames are filled in parallel
+        explicit VisualizationTable(const FrequencyAnalyzer& analyzer);
+
+        // bake frames [first_frame, first_frame + frame_count) of every channel
+        VisualizationTable(const FrequencyAnalyzer& analyzer, size_t first_frame, size_t frame_count);
+
+        [[nodiscard]] bool empty() const
+        {
+            return m_frame_count == 0;
+        }
+
+        [[nodiscard]] bool contains(const size_t frame) const
+        {
+            return frame >= m_first_frame && frame - m_first_frame < m_frame_count;
+        }
+
+        [[nodiscard]] size_t get_first_frame() const
+        {
+            return m_first_frame;
+        }
+
+        [[nodiscard]] size_t get_frame_count() const
+        {
+            return m_frame_count;
+        }
+
+        [[nodiscard]] size_t get_channel_count() const
+        {
+            return m_channel_count;
+        }
+
+        [[nodiscard]] size_t get_band_count() const
+        {
+            return m_band_count;
+        }
+
+        // [channel][band] of one frame
+        [[nodiscard]] std::span<const float> radii(const size_t frame) const
+        {
+            return {m_radii.data() + offset(frame, 0), m_channel_count * m_band_count};
+        }
+
+        [[nodiscard]] std::span<const float> alphas(const size_t frame) const
+        {
+            return {m_alphas.data() + offset(frame, 0), m_channel_count * m_band_count};
+        }
+
+        // every band of one channel at one frame
+        [[nodiscard]] std::span<const float> radii(const size_t frame, const ChannelHandle channel) const
+        {
+            return {m_radii.data() + offset(frame, channel), m_band_count};
+        }
+
+        [[nodiscard]] std::span<const float> alphas(const size_t frame, const ChannelHandle channel) const
+        {
+            return {m_alphas.data() + offset(frame, channel), m_band_count};
+        }
+
+        [[nodiscard]] bool is_artifact(const size_t frame, const ChannelHandle channel) const
+        {
+            return m_artifacts[(frame - m_first_frame) * m_channel_count + channel] != 0;
+        }
+
+    private:
+        size_t m_first_frame = 0;
+        size_t m_frame_count = 0;
+        size_t m_channel_count = 0;
+        size_t m_band_count = 0;
+
+        std::vector<float> m_radii;
+        std::vector<float> m_alphas;
+        std::vector<std::uint8_t> m_artifacts; // [frame][channel]
+
+        [[nodiscard]] size_t offset(const size_t frame, const ChannelHandle channel) const
+        {
+            return ((frame - m_first_frame) * m_channel_count + channel) * m_band_count;
+        }
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <data/interface.hpp>
+#include <analysis/frequency_analyzer.hpp>
+#include <analysis/morlet_cwt.hpp>
+
+namespace brainviz::analysis
+{
+    /**
+     * @brief Batch analyzer that gets band amplitudes from a Morlet CWT instead of windowed FFTs
+     *
+     * Every scale has a time resolution matched to its frequency, so delta is not smeared by a window tuned for
+     * gamma and gamma bursts are not averaged over a window sized for delta. The frame grid (window, hop) is the
+     * same as BatchAnalyzer's so the UI and the frame indices are unchanged: a frame's band power is the mean
+     * |W|^2 inside the frame window, summed over the scales whose frequency lies in the band and scaled to the
+     * periodogram's units, so amplitudes are comparable with the FFT path.
+     *
+     * Work is spread over channels and, when there are fewer channels than workers, over scales as well.
+     */
+    class WaveletAnalyzer final : public FrequencyAnalyzer
+    {
+    public:
+        WaveletAnalyzer(
+            const data::EEGData& eeg_data,
+            size_t window_size,
+            double overlap_percentage = 75.0,
+            CwtOptions options = {}
+        );
+
+        // process all channels
+        void process_all_channels();
+
+        // Process a specific channel
+        void process_channel(std::string_view channel_name);
+
+        [[nodiscard]] const MorletCwt& get_cwt() const
+        {
+            return m_cwt;
+        }
+
+        [[nodiscard]] const data::EEGData& get_eeg_data() const override
+        {
+            return m_eeg_data;
+        }
+
+    private:
+        const data::EEGData& m_eeg_data;
+        MorletCwt m_cwt;
+
+        void process_channels(const std::vector<std::string>& channel_names);
+
+        // bands of the current band set each scale falls into, [min_freq, max_freq) so a scale on the edge of two
+        // adjacent bands counts once, in the upper one
+        [[nodiscard]] std::vector<std::vector<size_t> > get_scale_bands() const;
+    };
+} // namespace brainviz::analysis
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <kfr/all.hpp>
+#include <span>
+
+#include <analysis/spectral_estimator.hpp>
+
+namespace brainviz::analysis
+{
+    // welch's method: overlapping hann segments inside the frame, each zero padded to the frame length
+    // so the bin grid matches the periodogram, then averaged
+    class WelchEstimator final : public SpectralEstimator
+    {
+    public:
+        WelchEstimator(
+            size_t window_size,
+            size_t segment_size = 0,
+            double overlap_percentage = 50.0,
+            SpectralAveraging averaging = SpectralAveraging::Mean
+        );
+
+        const kfr::univector<double>& compute(std::span<const double> frame) override;
+
+        [[nodiscard]] size_t get_segment_size() const
+        {
+            return m_segment_size;
+        }
+
+        [[nodiscard]] size_t get_segment_count() const
+        {
+            return m_segment_count;
+        }
+
+    private:
+        size_t m_segment_size;
+        size_t m_segment_hop;
+        size_t m_segment_count;
+        SpectralAveraging m_averaging;
+
+        kfr::univector<double> m_window;
+        double m_scale; // hann(segment) energy -> hann(window) energy
+    };
+} // namespace brainviz::analysis
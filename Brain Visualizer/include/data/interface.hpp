@@ -56,6 +56,21 @@ namespace brainviz::data
             return it->second;
         }
 
+        [[nodiscard]] std::vector<double>& get_channel(const std::string_view channelName)
+        {
+            const auto it = channels.find(channelName.data());
+            if (it == channels.end())
+            {
+                throw std::out_of_range(fmt::format("Channel not found: {}", channelName));
+            }
+            return it.value();
+        }
+
+        [[nodiscard]] bool has_channel(const std::string_view channelName) const
+        {
+            return channels.find(channelName.data()) != channels.end();
+        }
+
         void set_channel(const std::string_view channelName, std::vector<double> data)
         {
             channels[channelName.data()] = std::move(data);
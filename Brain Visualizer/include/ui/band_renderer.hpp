@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+#include <data/interface.hpp>
+
+class ElectrodeStateManager;
+
+namespace brainviz::visualization
+{
+    /**
+     * @brief Get the display color of a frequency band
+     * @param band The frequency band
+     * @return The opaque color used for the band circles, the legend and the plots
+     */
+    [[nodiscard]] sf::Color get_band_color(data::FrequencyBand band);
+
+    /**
+     * @brief Draw the band circles of the current frame around every electrode
+     * @param window The render target to draw on, a window or an offscreen texture
+     * @param stateManager The electrode state holding the interpolated radii and alphas and the selected band
+     * @param points The vector of electrode positions in 2D space
+     *
+     * In single band mode only the selected band is drawn, scaled up. Otherwise all five bands are drawn as
+     * nested circles with the selected one fully opaque.
+     */
+    void draw_band_circles(
+        sf::RenderTarget& window,
+        const ElectrodeStateManager& stateManager,
+        const std::vector<sf::Vector2f>& points
+    );
+
+} // namespace brainviz::visualization
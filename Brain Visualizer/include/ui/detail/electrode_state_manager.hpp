@@ -3,12 +3,13 @@
 #include <array>
 
 #include <electrode/electrode_set.hpp>
-#include <analysis/batch_analyzer.hpp>
+#include <analysis/frequency_analyzer.hpp>
+#include <analysis/baseline_normalizer.hpp>
 
 class ElectrodeStateManager
 {
 public:
-    ElectrodeStateManager(brainviz::electrode::ElectrodeSet& electrodeSet, brainviz::analysis::BatchAnalyzer& analyzer);
+    ElectrodeStateManager(brainviz::electrode::ElectrodeSet& electrodeSet, brainviz::analysis::FrequencyAnalyzer& analyzer);
 
     ~ElectrodeStateManager();
 
@@ -23,6 +24,16 @@ public:
 
     [[nodiscard]] bool is_single_band_mode() const;
 
+    [[nodiscard]] bool is_baseline_normalization() const
+    {
+        return m_useBaseline;
+    }
+
+    [[nodiscard]] const brainviz::analysis::BaselineNormalizer& get_baseline() const
+    {
+        return m_baseline;
+    }
+
     // used in rendering
     struct ElectrodeVisualizationData
     {
@@ -38,7 +49,7 @@ public:
         return m_electrodeSet;
     }
 
-    [[nodiscard]] brainviz::analysis::BatchAnalyzer& get_analyzer() const
+    [[nodiscard]] brainviz::analysis::FrequencyAnalyzer& get_analyzer() const
     {
         return m_analyzer;
     }
@@ -65,12 +76,19 @@ private:
     tsl::robin_map<int, ElectrodeState> m_electrodeStates;
     tsl::robin_map<int, ElectrodeVisualizationData> m_visualizationData;
 
+    // analyzer channel of each electrode, resolved once instead of hashing the name every frame
+    tsl::robin_map<int, brainviz::analysis::ChannelHandle> m_channelHandles;
+
     // state tracking
     brainviz::electrode::ElectrodeSet& m_electrodeSet;
-    brainviz::analysis::BatchAnalyzer& m_analyzer;
+    brainviz::analysis::FrequencyAnalyzer& m_analyzer;
     brainviz::data::FrequencyBand m_selectedBand = brainviz::data::FrequencyBand::Alpha;
     bool m_showOnlySelectedBand = false;
 
+    // running per channel baselines, updated every frame so switching to them doesnt start cold
+    brainviz::analysis::BaselineNormalizer m_baseline;
+    bool m_useBaseline = false;
+
     size_t m_windowSize;
     size_t m_hopSize;
     size_t m_frameIndex;
@@ -111,6 +129,16 @@ private:
         }
     }
 
+    void handle_baseline_changed(const bool useBaseline)
+    {
+        if (m_useBaseline != useBaseline)
+        {
+            m_useBaseline = useBaseline;
+
+            m_interpolationProgress = 0.0f;
+        }
+    }
+
     FORCE_INLINE static float lerp(const float p0, const float p1, float t)
     {
         t = std::max(0.0f, std::min(1.0f, t));
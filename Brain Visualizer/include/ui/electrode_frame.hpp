@@ -35,7 +35,7 @@ namespace brainviz::visualization
 
         /**
          * @brief Draw the electrode frame for a specific system
-         * @param window The render window to draw on
+         * @param window The render target to draw on, a window or an offscreen texture
          * @param system The electrode system type
          * @param points The vector of electrode positions in 2D space
          *
@@ -44,7 +44,7 @@ namespace brainviz::visualization
          * for improved performance.
          */
         void draw_frame(
-           sf::RenderWindow& window,
+           sf::RenderTarget& window,
            electrode::SystemType system,
            const std::vector<sf::Vector2f>& points
         );
@@ -79,7 +79,7 @@ namespace brainviz::visualization
 
     /**
      * @brief Draw frame connecting electrodes (optimized free function)
-     * @param window The render window to draw on
+     * @param window The render target to draw on, a window or an offscreen texture
      * @param system The electrode system type
      * @param points The vector of electrode positions in 2D space
      *
@@ -87,7 +87,7 @@ namespace brainviz::visualization
      * ElectrodeFrameManager instance's draw_frame method.
      */
     void draw_frame(
-        sf::RenderWindow& window,
+        sf::RenderTarget& window,
         electrode::SystemType system,
         const std::vector<sf::Vector2f>& points
     );
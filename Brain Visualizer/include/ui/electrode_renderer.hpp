@@ -37,7 +37,7 @@ namespace brainviz::visualization {
 
         /**
          * @brief Draw electrodes from an electrode set
-         * @param window The render window to draw on
+         * @param window The render target to draw on, a window or an offscreen texture
          * @param electrodeSet The set of electrodes to visualize
          * @param points Reference to a vector that will store the 2D positions of electrodes
          * @param headRadius The radius of the head model in pixels
@@ -49,7 +49,7 @@ namespace brainviz::visualization {
          * are stored in the points vector for potential reuse in other visualizations.
          */
         void draw_electrodes(
-           sf::RenderWindow& window,
+           sf::RenderTarget& window,
            const electrode::ElectrodeSet& electrodeSet,
            std::vector<sf::Vector2f>& points,
            double headRadius,
@@ -128,7 +128,7 @@ namespace brainviz::visualization {
 
     /**
      * @brief Draw electrodes using the optimized visualization system
-     * @param window The render window to draw on
+     * @param window The render target to draw on, a window or an offscreen texture
      * @param electrodeSet The set of electrodes to visualize
      * @param points Reference to a vector that will store the 2D positions of electrodes
      * @param headRadius The radius of the head model in pixels
@@ -139,7 +139,7 @@ namespace brainviz::visualization {
      * ElectrodeVisualizationManager instance's draw_electrodes method.
      */
     void draw_electrodes(
-       sf::RenderWindow& window,
+       sf::RenderTarget& window,
        const electrode::ElectrodeSet& electrodeSet,
        std::vector<sf::Vector2f>& points,
        double headRadius,
@@ -5,6 +5,7 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Window.hpp>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <event/event_system.hpp>
@@ -15,6 +16,9 @@ EVENT_DEF(FrequencyBandSelectedEvent, brainviz::data::FrequencyBand);
 
 EVENT_DEF(VisualizationModeChangedEvent, bool);
 
+// true scores bands against each channel's running baseline instead of against the other bands of the frame
+EVENT_DEF(BaselineNormalizationChangedEvent, bool);
+
 class FrequencyBandSelector
 {
 public:
@@ -30,6 +34,11 @@ public:
         return m_showOnlySelectedBand;
     }
 
+    [[nodiscard]] bool is_baseline_normalization() const
+    {
+        return m_baselineNormalization;
+    }
+
     [[nodiscard]] float get_animation_speed() const
     {
         return m_animationSpeed;
@@ -41,10 +50,18 @@ public:
         m_maxFrames = max;
     }
 
+    // how the shown recording was cleaned, if at all
+    void set_preprocessing_info(std::string info)
+    {
+        m_preprocessingInfo = std::move(info);
+    }
+
 private:
     brainviz::data::FrequencyBand m_selectedBand = brainviz::data::FrequencyBand::Alpha;
     bool m_showOnlySelectedBand = false;
+    bool m_baselineNormalization = false;
     float m_animationSpeed = 1.0f;
     size_t m_currentFrame = 0;
     size_t m_maxFrames = 0;
+    std::string m_preprocessingInfo;
 };
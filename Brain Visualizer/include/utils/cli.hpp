@@ -0,0 +1,81 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#include <fmt/format.h>
+
+namespace brainviz::utils
+{
+    // the whole of text as a number, throws naming the option when it isnt one
+    template <typename T>
+    [[nodiscard]] T parse_number(const std::string_view option, const std::string_view text)
+    {
+        T value{};
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+        if (error != std::errc{} || end != text.data() + text.size())
+        {
+            throw std::runtime_error(fmt::format("Invalid value for {}: {}", option, text));
+        }
+
+        return value;
+    }
+
+    /**
+     * @brief Walks the command line of the headless tools one argument at a time
+     *
+     * next() steps to the following argument, value() and number() consume the one after it as the value of the
+     * current option. Errors are std::runtime_error naming the option, for the tools to print with their usage hint.
+     */
+    class ArgumentReader
+    {
+    public:
+        // arguments as main() got them, the program name is skipped
+        explicit ArgumentReader(const std::span<char*> arguments)
+            : m_arguments(arguments)
+        {
+        }
+
+        [[nodiscard]] bool next()
+        {
+            return ++m_index < m_arguments.size();
+        }
+
+        [[nodiscard]] std::string_view argument() const
+        {
+            return m_arguments[m_index];
+        }
+
+        [[nodiscard]] std::string_view value()
+        {
+            if (m_index + 1 >= m_arguments.size())
+            {
+                throw std::runtime_error(fmt::format("Missing value for {}", argument()));
+            }
+
+            return m_arguments[++m_index];
+        }
+
+        template <typename T>
+        [[nodiscard]] T number()
+        {
+            const auto option = argument();
+            return parse_number<T>(option, value());
+        }
+
+        // the current argument is an option nobody handled
+        [[noreturn]] void unknown_option() const
+        {
+            throw std::runtime_error(fmt::format("Unknown option: {}", argument()));
+        }
+
+    private:
+        std::span<char*> m_arguments;
+        size_t m_index = 0;
+    };
+} // namespace brainviz::utils
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace brainviz::utils
+{
+    /**
+     * @brief Fixed size read/write memory mapping
+     *
+     * Without a backing file the pages are anonymous memory, with one they are backed by a scratch file the OS can
+     * page out to, so stores bigger than RAM still work. The backing file is created (or truncated) on construction
+     * and removed again when the buffer is destroyed. Contents start zeroed.
+     */
+    class MappedBuffer
+    {
+    public:
+        MappedBuffer() = default;
+
+        explicit MappedBuffer(size_t size, const std::filesystem::path& backing_file = {});
+
+        ~MappedBuffer();
+
+        MappedBuffer(const MappedBuffer&) = delete;
+
+        MappedBuffer& operator=(const MappedBuffer&) = delete;
+
+        MappedBuffer(MappedBuffer&& other) noexcept;
+
+        MappedBuffer& operator=(MappedBuffer&& other) noexcept;
+
+        [[nodiscard]] std::byte* data()
+        {
+            return m_data;
+        }
+
+        [[nodiscard]] const std::byte* data() const
+        {
+            return m_data;
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return m_size;
+        }
+
+        [[nodiscard]] bool is_file_backed() const
+        {
+            return !m_backing_file.empty();
+        }
+
+    private:
+        std::byte* m_data = nullptr;
+        size_t m_size = 0;
+        std::filesystem::path m_backing_file;
+
+#if defined(_WIN32)
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#else
+        int m_fd = -1;
+#endif
+
+        void release() noexcept;
+    };
+} // namespace brainviz::utils
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace brainviz::utils
+{
+    /**
+     * @brief Min/max level of detail pyramid over one signal, for plotting at any zoom
+     *
+     * Level l keeps the min and max of every bucket of FACTOR^(l + 1) samples, the raw samples themselves stay with
+     * the caller. A query picks the coarsest level whose buckets still fit inside one output column and returns a
+     * min and a max point per column, so drawing costs about two points per pixel whatever the zoom. append()
+     * extends the pyramid when the signal grows, touching only the buckets the new samples fall in.
+     */
+    class MinMaxPyramid
+    {
+    public:
+        static constexpr size_t FACTOR = 4;
+
+        MinMaxPyramid() = default;
+
+        explicit MinMaxPyramid(std::span<const double> samples);
+
+        // samples is the whole signal so far, the first get_sample_count() of which are already in the pyramid
+        void append(std::span<const double> samples);
+
+        [[nodiscard]] size_t get_sample_count() const
+        {
+            return m_sample_count;
+        }
+
+        [[nodiscard]] size_t get_level_count() const
+        {
+            return m_levels.size();
+        }
+
+        // points of samples [first, last) for columns output columns, x as sample positions. ranges of at most
+        // 2 * columns samples come back raw, otherwise each column adds its min and its max
+        void query(
+            std::span<const double> samples,
+            size_t first,
+            size_t last,
+            size_t columns,
+            std::vector<double>& x,
+            std::vector<double>& y) const;
+
+    private:
+        struct Level
+        {
+            size_t bucket_size = 0;
+            std::vector<float> min;
+            std::vector<float> max;
+        };
+
+        size_t m_sample_count = 0;
+        std::vector<Level> m_levels;
+    };
+} // namespace brainviz::utils
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace brainviz::utils
+{
+    namespace detail
+    {
+        // cap on worker_count() for work started from this thread, 0 is no cap
+        inline thread_local size_t t_worker_limit = 0;
+    }
+
+    // number of workers parallel_for splits work across, at least 1
+    [[nodiscard]] inline size_t worker_count()
+    {
+        const size_t hardware = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        return detail::t_worker_limit > 0 ? std::min(hardware, detail::t_worker_limit) : hardware;
+    }
+
+    /**
+     * @brief Caps parallel_for on the current thread while in scope
+     *
+     * For callers that already run several jobs side by side, so every job's parallel_for takes its share of the
+     * cores instead of all of them. The cap is handed on to parallel_for's workers, nested calls keep it too.
+     */
+    class ScopedWorkerLimit
+    {
+    public:
+        explicit ScopedWorkerLimit(const size_t limit)
+            : m_previous(detail::t_worker_limit)
+        {
+            detail::t_worker_limit = std::max<size_t>(limit, 1);
+        }
+
+        ~ScopedWorkerLimit()
+        {
+            detail::t_worker_limit = m_previous;
+        }
+
+        ScopedWorkerLimit(const ScopedWorkerLimit&) = delete;
+        ScopedWorkerLimit& operator=(const ScopedWorkerLimit&) = delete;
+
+    private:
+        size_t m_previous;
+    };
+
+    // run fn(begin, end) over contiguous chunks of [0, count) on up to worker_count() threads and wait for all of them.
+    // chunks are at least min_chunk long so tiny jobs stay on the calling thread. the first exception thrown by any
+    // chunk is rethrown here
+    template <typename Fn>
+    void parallel_for(const size_t count, Fn&& fn, const size_t min_chunk = 1)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        const size_t chunks = std::min(worker_count(), (count + min_chunk - 1) / std::max<size_t>(min_chunk, 1));
+        if (chunks <= 1)
+        {
+            fn(size_t{0}, count);
+            return;
+        }
+
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        const size_t worker_limit = detail::t_worker_limit;
+
+        auto run_chunk = [&](const size_t chunk) {
+            detail::t_worker_limit = worker_limit;
+
+            const size_t begin = count * chunk / chunks;
+            const size_t end = count * (chunk + 1) / chunks;
+
+            try
+            {
+                fn(begin, end);
+            }
+            catch (...)
+            {
+                std::scoped_lock lock(error_mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        };
+
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(chunks - 1);
+
+            for (size_t chunk = 1; chunk < chunks; ++chunk)
+            {
+                workers.emplace_back(run_chunk, chunk);
+            }
+
+            // the calling thread takes the first chunk instead of idling
+            run_chunk(0);
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+} // namespace brainviz::utils
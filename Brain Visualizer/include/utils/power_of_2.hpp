@@ -0,0 +1,22 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+
+namespace brainviz::utils
+{
+    // smallest power of two >= value, 1 for 0. fft sizes that must hold the whole input
+    [[nodiscard]] constexpr size_t next_power_of_2(const size_t value)
+    {
+        return value <= 1 ? 1 : std::bit_ceil(value);
+    }
+
+    // closest power of two, ties go down. window sizes picked by the user
+    [[nodiscard]] constexpr size_t round_to_power_of_2(const size_t value)
+    {
+        const size_t next_power = next_power_of_2(value);
+        const size_t prev_power = next_power >> 1;
+
+        return (prev_power == 0 || next_power - value < value - prev_power) ? next_power : prev_power;
+    }
+} // namespace brainviz::utils
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <numeric>
+
+#include <analysis/artifact_detector.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // sums of powers of (sample - shift) and the extremes of a run of samples
+        struct Moments
+        {
+            double s1 = 0.0, s2 = 0.0, s3 = 0.0, s4 = 0.0;
+            double low = 0.0, high = 0.0;
+            size_t count = 0;
+
+            void add(const Moments& other, const double sign)
+            {
+                s1 += sign * other.s1;
+                s2 += sign * other.s2;
+                s3 += sign * other.s3;
+                s4 += sign * other.s4;
+                count = sign > 0.0 ? count + other.count : count - other.count;
+            }
+        };
+    }
+
+    ArtifactDetector::ArtifactDetector(const BandSet& bands, const ArtifactOptions options)
+        : m_options(options)
+    {
+        for (const auto& band : bands)
+        {
+            m_muscle_bands.push_back(band.min_freq >= m_options.muscle_min_freq);
+        }
+    }
+
+    void ArtifactDetector::classify_samples(
+        const std::span<const double> samples,
+        const size_t window_size,
+        const size_t hop_size,
+        const std::span<std::uint8_t> flags) const
+    {
+        std::fill(flags.begin(), flags.end(), std::uint8_t{0});
+
+        if (samples.empty() || (m_options.amplitude_threshold <= 0.0 && m_options.kurtosis_threshold <= 0.0))
+        {
+            return;
+        }
+
+        const size_t n = samples.size();
+        const size_t block_size = std::gcd(window_size, hop_size);
+        const size_t block_count = (n + block_size - 1) / block_size;
+
+        // a common shift keeps the raw moments from cancelling on a DC offset
+        double shift = 0.0;
+        for (const double sample : samples)
+        {
+            shift += sample;
+        }
+        shift /= static_cast<double>(n);
+
+        std::vector<Moments> blocks(block_count);
+
+        for (size_t b = 0; b < block_count; ++b)
+        {
+            auto& block = blocks[b];
+            const size_t end = std::min(n, (b + 1) * block_size);
+
+            block.low = block.high = samples[b * block_size] - shift;
+            block.count = end - b * block_size;
+
+            for (size_t i = b * block_size; i < end; ++i)
+            {
+                const double x = samples[i] - shift;
+                const double x2 = x * x;
+                block.s1 += x;
+                block.s2 += x2;
+                block.s3 += x2 * x;
+                block.s4 += x2 * x2;
+                block.low = std::min(block.low, x);
+                block.high = std::max(block.high, x);
+            }
+        }
+
+        // window sums slide block by block, and are rebuilt once per window length so rounding cant pile up
+        const size_t refresh = std::max<size_t>(1, window_size / std::max<size_t>(hop_size, 1));
+
+        Moments window;
+        size_t window_first = 0;
+        size_t window_last = 0;
+
+        // block indices with increasing minimum / decreasing maximum, front is the window's extreme
+        std::deque<size_t> lows;
+        std::deque<size_t> highs;
+        size_t pushed = 0;
+
+        for (size_t frame = 0; frame < flags.size(); ++frame)
+        {
+            const size_t start = frame * hop_size;
+            if (start >= n)
+                break;
+
+            const size_t first = start / block_size;
+            const size_t last = (std::min(n, start + window_size) + block_size - 1) / block_size;
+
+            if (frame % refresh == 0 || first >= window_last)
+            {
+                window = {};
+                for (size_t b = first; b < last; ++b)
+                {
+                    window.add(blocks[b], 1.0);
+                }
+            }
+            else
+            {
+                for (size_t b = window_first; b < first; ++b)
+                {
+                    window.add(blocks[b], -1.0);
+                }
+                for (size_t b = window_last; b < last; ++b)
+                {
+                    window.add(blocks[b], 1.0);
+                }
+            }
+
+            window_first = first;
+            window_last = last;
+
+            for (; pushed < last; ++pushed)
+            {
+                while (!lows.empty() && blocks[lows.back()].low >= blocks[pushed].low)
+                    lows.pop_back();
+                lows.push_back(pushed);
+
+                while (!highs.empty() && blocks[highs.back()].high <= blocks[pushed].high)
+                    highs.pop_back();
+                highs.push_back(pushed);
+            }
+
+            while (lows.front() < first)
+                lows.pop_front();
+            while (highs.front() < first)
+                highs.pop_front();
+
+            if (window.count < 4)
+                continue;
+
+            const double count = static_cast<double>(window.count);
+            const double mean = window.s1 / count;
+            std::uint8_t mask = 0;
+
+            if (m_options.amplitude_threshold > 0.0 &&
+                std::max(blocks[highs.front()].high - mean, mean - blocks[lows.front()].low) >
+                m_options.amplitude_threshold)
+            {
+                mask |= static_cast<std::uint8_t>(ArtifactFlag::Amplitude);
+            }
+
+            // central moments from the raw ones
+            const double mean2 = mean * mean;
+            const double m2 = window.s2 / count - mean2;
+            const double m4 = window.s4 / count - 4.0 * mean * window.s3 / count + 6.0 * mean2 * window.s2 / count
+                              - 3.0 * mean2 * mean2;
+
+            if (m_options.kurtosis_threshold > 0.0 && m2 > 0.0 &&
+                m4 / (m2 * m2) - 3.0 > m_options.kurtosis_threshold)
+            {
+                mask |= static_cast<std::uint8_t>(ArtifactFlag::Kurtosis);
+            }
+
+            flags[frame] = mask;
+        }
+    }
+
+    std::uint8_t ArtifactDetector::classify_bands(const std::span<const double> band_amplitudes) const
+    {
+        if (m_options.muscle_ratio_threshold <= 0.0)
+        {
+            return 0;
+        }
+
+        double muscle = 0.0;
+        double total = 0.0;
+
+        for (size_t band = 0; band < std::min(band_amplitudes.size(), m_muscle_bands.size()); ++band)
+        {
+            const double power = band_amplitudes[band] * band_amplitudes[band];
+            total += power;
+            if (m_muscle_bands[band])
+            {
+                muscle += power;
+            }
+        }
+
+        return (total > 0.0 && muscle > m_options.muscle_ratio_threshold * total)
+                   ? static_cast<std::uint8_t>(ArtifactFlag::Muscle)
+                   : 0;
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <analysis/band_set.hpp>
+
+namespace brainviz::analysis
+{
+    BandSet::BandSet(std::vector<BandDefinition> bands)
+    {
+        for (auto& band : bands)
+        {
+            add(band.name, band.min_freq, band.max_freq);
+        }
+    }
+
+    BandSet BandSet::standard()
+    {
+        BandSet bands;
+        bands.add("Delta", data::FrequencyRange::DELTA_MIN, data::FrequencyRange::DELTA_MAX);
+        bands.add("Theta", data::FrequencyRange::THETA_MIN, data::FrequencyRange::THETA_MAX);
+        bands.add("Alpha", data::FrequencyRange::ALPHA_MIN, data::FrequencyRange::ALPHA_MAX);
+        bands.add("Beta", data::FrequencyRange::BETA_MIN, data::FrequencyRange::BETA_MAX);
+        bands.add("Gamma", data::FrequencyRange::GAMMA_MIN, data::FrequencyRange::GAMMA_MAX);
+        return bands;
+    }
+
+    size_t BandSet::add(const std::string_view name, const double min_freq, const double max_freq)
+    {
+        if (!(min_freq >= 0.0) || !(max_freq >= min_freq))
+        {
+            throw std::invalid_argument(fmt::format("Invalid band {}: {}-{} Hz", name, min_freq, max_freq));
+        }
+
+        if (find(name))
+        {
+            throw std::invalid_argument(fmt::format("Duplicate band name: {}", name));
+        }
+
+        m_bands.push_back({std::string(name), min_freq, max_freq});
+        return m_bands.size() - 1;
+    }
+
+    std::optional<size_t> BandSet::find(const std::string_view name) const
+    {
+        for (size_t i = 0; i < m_bands.size(); ++i)
+        {
+            if (m_bands[i].name == name)
+            {
+                return i;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    std::array<std::optional<size_t>, 5> BandSet::standard_indices() const
+    {
+        std::array<std::optional<size_t>, 5> result;
+
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            result[i] = find(standard_name(static_cast<data::FrequencyBand>(i)));
+        }
+
+        return result;
+    }
+
+    std::string_view BandSet::standard_name(const data::FrequencyBand band)
+    {
+        switch (band)
+        {
+            case data::FrequencyBand::Delta:
+                return "Delta";
+            case data::FrequencyBand::Theta:
+                return "Theta";
+            case data::FrequencyBand::Alpha:
+                return "Alpha";
+            case data::FrequencyBand::Beta:
+                return "Beta";
+            case data::FrequencyBand::Gamma:
+                return "Gamma";
+            default:
+                throw std::invalid_argument("Invalid frequency band");
+        }
+    }
+
+    BandBinTable::BandBinTable(const BandSet& bands, const double sampling_rate, const size_t window_size)
+        : m_bin_count(window_size / 2 + 1)
+    {
+        const double freq_resolution = sampling_rate / static_cast<double>(window_size);
+
+        m_first_bin.resize(bands.size());
+        m_last_bin.resize(bands.size());
+
+        for (size_t band = 0; band < bands.size(); ++band)
+        {
+            const auto min_bin = static_cast<size_t>(std::ceil(bands[band].min_freq / freq_resolution));
+            const auto max_bin = static_cast<size_t>(std::floor(bands[band].max_freq / freq_resolution));
+
+            m_first_bin[band] = min_bin;
+            m_last_bin[band] = std::min(max_bin, m_bin_count - 1);
+
+            if (is_band_empty(band))
+                continue;
+
+            m_edges.push_back({m_first_bin[band], band, -1.0});
+            m_edges.push_back({m_last_bin[band] + 1, band, 1.0});
+        }
+
+        std::ranges::sort(m_edges, {}, &Edge::position);
+    }
+
+    void BandBinTable::reduce(const std::span<const double> power_spectrum, const std::span<double> amplitudes) const
+    {
+        std::fill(amplitudes.begin(), amplitudes.end(), 0.0);
+
+        const size_t bins = std::min(power_spectrum.size(), m_bin_count);
+
+        double prefix = 0.0;
+        auto edge = m_edges.begin();
+
+        for (size_t i = 0; i <= bins; ++i)
+        {
+            for (; edge != m_edges.end() && edge->position == i; ++edge)
+            {
+                amplitudes[edge->band] += edge->sign * prefix;
+            }
+
+            if (i < bins)
+            {
+                prefix += power_spectrum[i];
+            }
+        }
+
+        for (double& amplitude : amplitudes)
+        {
+            // the prefix difference can come out a hair below zero
+            amplitude = std::sqrt(std::max(amplitude, 0.0));
+        }
+    }
+} // namespace brainviz::analysis
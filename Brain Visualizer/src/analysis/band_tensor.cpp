@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include <analysis/band_tensor.hpp>
+
+namespace brainviz::analysis
+{
+    BandTensor::BandTensor(const size_t band_count, const size_t frame_capacity)
+        : m_band_count(band_count),
+          m_frame_capacity(frame_capacity)
+    {
+    }
+
+    ChannelHandle BandTensor::add_channel()
+    {
+        m_frame_counts.push_back(0);
+        m_data.resize(m_frame_counts.size() * m_frame_capacity * m_band_count, 0.0);
+
+        return m_frame_counts.size() - 1;
+    }
+
+    void BandTensor::reserve_frames(const size_t frames)
+    {
+        if (frames <= m_frame_capacity)
+        {
+            return;
+        }
+
+        const size_t old_block = m_frame_capacity * m_band_count;
+        const size_t new_block = frames * m_band_count;
+
+        std::vector<double> data(m_frame_counts.size() * new_block, 0.0);
+
+        for (size_t channel = 0; channel < m_frame_counts.size(); ++channel)
+        {
+            const auto source = m_data.begin() + static_cast<std::ptrdiff_t>(channel * old_block);
+            std::copy_n(source, m_frame_counts[channel] * m_band_count,
+                        data.begin() + static_cast<std::ptrdiff_t>(channel * new_block));
+        }
+
+        m_data = std::move(data);
+        m_frame_capacity = frames;
+    }
+
+    void BandTensor::resize_frames(const ChannelHandle channel, const size_t frames)
+    {
+        reserve_frames(frames);
+
+        const size_t old_frames = m_frame_counts[channel];
+        if (frames > old_frames)
+        {
+            const auto begin = m_data.begin() + static_cast<std::ptrdiff_t>(offset(channel, old_frames));
+            std::fill_n(begin, (frames - old_frames) * m_band_count, 0.0);
+        }
+
+        m_frame_counts[channel] = frames;
+    }
+
+    std::span<double> BandTensor::append_frame(const ChannelHandle channel)
+    {
+        const size_t frame = m_frame_counts[channel];
+
+        if (frame == m_frame_capacity)
+        {
+            // doubling keeps appends amortized constant while streaming
+            reserve_frames(std::max<size_t>(m_frame_capacity * 2, 16));
+        }
+
+        resize_frames(channel, frame + 1);
+        return this->frame(channel, frame);
+    }
+
+    void BandTensor::drop_front(const ChannelHandle channel, const size_t frames)
+    {
+        const size_t dropped = std::min(frames, m_frame_counts[channel]);
+        const size_t kept = m_frame_counts[channel] - dropped;
+
+        const auto block = m_data.begin() + static_cast<std::ptrdiff_t>(offset(channel, 0));
+        std::copy_n(block + static_cast<std::ptrdiff_t>(dropped * m_band_count), kept * m_band_count, block);
+
+        m_frame_counts[channel] = kept;
+    }
+} // namespace brainviz::analysis
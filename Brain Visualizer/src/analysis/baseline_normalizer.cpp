@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cmath>
+
+#include <analysis/frequency_analyzer.hpp>
+#include <analysis/baseline_normalizer.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // same ranges as the per frame normalization
+        constexpr float BASE_RADIUS = 0.2f;
+        constexpr float MAX_RADIUS = 1.0f;
+        constexpr float MIN_TRANSPARENCY = 0.2f;
+        constexpr float MAX_TRANSPARENCY = 1.0f;
+
+        // keeps silent bands finite under the log
+        constexpr float LOG_FLOOR = 1e-12f;
+    }
+
+    BaselineNormalizer::BaselineNormalizer(const FrequencyAnalyzer& analyzer, const BaselineOptions options)
+        : m_analyzer(analyzer),
+          m_options(options)
+    {
+        m_options.z_range = std::max(m_options.z_range, 1e-3);
+
+        const double frame_seconds = static_cast<double>(analyzer.get_hop_size()) / analyzer.get_sampling_rate();
+
+        m_rate = static_cast<float>(1.0 - std::exp(-frame_seconds / std::max(m_options.time_constant_seconds, 1e-6)));
+        m_window_frames = std::max<size_t>(static_cast<size_t>(std::lround(m_options.window_seconds / frame_seconds)), 1);
+
+        resize(analyzer.get_channel_count());
+    }
+
+    void BaselineNormalizer::resize(const size_t channels)
+    {
+        m_channels = channels;
+        const size_t count = channels * BANDS;
+
+        for (auto* values : {&m_values, &m_valid, &m_mean, &m_variance, &m_count, &m_z, &m_radii, &m_alphas})
+        {
+            values->resize(count);
+        }
+
+        if (m_options.mode == BaselineMode::Window)
+        {
+            m_sum.resize(count);
+            m_sum_squares.resize(count);
+            m_history.resize(m_window_frames * count);
+            m_history_valid.resize(m_window_frames * count);
+        }
+
+        reset();
+    }
+
+    void BaselineNormalizer::reset()
+    {
+        for (auto* values : {&m_mean, &m_variance, &m_count, &m_z, &m_history, &m_history_valid})
+        {
+            std::ranges::fill(*values, 0.0f);
+        }
+
+        std::ranges::fill(m_sum, 0.0);
+        std::ranges::fill(m_sum_squares, 0.0);
+        m_history_slot = 0;
+
+        // a z score of 0 sits in the middle of the range
+        std::ranges::fill(m_radii, (BASE_RADIUS + MAX_RADIUS) / 2.0f);
+        std::ranges::fill(m_alphas, (MIN_TRANSPARENCY + MAX_TRANSPARENCY) / 2.0f);
+
+        m_last_frame = std::numeric_limits<size_t>::max();
+    }
+
+    void BaselineNormalizer::update(const size_t frame_index)
+    {
+        if (m_analyzer.get_channel_count() != m_channels)
+        {
+            resize(m_analyzer.get_channel_count());
+        }
+
+        if (m_last_frame != std::numeric_limits<size_t>::max() && frame_index <= m_last_frame)
+        {
+            reset();
+        }
+        m_last_frame = frame_index;
+
+        const size_t count = m_channels * BANDS;
+        const auto standard_indices = m_analyzer.get_band_set().standard_indices();
+        const bool ready = m_analyzer.is_frame_ready(frame_index);
+
+        // gather the frame into [channel][band], the only pass that touches the analyzer
+        for (ChannelHandle channel = 0; channel < m_channels; ++channel)
+        {
+            const bool valid = ready && frame_index < m_analyzer.get_frame_count(channel) &&
+                               !m_analyzer.is_artifact(channel, frame_index);
+
+            const auto frame = valid ? m_analyzer.get_frame(channel, frame_index) : std::span<const double>{};
+
+            for (size_t band = 0; band < BANDS; ++band)
+            {
+                const size_t i = channel * BANDS + band;
+
+                if (!valid || !standard_indices[band])
+                {
+                    m_values[i] = 0.0f;
+                    m_valid[i] = 0.0f;
+                    continue;
+                }
+
+                const auto amplitude = static_cast<float>(frame[*standard_indices[band]]);
+                m_values[i] = m_options.log_amplitude ? std::log(std::max(amplitude, LOG_FLOOR)) : amplitude;
+                m_valid[i] = 1.0f;
+            }
+        }
+
+        // score against the baseline before this frame is part of it, held where the frame doesnt count
+        const auto z_range = static_cast<float>(m_options.z_range);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float inverse_stddev = m_variance[i] > 0.0f ? 1.0f / std::sqrt(m_variance[i]) : 0.0f;
+            const float z = std::clamp((m_values[i] - m_mean[i]) * inverse_stddev, -z_range, z_range);
+
+            m_z[i] += m_valid[i] * (z - m_z[i]);
+
+            const float t = (m_z[i] + z_range) / (2.0f * z_range);
+            m_radii[i] = BASE_RADIUS + t * (MAX_RADIUS - BASE_RADIUS);
+            m_alphas[i] = MIN_TRANSPARENCY + t * (MAX_TRANSPARENCY - MIN_TRANSPARENCY);
+        }
+
+        if (m_options.mode == BaselineMode::Exponential)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                m_count[i] += m_valid[i];
+
+                // a plain running mean until the baseline holds about one time constant of frames
+                const float rate = m_valid[i] * std::max(m_rate, 1.0f / std::max(m_count[i], 1.0f));
+                const float delta = m_values[i] - m_mean[i];
+
+                m_mean[i] += rate * delta;
+                m_variance[i] = (1.0f - rate) * (m_variance[i] + rate * delta * delta);
+            }
+
+            return;
+        }
+
+        // windowed: swap the frame leaving the window for this one in the running sums
+        const auto old_values = std::span(m_history).subspan(m_history_slot * count, count);
+        const auto old_valid = std::span(m_history_valid).subspan(m_history_slot * count, count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double added = m_valid[i] * m_values[i];
+            const double removed = old_valid[i] * old_values[i];
+
+            m_sum[i] += added - removed;
+            m_sum_squares[i] += added * m_values[i] - removed * old_values[i];
+            m_count[i] += m_valid[i] - old_valid[i];
+
+            old_values[i] = m_values[i];
+            old_valid[i] = m_valid[i];
+
+            const double frames = std::max<double>(m_count[i], 1.0);
+            const double mean = m_sum[i] / frames;
+
+            m_mean[i] = static_cast<float>(mean);
+            m_variance[i] = static_cast<float>(std::max(m_sum_squares[i] / frames - mean * mean, 0.0));
+        }
+
+        m_history_slot = (m_history_slot + 1) % m_window_frames;
+    }
+} // namespace brainviz::analysis
@@ -1,302 +1,392 @@
-#include <cmath>
 #include <algorithm>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
 #include <fmt/format.h>
 
-#include <logging/logger.hpp>
+#include <utils/parallel.hpp>
 #include <analysis/batch_analyzer.hpp>
 
 namespace brainviz::analysis
 {
-    size_t BatchAnalyzer::round_to_power_of_2(const size_t value)
+    BatchAnalyzer::BatchAnalyzer(
+        const data::EEGData& eeg_data,
+        const size_t window_size,
+        const double overlap_percentage)
+        : FrequencyAnalyzer(eeg_data.m_samplingRate, window_size, overlap_percentage),
+          m_eeg_data(eeg_data)
+    {
+    }
+
+    void BatchAnalyzer::process_all_channels()
     {
-        if (value == 0)
-            return 1;
+        const auto channel_names = m_eeg_data.get_channel_names();
 
-        size_t next_power = 1;
-        while (next_power < value)
+        std::vector<const std::vector<double>*> raw_data;
+        std::vector<ChannelHandle> channels;
+
+        // size everything up front so the workers only ever write into their own channel blocks
+        size_t max_frames = 0;
+        for (const auto& channel_name : channel_names)
         {
-            next_power <<= 1;
+            max_frames = std::max(max_frames, frame_count(m_eeg_data.get_channel(channel_name).size()));
         }
 
-        const size_t prev_power = next_power >> 1;
-
-        if (next_power - value < value - prev_power)
+        // handles first so the spectrogram is mapped once for every channel
+        for (const auto& channel_name : channel_names)
         {
-            return next_power;
+            add_channel_results(channel_name);
         }
 
-        return prev_power;
-    }
+        m_results.reserve_frames(max_frames);
+        if (m_spectrogram_enabled)
+        {
+            m_spectrogram.reserve(get_channel_count(), max_frames);
+        }
 
-    BatchAnalyzer::BatchAnalyzer(
-        const data::EEGData& eeg_data,
-        const size_t window_size,
-        const double overlap_percentage)
-        : m_eeg_data(eeg_data),
-          m_sampling_rate(eeg_data.m_samplingRate)
-    {
-        m_window_size = round_to_power_of_2(window_size);
+        if (m_peak_tracking)
+        {
+            m_peak_frequencies.reserve_frames(max_frames);
+            m_peak_powers.reserve_frames(max_frames);
+            m_aperiodic.reserve_frames(max_frames);
+        }
 
-        m_hop_size = static_cast<size_t>(m_window_size * (100.0 - overlap_percentage) / 100.0);
+        if (m_feature_extraction)
+        {
+            m_features.reserve_frames(max_frames);
+        }
 
-        if (m_hop_size < 1)
+        for (const auto& channel_name : channel_names)
         {
-            m_hop_size = 1;
+            raw_data.push_back(&m_eeg_data.get_channel(channel_name));
+            channels.push_back(prepare_channel(channel_name, frame_count(raw_data.back()->size())));
         }
 
-        g_logger.info("Initialized frequency analyzer with window size {} (power of 2)", m_window_size);
-        g_logger.info("Using hop size {} ({:.1f}% overlap)", m_hop_size,
-                      100.0 * (1.0 - static_cast<double>(m_hop_size) / m_window_size));
-        g_logger.info("Frequency resolution: {:.3f} Hz", get_frequency_resolution());
+        utils::parallel_for(channels.size(), [&](const size_t begin, const size_t end) {
+            const auto estimator = make_spectral_estimator(m_window_size, m_spectral_options);
+            auto peak_tracker = m_peak_tracker;
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                analyze_channel(channels[i], *raw_data[i], *estimator, peak_tracker);
+            }
+        });
     }
 
-    void BatchAnalyzer::process_all_channels()
+    void BatchAnalyzer::process_channel(const std::string_view channel_name)
+    {
+        const auto& raw_data = m_eeg_data.get_channel(channel_name);
+
+        const ChannelHandle channel = prepare_channel(channel_name, frame_count(raw_data.size()));
+        const auto estimator = make_spectral_estimator(m_window_size, m_spectral_options);
+
+        analyze_channel(channel, raw_data, *estimator, m_peak_tracker);
+    }
+
+    ChannelHandle BatchAnalyzer::prepare_channel(const std::string_view channel_name, const size_t frames)
     {
-        for (const auto& channel_name : m_eeg_data.get_channel_names())
+        m_visualization_table = {};
+
+        const ChannelHandle channel = add_channel_results(std::string(channel_name));
+        m_results.resize_frames(channel, frames);
+
+        if (m_spectrogram_enabled)
+        {
+            m_spectrogram.reserve(channel + 1, frames);
+            m_spectrogram.set_frame_count(channel, frames);
+        }
+        else if (channel < m_spectrogram.get_channel_count())
         {
-            process_channel(channel_name);
+            // stale spectra of an earlier run
+            m_spectrogram.set_frame_count(channel, 0);
         }
+
+        prepare_derived(channel, frames);
+
+        return channel;
     }
 
-    void BatchAnalyzer::process_channel(const std::string_view channel_name)
+    void BatchAnalyzer::analyze_channel(
+        const ChannelHandle channel,
+        const std::vector<double>& raw_data,
+        SpectralEstimator& estimator,
+        PeakTracker& peak_tracker)
     {
-        const auto& raw_data = m_eeg_data.get_channel(channel_name);
-
         const size_t window_size = m_window_size;
         const size_t hop_size = m_hop_size;
-        const size_t num_frames = (raw_data.size() > window_size) ? (raw_data.size() - window_size) / hop_size + 1 : 1;
-
-        BandAmplitudes band_amplitudes;
-        band_amplitudes.delta.resize(num_frames);
-        band_amplitudes.theta.resize(num_frames);
-        band_amplitudes.alpha.resize(num_frames);
-        band_amplitudes.beta.resize(num_frames);
-        band_amplitudes.gamma.resize(num_frames);
-
-        const kfr::dft_plan<double> dft(window_size);
-        kfr::univector<uint8_t> temp(dft.temp_size);
+        const size_t num_frames = m_results.get_frame_count(channel);
 
         for (size_t frame = 0; frame < num_frames; ++frame)
         {
             const size_t start_idx = frame * hop_size;
+            const size_t count = std::min(window_size, raw_data.size() - start_idx);
 
-            kfr::univector<double> frame_data(window_size);
-            for (size_t i = 0; i < window_size && (start_idx + i) < raw_data.size(); ++i)
-            {
-                frame_data[i] = raw_data[start_idx + i];
-            }
-
-            frame_data = frame_data * kfr::window_hann(window_size);
+            const auto& power_spectrum = estimator.compute(std::span(raw_data).subspan(start_idx, count));
 
-            kfr::univector<kfr::complex<double> > complex_data(window_size);
-            for (size_t i = 0; i < window_size; ++i)
-            {
-                complex_data[i] = kfr::complex<double>(frame_data[i], 0.0);
-            }
+            store_frame(channel, frame, power_spectrum);
 
-            kfr::univector<kfr::complex<double> > fft_result(window_size);
-            dft.execute(fft_result, complex_data, temp, false);
+            derive_frame(peak_tracker, channel, frame, std::span(raw_data).subspan(start_idx, count), power_spectrum);
 
-            kfr::univector<double> power_spectrum(window_size / 2 + 1);
-            for (size_t i = 0; i < power_spectrum.size(); ++i)
+            if (m_spectrogram_enabled)
             {
-                power_spectrum[i] = std::norm(fft_result[i]);
+                m_spectrogram.write_frame(channel, frame, power_spectrum);
             }
-
-            const double freq_resolution = m_sampling_rate / window_size;
-
-            band_amplitudes.delta[frame] = calculate_band_amplitude(power_spectrum, freq_resolution,
-                                                                    data::FrequencyRange::DELTA_MIN,
-                                                                    data::FrequencyRange::DELTA_MAX);
-
-            band_amplitudes.theta[frame] = calculate_band_amplitude(power_spectrum, freq_resolution,
-                                                                    data::FrequencyRange::THETA_MIN,
-                                                                    data::FrequencyRange::THETA_MAX);
-
-            band_amplitudes.alpha[frame] = calculate_band_amplitude(power_spectrum, freq_resolution,
-                                                                    data::FrequencyRange::ALPHA_MIN,
-                                                                    data::FrequencyRange::ALPHA_MAX);
-
-            band_amplitudes.beta[frame] = calculate_band_amplitude(power_spectrum, freq_resolution,
-                                                                   data::FrequencyRange::BETA_MIN,
-                                                                   data::FrequencyRange::BETA_MAX);
-
-            band_amplitudes.gamma[frame] = calculate_band_amplitude(power_spectrum, freq_resolution,
-                                                                    data::FrequencyRange::GAMMA_MIN,
-                                                                    data::FrequencyRange::GAMMA_MAX);
         }
 
-        m_channel_amplitudes[std::string(channel_name)] = std::move(band_amplitudes);
+        detect_artifacts(channel, raw_data, 0, num_frames);
     }
 
-    const kfr::univector<double>& BatchAnalyzer::get_band_amplitude(
-        const data::FrequencyBand band,
-        const std::string_view channel_name) const
+    void BatchAnalyzer::enable_spectrogram(SpectrogramOptions options)
     {
-        const auto it = m_channel_amplitudes.find(std::string(channel_name));
-        if (it == m_channel_amplitudes.end())
-        {
-            throw std::runtime_error(fmt::format("Channel not processed: {}", channel_name));
-        }
+        m_spectrogram = SpectrogramStore(m_window_size / 2 + 1, std::move(options));
+        m_spectrogram_enabled = true;
+    }
+
+    void BatchAnalyzer::disable_spectrogram()
+    {
+        m_spectrogram = {};
+        m_spectrogram_enabled = false;
+    }
 
-        const auto& [delta,
-            theta,
-            alpha,
-            beta,
-            gamma] = it->second;
+    void BatchAnalyzer::enable_peak_tracking(const PeakOptions options)
+    {
+        m_peak_tracker = PeakTracker(m_bands, m_sampling_rate, m_window_size, options);
+        m_peak_tracking = true;
 
-        switch (band)
+        if (m_peak_frequencies.get_band_count() != m_bands.size())
         {
-            case data::FrequencyBand::Delta:
-                return delta;
-            case data::FrequencyBand::Theta:
-                return theta;
-            case data::FrequencyBand::Alpha:
-                return alpha;
-            case data::FrequencyBand::Beta:
-                return beta;
-            case data::FrequencyBand::Gamma:
-                return gamma;
-            default:
-                throw std::invalid_argument("Invalid frequency band");
+            m_peak_frequencies = BandTensor(m_bands.size());
+            m_peak_powers = BandTensor(m_bands.size());
+            m_aperiodic = BandTensor(PeakTracker::APERIODIC_COUNT);
         }
     }
 
-
-    size_t BatchAnalyzer::get_max_frame_index() const
+    void BatchAnalyzer::disable_peak_tracking()
     {
-        if (m_channel_amplitudes.empty())
-        {
-            return 0;
-        }
+        m_peak_tracking = false;
 
-        const auto& first_channel = m_channel_amplitudes.begin()->second;
+        m_peak_frequencies = {};
+        m_peak_powers = {};
+        m_aperiodic = {};
+    }
 
-        if (first_channel.delta.empty())
+    void BatchAnalyzer::enable_feature_extraction(FeatureOptions options)
+    {
+        m_feature_extractor = FeatureExtractor(m_bands, m_sampling_rate, m_window_size, std::move(options));
+        m_feature_extraction = true;
+
+        if (m_features.get_band_count() != m_feature_extractor.get_feature_count())
         {
-            return 0;
+            m_features = BandTensor(m_feature_extractor.get_feature_count());
         }
-
-        return first_channel.delta.size() - 1;
     }
 
-    size_t BatchAnalyzer::time_index_to_frame(const size_t time_index) const
+    void BatchAnalyzer::disable_feature_extraction()
     {
-        const size_t window_size = m_window_size;
-        const size_t hop_size = m_hop_size;
+        m_feature_extraction = false;
+        m_features = {};
+    }
 
-        if (time_index < window_size / 2)
+    StridedSpan<const double> BatchAnalyzer::get_feature(const size_t feature_index, const ChannelHandle channel) const
+    {
+        if (feature_index >= m_features.get_band_count())
         {
-            return 0;
+            throw std::out_of_range(fmt::format("Feature index {} out of range", feature_index));
         }
 
-        size_t frame = (time_index - window_size / 2) / hop_size;
-        return std::min(frame, get_max_frame_index());
+        return derived_series(m_features, feature_index, channel);
     }
 
-    data::FrequencyBand BatchAnalyzer::get_dominant_band(
-        const std::string_view channel_name,
-        const size_t time_index) const
+    StridedSpan<const double> BatchAnalyzer::get_feature(const Feature feature, const ChannelHandle channel) const
     {
-        const size_t frame_index = time_index_to_frame(time_index);
-
-        double max_amplitude = -1.0;
-        auto dominant_band = data::FrequencyBand::Delta;
-
-        for (int band_idx = 0; band_idx < 5; ++band_idx)
-        {
-            const auto curr_band = static_cast<data::FrequencyBand>(band_idx);
-            const auto& band_amplitudes = get_band_amplitude(curr_band, channel_name);
+        return get_feature(static_cast<size_t>(feature), channel);
+    }
 
-            if (frame_index < band_amplitudes.size() && band_amplitudes[frame_index] > max_amplitude)
+    void BatchAnalyzer::prepare_derived(const ChannelHandle channel, const size_t frames)
+    {
+        const auto prepare = [&](BandTensor& tensor, const bool enabled) {
+            while (tensor.get_channel_count() <= channel)
             {
-                max_amplitude = band_amplitudes[frame_index];
-                dominant_band = curr_band;
+                tensor.add_channel();
             }
-        }
 
-        return dominant_band;
+            tensor.resize_frames(channel, enabled ? frames : 0);
+        };
+
+        prepare(m_peak_frequencies, m_peak_tracking);
+        prepare(m_peak_powers, m_peak_tracking);
+        prepare(m_aperiodic, m_peak_tracking);
+        prepare(m_features, m_feature_extraction);
     }
 
-    std::array<BatchAnalyzer::VisualizationInfo, 5> BatchAnalyzer::get_visualization_info(
-        const std::string_view channel_name,
-        const size_t time_index) const
+    void BatchAnalyzer::derive_frame(
+        PeakTracker& peak_tracker,
+        const ChannelHandle channel,
+        const size_t frame,
+        const std::span<const double> samples,
+        const std::span<const double> power_spectrum)
     {
-        const size_t frame_index = time_index_to_frame(time_index);
-
-        std::array<VisualizationInfo, 5> result{};
+        if (m_peak_tracking)
+        {
+            peak_tracker.track(power_spectrum, m_peak_frequencies.frame(channel, frame),
+                               m_peak_powers.frame(channel, frame), m_aperiodic.frame(channel, frame));
+        }
 
-        double max_amplitude = 0.0;
+        if (m_feature_extraction)
+        {
+            m_feature_extractor.extract(samples, power_spectrum, m_results.frame(channel, frame),
+                                        m_features.frame(channel, frame));
+        }
+    }
 
-        for (int band_idx = 0; band_idx < 5; ++band_idx)
+    StridedSpan<const double> BatchAnalyzer::derived_series(
+        const BandTensor& tensor,
+        const size_t column,
+        const ChannelHandle channel) const
+    {
+        if (channel >= get_channel_count())
         {
-            const auto curr_band = static_cast<data::FrequencyBand>(band_idx);
-            const auto& band_amplitudes = get_band_amplitude(curr_band, channel_name);
-            if (frame_index < band_amplitudes.size())
-            {
-                max_amplitude = std::max(max_amplitude, band_amplitudes[frame_index]);
-            }
+            throw std::out_of_range(fmt::format("Channel handle {} out of range", channel));
         }
 
-        for (int band_idx = 0; band_idx < 5; ++band_idx)
+        if (channel >= tensor.get_channel_count())
         {
-            const auto curr_band = static_cast<data::FrequencyBand>(band_idx);
-            const auto& band_amplitudes = get_band_amplitude(curr_band, channel_name);
+            return {};
+        }
 
-            const double amplitude = (frame_index < band_amplitudes.size()) ? band_amplitudes[frame_index] : 0.0;
+        return tensor.band(channel, column);
+    }
 
-            result[band_idx].band = curr_band;
-            result[band_idx].radius_multiplier = calculate_radius_multiplier(amplitude, max_amplitude);
-            result[band_idx].transparency = calculate_transparency(amplitude, max_amplitude);
+    StridedSpan<const double> BatchAnalyzer::get_peak_frequency(const size_t band_index, const ChannelHandle channel) const
+    {
+        if (band_index >= get_band_count())
+        {
+            throw std::out_of_range(fmt::format("Band index {} out of range", band_index));
         }
 
-        return result;
+        return derived_series(m_peak_frequencies, band_index, channel);
     }
 
-    double BatchAnalyzer::calculate_band_amplitude(
-        const kfr::univector<double>& power_spectrum,
-        const double freq_resolution,
-        const double min_freq,
-        const double max_freq)
+    StridedSpan<const double> BatchAnalyzer::get_peak_frequency(
+        const size_t band_index,
+        const std::string_view channel_name) const
     {
-        double band_power = 0.0;
-
-        const auto min_bin = static_cast<size_t>(std::ceil(min_freq / freq_resolution));
-        const auto max_bin = static_cast<size_t>(std::floor(max_freq / freq_resolution));
+        return get_peak_frequency(band_index, get_channel_handle(channel_name));
+    }
 
-        for (size_t i = min_bin; i <= max_bin && i < power_spectrum.size(); ++i)
+    StridedSpan<const double> BatchAnalyzer::get_peak_power(const size_t band_index, const ChannelHandle channel) const
+    {
+        if (band_index >= get_band_count())
         {
-            band_power += power_spectrum[i];
+            throw std::out_of_range(fmt::format("Band index {} out of range", band_index));
         }
 
-        return std::sqrt(band_power);
+        return derived_series(m_peak_powers, band_index, channel);
     }
 
-    double BatchAnalyzer::calculate_radius_multiplier(const double amplitude, const double max_amplitude)
+    StridedSpan<const double> BatchAnalyzer::get_peak_power(
+        const size_t band_index,
+        const std::string_view channel_name) const
     {
-        if (max_amplitude <= 0.0)
-            return 0.0;
-
-        const double normalized = amplitude / max_amplitude;
+        return get_peak_power(band_index, get_channel_handle(channel_name));
+    }
 
-        constexpr double base_radius = 0.2;
-        constexpr double max_radius = 1.0;
+    StridedSpan<const double> BatchAnalyzer::get_aperiodic_exponent(const ChannelHandle channel) const
+    {
+        return derived_series(m_aperiodic, 1, channel);
+    }
 
-        return base_radius + normalized * (max_radius - base_radius);
+    StridedSpan<const double> BatchAnalyzer::get_aperiodic_offset(const ChannelHandle channel) const
+    {
+        return derived_series(m_aperiodic, 0, channel);
     }
 
-    double BatchAnalyzer::calculate_transparency(const double amplitude, const double max_amplitude)
+    void BatchAnalyzer::set_band_set(BandSet bands)
     {
-        if (max_amplitude <= 0.0)
-            return 0.0;
+        // before anything changes, the band ratios may name bands the new set doesnt have
+        BandTensor old_features;
+        if (m_feature_extraction)
+        {
+            m_feature_extractor = FeatureExtractor(bands, m_sampling_rate, m_window_size, m_feature_extractor.get_options());
+            old_features = std::exchange(m_features, BandTensor(m_feature_extractor.get_feature_count()));
+        }
+
+        // the base drops every flag, but only the muscle bit depends on the bands
+        auto artifact_masks = m_artifact_masks;
 
-        const double normalized = amplitude / max_amplitude;
+        FrequencyAnalyzer::set_band_set(std::move(bands));
+
+        // peaks of the old bands are dropped like the amplitudes
+        if (m_peak_tracking)
+        {
+            m_peak_tracker = PeakTracker(m_bands, m_sampling_rate, m_window_size, m_peak_tracker.get_options());
+            m_peak_frequencies = BandTensor(m_bands.size());
+            m_peak_powers = BandTensor(m_bands.size());
+            m_aperiodic = BandTensor(PeakTracker::APERIODIC_COUNT);
+        }
 
-        constexpr double min_transparency = 0.2;
-        constexpr double max_transparency = 1.0;
+        if (m_spectrogram.empty())
+        {
+            return;
+        }
 
-        return min_transparency + normalized * (max_transparency - min_transparency);
+        std::vector<ChannelHandle> channels;
+        for (ChannelHandle channel = 0; channel < m_spectrogram.get_channel_count(); ++channel)
+        {
+            if (m_spectrogram.get_frame_count(channel) > 0)
+            {
+                m_results.resize_frames(channel, m_spectrogram.get_frame_count(channel));
+                prepare_derived(channel, m_spectrogram.get_frame_count(channel));
+                m_artifact_masks[channel] = std::move(artifact_masks[channel]);
+                channels.push_back(channel);
+            }
+        }
+
+        // re-band straight from the stored spectra, the raw samples arent touched
+        utils::parallel_for(channels.size(), [&](const size_t begin, const size_t end) {
+            std::vector<double> power(m_spectrogram.get_bin_count());
+            auto peak_tracker = m_peak_tracker;
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                const ChannelHandle channel = channels[i];
+
+                for (size_t frame = 0; frame < m_spectrogram.get_frame_count(channel); ++frame)
+                {
+                    m_spectrogram.read_frame(channel, frame, power);
+                    store_frame(channel, frame, power);
+
+                    if (m_peak_tracking)
+                    {
+                        peak_tracker.track(power, m_peak_frequencies.frame(channel, frame),
+                                           m_peak_powers.frame(channel, frame), m_aperiodic.frame(channel, frame));
+                    }
+
+                    // hjorth columns only see the samples, they carry over; the rest follows the new spectrum.
+                    // frames extracted before features were enabled have no hjorth columns and stay NaN
+                    if (m_feature_extraction)
+                    {
+                        const auto features = m_features.frame(channel, frame);
+
+                        if (channel < old_features.get_channel_count() && frame < old_features.get_frame_count(channel))
+                        {
+                            std::ranges::copy(std::as_const(old_features).frame(channel, frame)
+                                                  .first(static_cast<size_t>(Feature::SpectralEntropy)),
+                                              features.begin());
+                        }
+                        else
+                        {
+                            m_feature_extractor.extract_temporal({}, features);
+                        }
+
+                        m_feature_extractor.extract_spectral(power, m_results.frame(channel, frame), features);
+                    }
+                }
+
+                redetect_muscle_artifacts(channel, m_spectrogram.get_frame_count(channel));
+            }
+        });
     }
 } // namespace brainviz::analysis
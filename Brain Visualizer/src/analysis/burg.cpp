@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include <analysis/burg.hpp>
+
+namespace brainviz::analysis
+{
+    BurgEstimator::BurgEstimator(const size_t window_size, const size_t segment_size, const size_t order)
+        : SpectralEstimator(window_size)
+    {
+        m_segment_size = (segment_size == 0) ? window_size / 4 : segment_size;
+        m_segment_size = std::clamp<size_t>(m_segment_size, std::min<size_t>(4, window_size), window_size);
+
+        m_order = (order == 0) ? std::clamp<size_t>(m_segment_size / 4, 2, 16) : order;
+        m_order = std::clamp<size_t>(m_order, 1, m_segment_size - 1);
+
+        const size_t points = get_bin_count() * OVERSAMPLE;
+
+        m_cos.resize((m_order + 1) * points);
+        m_sin.resize((m_order + 1) * points);
+
+        for (size_t point = 0; point < points; ++point)
+        {
+            // points sit at the centres of OVERSAMPLE equal slices of the bin
+            const double offset = (static_cast<double>(point % OVERSAMPLE) + 0.5) / OVERSAMPLE - 0.5;
+            const double omega = 2.0 * std::numbers::pi * (static_cast<double>(point / OVERSAMPLE) + offset) /
+                                 static_cast<double>(window_size);
+
+            for (size_t lag = 0; lag <= m_order; ++lag)
+            {
+                m_cos[lag * points + point] = std::cos(omega * static_cast<double>(lag));
+                m_sin[lag * points + point] = std::sin(omega * static_cast<double>(lag));
+            }
+        }
+
+        m_forward.resize(m_segment_size);
+        m_backward.resize(m_segment_size);
+        m_coefficients.resize(m_order + 1);
+        m_previous.resize(m_order + 1);
+        m_response_re.resize(points);
+        m_response_im.resize(points);
+    }
+
+    double BurgEstimator::fit(const std::span<const double> segment)
+    {
+        const size_t n = segment.size();
+
+        double mean = 0.0;
+        for (const double sample : segment)
+        {
+            mean += sample;
+        }
+        mean /= static_cast<double>(n);
+
+        double error = 0.0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            m_forward[i] = m_backward[i] = segment[i] - mean;
+            error += m_forward[i] * m_forward[i];
+        }
+        error /= static_cast<double>(n);
+
+        std::fill(m_coefficients.begin(), m_coefficients.end(), 0.0);
+        m_coefficients[0] = 1.0;
+
+        const size_t order = std::min(m_order, n - 1);
+
+        for (size_t m = 1; m <= order; ++m)
+        {
+            // reflection coefficient minimizing forward plus backward error, f[m, n) against b[m - 1, n - 1)
+            double numerator = 0.0;
+            double denominator = 0.0;
+
+            for (size_t i = m; i < n; ++i)
+            {
+                numerator += m_forward[i] * m_backward[i - 1];
+                denominator += m_forward[i] * m_forward[i] + m_backward[i - 1] * m_backward[i - 1];
+            }
+
+            if (!(denominator > 0.0))
+            {
+                break;
+            }
+
+            const double k = -2.0 * numerator / denominator;
+
+            // levinson update of the coefficients
+            std::copy_n(m_coefficients.begin(), m + 1, m_previous.begin());
+            for (size_t j = 1; j <= m; ++j)
+            {
+                m_coefficients[j] = m_previous[j] + k * m_previous[m - j];
+            }
+
+            // downwards, so b[i - 1] is still the previous stage's when b[i] is written
+            for (size_t i = n - 1; i >= m; --i)
+            {
+                const double forward = m_forward[i];
+                m_forward[i] = forward + k * m_backward[i - 1];
+                m_backward[i] = m_backward[i - 1] + k * forward;
+            }
+
+            error *= 1.0 - k * k;
+        }
+
+        return error;
+    }
+
+    const kfr::univector<double>& BurgEstimator::compute(const std::span<const double> frame)
+    {
+        // the newest samples of the frame, frames shorter than the window are zero padded at the end
+        const size_t available = std::min(frame.size(), m_window_size);
+        const size_t count = std::min(available, m_segment_size);
+
+        if (count < 2)
+        {
+            std::fill(m_power_spectrum.begin(), m_power_spectrum.end(), 0.0);
+            return m_power_spectrum;
+        }
+
+        const double error = fit(frame.subspan(available - count, count));
+
+        // |A(w)|^2 at every point, lag rows are contiguous so the sums vectorize
+        const size_t points = get_bin_count() * OVERSAMPLE;
+
+        std::fill(m_response_re.begin(), m_response_re.end(), 0.0);
+        std::fill(m_response_im.begin(), m_response_im.end(), 0.0);
+
+        for (size_t lag = 0; lag <= m_order; ++lag)
+        {
+            const double a = m_coefficients[lag];
+            const double* c = m_cos.data() + lag * points;
+            const double* s = m_sin.data() + lag * points;
+
+            for (size_t point = 0; point < points; ++point)
+            {
+                m_response_re[point] += a * c[point];
+                m_response_im[point] -= a * s[point];
+            }
+        }
+
+        const double scale = m_reference_energy * error / OVERSAMPLE;
+
+        for (size_t k = 0; k < get_bin_count(); ++k)
+        {
+            double sum = 0.0;
+            for (size_t j = 0; j < OVERSAMPLE; ++j)
+            {
+                const size_t point = k * OVERSAMPLE + j;
+                const double response = m_response_re[point] * m_response_re[point] +
+                                        m_response_im[point] * m_response_im[point];
+                sum += response > 0.0 ? 1.0 / response : 0.0;
+            }
+
+            m_power_spectrum[k] = sum * scale;
+        }
+
+        return m_power_spectrum;
+    }
+} // namespace brainviz::analysis
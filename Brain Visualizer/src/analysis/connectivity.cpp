@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <kfr/all.hpp>
+
+#include <utils/parallel.hpp>
+#include <analysis/frequency_analyzer.hpp>
+#include <analysis/connectivity.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // output frames per pass, the in-band spectra of a pass and its averaging lead stay in memory
+        constexpr size_t FRAME_BLOCK = 32;
+    }
+
+    ConnectivityEngine::ConnectivityEngine(const FrequencyAnalyzer& analyzer, const ConnectivityOptions options)
+        : m_analyzer(analyzer),
+          m_options(options),
+          m_channels(analyzer.get_channel_count()),
+          m_window_size(analyzer.get_window_size()),
+          m_hop_size(analyzer.get_hop_size())
+    {
+        m_options.averaging_frames = std::max<size_t>(m_options.averaging_frames, 1);
+
+        const auto& table = analyzer.get_band_table();
+
+        size_t lowest = std::numeric_limits<size_t>::max();
+        size_t highest = 0;
+
+        for (size_t band = 0; band < table.get_band_count(); ++band)
+        {
+            if (!table.is_band_empty(band))
+            {
+                lowest = std::min(lowest, table.first_bin(band));
+                highest = std::max(highest, table.last_bin(band));
+            }
+        }
+
+        if (lowest <= highest)
+        {
+            m_first_bin = lowest;
+            m_bin_count = highest - lowest + 1;
+        }
+
+        for (size_t band = 0; band < table.get_band_count(); ++band)
+        {
+            if (table.is_band_empty(band))
+            {
+                m_band_bins.emplace_back(0, 0);
+            }
+            else
+            {
+                m_band_bins.emplace_back(table.first_bin(band) - m_first_bin, table.last_bin(band) - m_first_bin + 1);
+            }
+        }
+    }
+
+    size_t ConnectivityEngine::pair_index(const ChannelHandle a, const ChannelHandle b) const
+    {
+        if (a == b || a >= m_channels || b >= m_channels)
+        {
+            throw std::out_of_range(fmt::format("No channel pair ({}, {}) among {} channels", a, b, m_channels));
+        }
+
+        const size_t i = std::min(a, b);
+        const size_t j = std::max(a, b);
+
+        return i * m_channels - i * (i + 1) / 2 + (j - i - 1);
+    }
+
+    std::pair<ChannelHandle, ChannelHandle> ConnectivityEngine::get_pair(size_t pair) const
+    {
+        if (pair >= get_pair_count())
+        {
+            throw std::out_of_range(fmt::format("Pair {} out of range, {} pairs", pair, get_pair_count()));
+        }
+
+        ChannelHandle i = 0;
+        while (pair >= m_channels - i - 1)
+        {
+            pair -= m_channels - i - 1;
+            ++i;
+        }
+
+        return {i, i + 1 + pair};
+    }
+
+    size_t ConnectivityEngine::result_offset(const size_t frame, const size_t pair) const
+    {
+        if (frame < m_first_frame || frame >= m_first_frame + m_frame_count || pair >= get_pair_count())
+        {
+            throw std::out_of_range(fmt::format("Connectivity of frame {} pair {} not computed", frame, pair));
+        }
+
+        return ((frame - m_first_frame) * get_pair_count() + pair) * get_band_count();
+    }
+
+    std::span<const float> ConnectivityEngine::get_coherence(const size_t frame, const size_t pair) const
+    {
+        return {m_coherence.data() + result_offset(frame, pair), get_band_count()};
+    }
+
+    std::span<const float> ConnectivityEngine::get_phase_locking(const size_t frame, const size_t pair) const
+    {
+        return {m_phase_locking.data() + result_offset(frame, pair), get_band_count()};
+    }
+
+    std::span<const float> ConnectivityEngine::coherence_frame(const size_t frame) const
+    {
+        return {m_coherence.data() + result_offset(frame, 0), get_pair_count() * get_band_count()};
+    }
+
+    std::span<const float> ConnectivityEngine::phase_locking_frame(const size_t frame) const
+    {
+        return {m_phase_locking.data() + result_offset(frame, 0), get_pair_count() * get_band_count()};
+    }
+
+    void ConnectivityEngine::compute(const size_t first_frame, const size_t frame_count)
+    {
+        const size_t channels = m_channels;
+        const size_t pairs = get_pair_count();
+        const size_t bands = get_band_count();
+        const size_t bins = m_bin_count;
+        const size_t n = m_window_size;
+        const size_t lead = m_options.averaging_frames - 1;
+
+        m_first_frame = first_frame;
+        m_frame_count = frame_count;
+        m_coherence.assign(frame_count * pairs * bands, 0.0f);
+        m_phase_locking.assign(frame_count * pairs * bands, 0.0f);
+
+        if (channels < 2 || frame_count == 0 || bins == 0)
+        {
+            return;
+        }
+
+        const auto& eeg_data = m_analyzer.get_eeg_data();
+        std::vector<const std::vector<double>*> raw_data(channels);
+        for (ChannelHandle channel = 0; channel < channels; ++channel)
+        {
+            raw_data[channel] = &eeg_data.get_channel(m_analyzer.get_channel_name(channel));
+        }
+
+        const kfr::dft_plan<double> dft(n);
+        const kfr::univector<double> hann = periodic_hann(n);
+
+        // upper triangle of channel tiles, diagonal tiles included
+        const size_t tile_count = (channels + TILE - 1) / TILE;
+        std::vector<std::pair<size_t, size_t> > tiles;
+        for (size_t ti = 0; ti < tile_count; ++ti)
+        {
+            for (size_t tj = ti; tj < tile_count; ++tj)
+            {
+                tiles.emplace_back(ti, tj);
+            }
+        }
+
+        const size_t slots = FRAME_BLOCK + lead;
+        const size_t averaging = m_options.averaging_frames;
+
+        // [slot][plane][channel][bin], planes are re, im of X and of X / |X|
+        std::vector<double> spectra(slots * 4 * channels * bins);
+
+        const auto plane = [&](const size_t slot, const size_t p, const size_t channel) {
+            return spectra.data() + ((slot * 4 + p) * channels + channel) * bins;
+        };
+
+        // slots hold source frames [held_first, held_first + held)
+        size_t held_first = first_frame >= lead ? first_frame - lead : 0;
+        size_t held = 0;
+
+        for (size_t block_first = first_frame; block_first < first_frame + frame_count; block_first += FRAME_BLOCK)
+        {
+            const size_t block_end = std::min(first_frame + frame_count, block_first + FRAME_BLOCK);
+
+            // keep only the lead the first frame of this block still averages over
+            const size_t keep_first = block_first >= lead ? block_first - lead : 0;
+            const size_t drop = std::min(held, keep_first - held_first);
+            if (drop > 0)
+            {
+                held -= drop;
+                std::memmove(spectra.data(), spectra.data() + drop * 4 * channels * bins,
+                             held * 4 * channels * bins * sizeof(double));
+            }
+            held_first = keep_first;
+
+            const size_t new_first = held_first + held;
+            const size_t new_count = block_end - new_first;
+            const size_t new_slot = held;
+
+            // every new frame of every channel, two channels per complex FFT
+            const size_t channel_pairs = (channels + 1) / 2;
+
+            utils::parallel_for(new_count * channel_pairs, [&](const size_t begin, const size_t end) {
+                kfr::univector<kfr::complex<double> > input(n);
+                kfr::univector<kfr::complex<double> > output(n);
+                kfr::univector<uint8_t> temp(dft.temp_size);
+
+                for (size_t item = begin; item < end; ++item)
+                {
+                    const size_t frame = new_first + item / channel_pairs;
+                    const size_t slot = new_slot + item / channel_pairs;
+                    const size_t a = 2 * (item % channel_pairs);
+                    const size_t b = a + 1;
+
+                    const size_t start = frame * m_hop_size;
+
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        const double xa = start + i < raw_data[a]->size() ? (*raw_data[a])[start + i] * hann[i] : 0.0;
+                        const double xb = b < channels && start + i < raw_data[b]->size()
+                                              ? (*raw_data[b])[start + i] * hann[i]
+                                              : 0.0;
+                        input[i] = kfr::complex<double>(xa, xb);
+                    }
+
+                    dft.execute(output, input, temp, false);
+
+                    for (size_t c = a; c < std::min(b + 1, channels); ++c)
+                    {
+                        double* xr = plane(slot, 0, c);
+                        double* xi = plane(slot, 1, c);
+                        double* ur = plane(slot, 2, c);
+                        double* ui = plane(slot, 3, c);
+
+                        for (size_t k = 0; k < bins; ++k)
+                        {
+                            const size_t bin = m_first_bin + k;
+                            const auto z = output[bin];
+                            const auto mirror = std::conj(output[(n - bin) % n]);
+
+                            // unpack the two real channels: A = (Z + conj Z') / 2, B = (Z - conj Z') / 2i
+                            const auto x = c == a
+                                               ? (z + mirror) * 0.5
+                                               : (z - mirror) * kfr::complex<double>(0.0, -0.5);
+
+                            xr[k] = x.real();
+                            xi[k] = x.imag();
+
+                            const double magnitude = std::abs(x);
+                            ur[k] = magnitude > 0.0 ? x.real() / magnitude : 0.0;
+                            ui[k] = magnitude > 0.0 ? x.imag() / magnitude : 0.0;
+                        }
+                    }
+                }
+            });
+
+            held += new_count;
+
+            // one tile of pairs per task, walks the held frames keeping per bin sums over the averaging window
+            utils::parallel_for(tiles.size(), [&](const size_t begin, const size_t end) {
+                // [local pair][plane][bin], planes are re, im of sum X_i conj(X_j) and of sum U_i conj(U_j)
+                std::vector<double> cross(TILE * TILE * 4 * bins);
+                // [local channel][bin] sum |X|^2, i tile rows then j tile rows
+                std::vector<double> power(2 * TILE * bins);
+
+                for (size_t t = begin; t < end; ++t)
+                {
+                    const size_t i_first = tiles[t].first * TILE;
+                    const size_t j_first = tiles[t].second * TILE;
+                    const size_t i_end = std::min(channels, i_first + TILE);
+                    const size_t j_end = std::min(channels, j_first + TILE);
+
+                    std::fill(cross.begin(), cross.end(), 0.0);
+                    std::fill(power.begin(), power.end(), 0.0);
+
+                    // add the frame in slot, or take it out again when it leaves the window
+                    const auto accumulate = [&](const size_t slot, const double sign) {
+                        for (size_t c = 0; c < 2 * TILE; ++c)
+                        {
+                            const size_t channel = c < TILE ? i_first + c : j_first + c - TILE;
+                            if (channel >= (c < TILE ? i_end : j_end))
+                            {
+                                continue;
+                            }
+
+                            const double* xr = plane(slot, 0, channel);
+                            const double* xi = plane(slot, 1, channel);
+                            double* p = power.data() + c * bins;
+                            for (size_t k = 0; k < bins; ++k)
+                            {
+                                p[k] += sign * (xr[k] * xr[k] + xi[k] * xi[k]);
+                            }
+                        }
+
+                        for (size_t i = i_first; i < i_end; ++i)
+                        {
+                            const double* xr_i = plane(slot, 0, i);
+                            const double* xi_i = plane(slot, 1, i);
+                            const double* ur_i = plane(slot, 2, i);
+                            const double* ui_i = plane(slot, 3, i);
+
+                            for (size_t j = std::max(j_first, i + 1); j < j_end; ++j)
+                            {
+                                const double* xr_j = plane(slot, 0, j);
+                                const double* xi_j = plane(slot, 1, j);
+                                const double* ur_j = plane(slot, 2, j);
+                                const double* ui_j = plane(slot, 3, j);
+
+                                double* s = cross.data() + ((i - i_first) * TILE + (j - j_first)) * 4 * bins;
+                                double* cr = s;
+                                double* ci = s + bins;
+                                double* pr = s + 2 * bins;
+                                double* pi = s + 3 * bins;
+
+                                for (size_t k = 0; k < bins; ++k)
+                                {
+                                    cr[k] += sign * (xr_i[k] * xr_j[k] + xi_i[k] * xi_j[k]);
+                                    ci[k] += sign * (xi_i[k] * xr_j[k] - xr_i[k] * xi_j[k]);
+                                    pr[k] += sign * (ur_i[k] * ur_j[k] + ui_i[k] * ui_j[k]);
+                                    pi[k] += sign * (ui_i[k] * ur_j[k] - ur_i[k] * ui_j[k]);
+                                }
+                            }
+                        }
+                    };
+
+                    for (size_t slot = 0; slot < held; ++slot)
+                    {
+                        accumulate(slot, 1.0);
+                        if (slot >= averaging)
+                        {
+                            accumulate(slot - averaging, -1.0);
+                        }
+
+                        const size_t frame = held_first + slot;
+                        if (frame < block_first)
+                        {
+                            continue;
+                        }
+
+                        const auto averaged = static_cast<double>(std::min(slot + 1, averaging));
+
+                        for (size_t i = i_first; i < i_end; ++i)
+                        {
+                            const double* power_i = power.data() + (i - i_first) * bins;
+
+                            for (size_t j = std::max(j_first, i + 1); j < j_end; ++j)
+                            {
+                                const double* power_j = power.data() + (TILE + j - j_first) * bins;
+                                const double* s = cross.data() + ((i - i_first) * TILE + (j - j_first)) * 4 * bins;
+                                const size_t out = ((frame - first_frame) * pairs + pair_index(i, j)) * bands;
+
+                                for (size_t band = 0; band < bands; ++band)
+                                {
+                                    const auto [band_first, band_last] = m_band_bins[band];
+                                    if (band_first == band_last)
+                                    {
+                                        continue;
+                                    }
+
+                                    double coherence = 0.0;
+                                    double phase_locking = 0.0;
+
+                                    for (size_t k = band_first; k < band_last; ++k)
+                                    {
+                                        const double cr = s[k], ci = s[bins + k];
+                                        const double pr = s[2 * bins + k], pi = s[3 * bins + k];
+                                        const double auto_power = power_i[k] * power_j[k];
+
+                                        coherence += auto_power > 0.0 ? (cr * cr + ci * ci) / auto_power : 0.0;
+                                        phase_locking += std::sqrt(pr * pr + pi * pi);
+                                    }
+
+                                    const auto band_bins = static_cast<double>(band_last - band_first);
+                                    m_coherence[out + band] = static_cast<float>(coherence / band_bins);
+                                    m_phase_locking[out + band] = static_cast<float>(
+                                        phase_locking / (averaged * band_bins));
+                                }
+                            }
+                        }
+                    }
+                }
+            }, 1);
+        }
+    }
+} // namespace brainviz::analysis
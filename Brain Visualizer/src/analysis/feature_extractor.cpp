@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <analysis/feature_extractor.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+        double& column(const std::span<double> features, const Feature feature)
+        {
+            return features[static_cast<size_t>(feature)];
+        }
+    }
+
+    FeatureExtractor::FeatureExtractor(
+        const BandSet& bands,
+        const double sampling_rate,
+        const size_t window_size,
+        FeatureOptions options)
+        : m_options(std::move(options)),
+          m_frequency_resolution(sampling_rate / static_cast<double>(window_size))
+    {
+        const size_t bins = window_size / 2 + 1;
+        const double max_freq = m_options.max_freq > 0.0 ? m_options.max_freq : sampling_rate / 2.0;
+
+        m_first_bin = std::max<size_t>(static_cast<size_t>(std::ceil(m_options.min_freq / m_frequency_resolution)), 1);
+        m_last_bin = std::min(static_cast<size_t>(std::floor(max_freq / m_frequency_resolution)), bins - 1);
+
+        if (m_last_bin < m_first_bin)
+        {
+            throw std::invalid_argument(fmt::format(
+                "Spectral feature range {}-{} Hz holds no bins at {:.3f} Hz resolution",
+                m_options.min_freq, max_freq, m_frequency_resolution));
+        }
+
+        m_names = {"HjorthActivity", "HjorthMobility", "HjorthComplexity", "SpectralEntropy", "SpectralEdge"};
+
+        for (const auto& ratio : m_options.band_ratios)
+        {
+            const auto numerator = bands.find(ratio.numerator);
+            const auto denominator = bands.find(ratio.denominator);
+
+            if (!numerator || !denominator)
+            {
+                throw std::invalid_argument(fmt::format(
+                    "Band ratio {}/{} names a band the band set doesnt have", ratio.numerator, ratio.denominator));
+            }
+
+            m_ratios.emplace_back(*numerator, *denominator);
+            m_names.push_back(fmt::format("{}/{}", ratio.numerator, ratio.denominator));
+        }
+    }
+
+    void FeatureExtractor::extract(
+        const std::span<const double> samples,
+        const std::span<const double> power_spectrum,
+        const std::span<const double> band_amplitudes,
+        const std::span<double> features) const
+    {
+        extract_temporal(samples, features);
+        extract_spectral(power_spectrum, band_amplitudes, features);
+    }
+
+    void FeatureExtractor::extract_temporal(const std::span<const double> samples, const std::span<double> features) const
+    {
+        column(features, Feature::HjorthActivity) = NaN;
+        column(features, Feature::HjorthMobility) = NaN;
+        column(features, Feature::HjorthComplexity) = NaN;
+
+        // hjorth: variance of the signal and of its first and second differences
+        const size_t count = samples.size();
+        if (count >= 3)
+        {
+            double mean = 0.0;
+            for (const double sample : samples)
+            {
+                mean += sample;
+            }
+            mean /= static_cast<double>(count);
+
+            double variance = 0.0;
+            double d1_sum = 0.0, d1_squares = 0.0;
+            double d2_sum = 0.0, d2_squares = 0.0;
+
+            // branch free over the samples that have both differences, the last two are added after
+            for (size_t i = 0; i + 2 < count; ++i)
+            {
+                const double centred = samples[i] - mean;
+                const double d1 = samples[i + 1] - samples[i];
+                const double d2 = samples[i + 2] - 2.0 * samples[i + 1] + samples[i];
+
+                variance += centred * centred;
+                d1_sum += d1;
+                d1_squares += d1 * d1;
+                d2_sum += d2;
+                d2_squares += d2 * d2;
+            }
+
+            const double last_d1 = samples[count - 1] - samples[count - 2];
+            d1_sum += last_d1;
+            d1_squares += last_d1 * last_d1;
+
+            for (size_t i = count - 2; i < count; ++i)
+            {
+                variance += (samples[i] - mean) * (samples[i] - mean);
+            }
+
+            const auto n1 = static_cast<double>(count - 1);
+            const auto n2 = static_cast<double>(count - 2);
+
+            variance /= static_cast<double>(count);
+            const double d1_variance = std::max(d1_squares / n1 - (d1_sum / n1) * (d1_sum / n1), 0.0);
+            const double d2_variance = std::max(d2_squares / n2 - (d2_sum / n2) * (d2_sum / n2), 0.0);
+
+            column(features, Feature::HjorthActivity) = variance;
+
+            if (variance > 0.0)
+            {
+                const double mobility = std::sqrt(d1_variance / variance);
+                column(features, Feature::HjorthMobility) = mobility;
+
+                if (d1_variance > 0.0)
+                {
+                    column(features, Feature::HjorthComplexity) = std::sqrt(d2_variance / d1_variance) / mobility;
+                }
+            }
+        }
+    }
+
+    void FeatureExtractor::extract_spectral(
+        const std::span<const double> power_spectrum,
+        const std::span<const double> band_amplitudes,
+        const std::span<double> features) const
+    {
+        std::fill(features.begin() + static_cast<std::ptrdiff_t>(Feature::SpectralEntropy), features.end(), NaN);
+
+        // entropy and edge frequency over the bins of the spectral range
+        const size_t last_bin = std::min(m_last_bin, power_spectrum.size() - 1);
+        if (!power_spectrum.empty() && last_bin >= m_first_bin)
+        {
+            double total = 0.0;
+            for (size_t bin = m_first_bin; bin <= last_bin; ++bin)
+            {
+                total += power_spectrum[bin];
+            }
+
+            if (total > 0.0)
+            {
+                double entropy = 0.0;
+                double below = 0.0;
+                const double edge_power = m_options.edge_fraction * total;
+
+                for (size_t bin = m_first_bin; bin <= last_bin; ++bin)
+                {
+                    const double power = power_spectrum[bin];
+                    if (power > 0.0)
+                    {
+                        const double p = power / total;
+                        entropy -= p * std::log(p);
+                    }
+
+                    // bins cover [bin - 1/2, bin + 1/2), the edge is interpolated inside the bin that crosses it
+                    if (below < edge_power && below + power >= edge_power)
+                    {
+                        const double t = (edge_power - below) / power;
+                        column(features, Feature::SpectralEdge) =
+                            (static_cast<double>(bin) - 0.5 + t) * m_frequency_resolution;
+                    }
+
+                    below += power;
+                }
+
+                const auto bins = static_cast<double>(last_bin - m_first_bin + 1);
+                column(features, Feature::SpectralEntropy) = bins > 1.0 ? entropy / std::log(bins) : 0.0;
+            }
+        }
+
+        // ratios of band power, the amplitudes are its square root
+        for (size_t i = 0; i < m_ratios.size(); ++i)
+        {
+            const double denominator = band_amplitudes[m_ratios[i].second];
+            if (denominator > 0.0)
+            {
+                const double numerator = band_amplitudes[m_ratios[i].first];
+                features[FIXED_FEATURES + i] = (numerator * numerator) / (denominator * denominator);
+            }
+        }
+    }
+} // namespace brainviz::analysis
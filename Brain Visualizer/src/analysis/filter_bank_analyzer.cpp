@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <logging/logger.hpp>
+#include <utils/parallel.hpp>
+#include <analysis/filter_bank_analyzer.hpp>
+
+namespace brainviz::analysis
+{
+    FilterBankAnalyzer::FilterBankAnalyzer(
+        const data::EEGData& eeg_data,
+        const size_t window_size,
+        const double overlap_percentage,
+        const FilterBankOptions options)
+        : FrequencyAnalyzer(eeg_data.m_samplingRate, window_size, overlap_percentage),
+          m_eeg_data(eeg_data),
+          m_options(options),
+          m_filter_bank(eeg_data.m_samplingRate, m_bands, options.order)
+    {
+        g_logger.info("Initialized filter bank analyzer, order {} {} with {} envelope", m_options.order,
+                      m_options.zero_phase ? "zero phase" : "causal",
+                      m_options.envelope == EnvelopeMode::Hilbert ? "hilbert" : "rms");
+    }
+
+    void FilterBankAnalyzer::set_band_set(BandSet bands)
+    {
+        FrequencyAnalyzer::set_band_set(std::move(bands));
+        m_filter_bank = IirFilterBank(m_sampling_rate, m_bands, m_options.order);
+    }
+
+    void FilterBankAnalyzer::process_all_channels()
+    {
+        process_channels(m_eeg_data.get_channel_names());
+    }
+
+    void FilterBankAnalyzer::process_channel(const std::string_view channel_name)
+    {
+        process_channels({std::string(channel_name)});
+    }
+
+    void FilterBankAnalyzer::filter_group(
+        const size_t band,
+        const std::span<const std::vector<double>* const> raw_data,
+        std::vector<std::vector<double> >& signals) const
+    {
+        size_t sample_count = 0;
+        for (const auto* raw : raw_data)
+        {
+            sample_count = std::max(sample_count, raw->size());
+        }
+
+        signals.resize(raw_data.size());
+        std::vector<double*> lanes(raw_data.size());
+
+        for (size_t lane = 0; lane < raw_data.size(); ++lane)
+        {
+            const auto& raw = *raw_data[lane];
+
+            // remove the mean so the high-pass doesnt start on a step
+            double mean = 0.0;
+            for (const double sample : raw)
+            {
+                mean += sample;
+            }
+            mean /= static_cast<double>(std::max<size_t>(raw.size(), 1));
+
+            signals[lane].assign(sample_count, 0.0);
+            for (size_t i = 0; i < raw.size(); ++i)
+            {
+                signals[lane][i] = raw[i] - mean;
+            }
+
+            lanes[lane] = signals[lane].data();
+        }
+
+        m_filter_bank.filter_block(band, lanes, sample_count, m_options.zero_phase);
+    }
+
+    void FilterBankAnalyzer::to_envelope_power(std::vector<double>& signal) const
+    {
+        if (m_options.envelope == EnvelopeMode::Rms)
+        {
+            for (double& sample : signal)
+            {
+                sample *= sample;
+            }
+            return;
+        }
+
+        HilbertTransform::Workspace workspace;
+        m_hilbert.analytic_signal(signal, workspace);
+
+        const auto fft_size = static_cast<double>(workspace.analytic.size());
+
+        // |a|^2 / 2 averages to the variance like x^2 does, 1 / N of the inverse squared in
+        const double scale = 0.5 / (fft_size * fft_size);
+
+        for (size_t i = 0; i < signal.size(); ++i)
+        {
+            signal[i] = std::norm(workspace.analytic[i]) * scale;
+        }
+    }
+
+    std::vector<double> FilterBankAnalyzer::compute_envelope(const std::string_view channel_name, const size_t band) const
+    {
+        if (band >= m_bands.size())
+        {
+            throw std::out_of_range(fmt::format("Band index {} out of range, {} bands", band, m_bands.size()));
+        }
+
+        const std::vector<double>* raw_data[] = {&m_eeg_data.get_channel(channel_name)};
+
+        std::vector<std::vector<double> > signals;
+        filter_group(band, raw_data, signals);
+
+        auto& power = signals.front();
+        to_envelope_power(power);
+
+        if (m_options.envelope == EnvelopeMode::Rms)
+        {
+            // smooth over one period of the band centre, centred so the envelope isnt delayed
+            const double centre = 0.5 * (m_bands[band].min_freq + m_bands[band].max_freq);
+            const auto half = static_cast<size_t>(0.5 * m_sampling_rate / std::max(centre, 1e-3));
+
+            std::vector<double> prefix(power.size() + 1, 0.0);
+            for (size_t i = 0; i < power.size(); ++i)
+            {
+                prefix[i + 1] = prefix[i] + power[i];
+            }
+
+            for (size_t i = 0; i < power.size(); ++i)
+            {
+                const size_t first = i > half ? i - half : 0;
+                const size_t last = std::min(power.size(), i + half + 1);
+                power[i] = (prefix[last] - prefix[first]) / static_cast<double>(last - first);
+            }
+        }
+
+        // a sinusoid of amplitude A has mean power A^2 / 2
+        for (double& value : power)
+        {
+            value = std::sqrt(2.0 * std::max(value, 0.0));
+        }
+
+        return power;
+    }
+
+    void FilterBankAnalyzer::process_channels(const std::vector<std::string>& channel_names)
+    {
+        m_visualization_table = {};
+
+        const size_t band_count = get_band_count();
+        const double variance_scale = variance_to_band_power();
+
+        std::vector<const std::vector<double>*> raw_data;
+        std::vector<ChannelHandle> channels;
+        size_t max_frames = 0;
+
+        for (const auto& channel_name : channel_names)
+        {
+            raw_data.push_back(&m_eeg_data.get_channel(channel_name));
+
+            max_frames = std::max(max_frames, frame_count(raw_data.back()->size()));
+
+            channels.push_back(add_channel_results(channel_name));
+        }
+
+        m_results.reserve_frames(max_frames);
+        for (size_t i = 0; i < channels.size(); ++i)
+        {
+            m_results.resize_frames(channels[i], frame_count(raw_data[i]->size()));
+        }
+
+        constexpr size_t lanes = IirFilterBank::LANES;
+        const size_t groups = (channels.size() + lanes - 1) / lanes;
+
+        // every (group, band) writes its own band column of the group's frames
+        utils::parallel_for(groups * band_count, [&](const size_t begin, const size_t end) {
+            std::vector<std::vector<double> > signals;
+            std::vector<double> prefix;
+
+            for (size_t item = begin; item < end; ++item)
+            {
+                const size_t group_start = (item / band_count) * lanes;
+                const size_t band = item % band_count;
+                const size_t group_size = std::min(lanes, channels.size() - group_start);
+
+                filter_group(band, std::span(raw_data).subspan(group_start, group_size), signals);
+
+                for (size_t lane = 0; lane < group_size; ++lane)
+                {
+                    const ChannelHandle channel = channels[group_start + lane];
+                    const size_t samples = raw_data[group_start + lane]->size();
+
+                    auto& power = signals[lane];
+                    to_envelope_power(power);
+
+                    prefix.resize(samples + 1);
+                    prefix[0] = 0.0;
+                    for (size_t i = 0; i < samples; ++i)
+                    {
+                        prefix[i + 1] = prefix[i] + power[i];
+                    }
+
+                    for (size_t frame = 0; frame < m_results.get_frame_count(channel); ++frame)
+                    {
+                        const size_t start = std::min(samples, frame * m_hop_size);
+                        const size_t stop = std::min(samples, start + m_window_size);
+                        const double mean = stop > start
+                                                ? (prefix[stop] - prefix[start]) / static_cast<double>(stop - start)
+                                                : 0.0;
+
+                        m_results.frame(channel, frame)[band] = std::sqrt(std::max(mean, 0.0) * variance_scale);
+                    }
+                }
+            }
+        });
+
+        // needs every band of a frame, so only once the bank is through
+        utils::parallel_for(channels.size(), [&](const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; ++i)
+            {
+                detect_artifacts(channels[i], *raw_data[i], 0, m_results.get_frame_count(channels[i]));
+            }
+        });
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,434 @@
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <kfr/all.hpp>
+
+#include <logging/logger.hpp>
+#include <utils/power_of_2.hpp>
+#include <analysis/frequency_analyzer.hpp>
+
+namespace brainviz::analysis
+{
+    FrequencyAnalyzer::FrequencyAnalyzer(
+        const double sampling_rate,
+        const size_t window_size,
+        const double overlap_percentage)
+        : m_sampling_rate(sampling_rate)
+    {
+        m_window_size = utils::round_to_power_of_2(window_size);
+
+        m_hop_size = static_cast<size_t>(m_window_size * (100.0 - overlap_percentage) / 100.0);
+
+        if (m_hop_size < 1)
+        {
+            m_hop_size = 1;
+        }
+
+        g_logger.info("Initialized frequency analyzer with window size {} (power of 2)", m_window_size);
+        g_logger.info("Using hop size {} ({:.1f}% overlap)", m_hop_size,
+                      100.0 * (1.0 - static_cast<double>(m_hop_size) / m_window_size));
+        g_logger.info("Frequency resolution: {:.3f} Hz", get_frequency_resolution());
+
+        FrequencyAnalyzer::set_band_set(BandSet::standard());
+    }
+
+    size_t FrequencyAnalyzer::frame_count(const size_t samples, const size_t window_size, const size_t hop_size)
+    {
+        return (samples > window_size) ? (samples - window_size) / hop_size + 1 : 1;
+    }
+
+    size_t FrequencyAnalyzer::time_index_to_frame(const size_t time_index) const
+    {
+        const size_t window_size = m_window_size;
+        const size_t hop_size = m_hop_size;
+
+        if (time_index < window_size / 2)
+        {
+            return 0;
+        }
+
+        size_t frame = (time_index - window_size / 2) / hop_size;
+        return std::min(frame, get_max_frame_index());
+    }
+
+    ChannelHandle FrequencyAnalyzer::get_channel_handle(const std::string_view channel_name) const
+    {
+        const auto channel = find_channel(channel_name);
+        if (!channel)
+        {
+            throw std::runtime_error(fmt::format("Channel not analyzed: {}", channel_name));
+        }
+
+        return *channel;
+    }
+
+    std::optional<ChannelHandle> FrequencyAnalyzer::find_channel(const std::string_view channel_name) const
+    {
+        const auto it = m_channel_handles.find(std::string(channel_name));
+        if (it == m_channel_handles.end())
+        {
+            return std::nullopt;
+        }
+
+        return it->second;
+    }
+
+    const std::string& FrequencyAnalyzer::get_channel_name(const ChannelHandle channel) const
+    {
+        if (channel >= m_channel_names.size())
+        {
+            throw std::out_of_range(fmt::format("Channel handle {} out of range", channel));
+        }
+
+        return m_channel_names[channel];
+    }
+
+    size_t FrequencyAnalyzer::get_frame_count(const ChannelHandle channel) const
+    {
+        return channel < m_results.get_channel_count() ? m_results.get_frame_count(channel) : 0;
+    }
+
+    std::span<const double> FrequencyAnalyzer::get_frame(const ChannelHandle channel, const size_t frame_index) const
+    {
+        if (channel >= m_results.get_channel_count() || frame_index >= m_results.get_frame_count(channel))
+        {
+            throw std::out_of_range(fmt::format("Frame {} of channel handle {} out of range", frame_index, channel));
+        }
+
+        return m_results.frame(channel, frame_index);
+    }
+
+    StridedSpan<const double> FrequencyAnalyzer::get_band_amplitude(
+        const size_t band_index,
+        const ChannelHandle channel) const
+    {
+        if (channel >= m_results.get_channel_count())
+        {
+            throw std::out_of_range(fmt::format("Channel handle {} out of range", channel));
+        }
+
+        if (band_index >= m_results.get_band_count())
+        {
+            throw std::out_of_range(fmt::format("Band index {} out of range", band_index));
+        }
+
+        return m_results.band(channel, band_index);
+    }
+
+    StridedSpan<const double> FrequencyAnalyzer::get_band_amplitude(
+        const size_t band_index,
+        const std::string_view channel_name) const
+    {
+        return get_band_amplitude(band_index, get_channel_handle(channel_name));
+    }
+
+    StridedSpan<const double> FrequencyAnalyzer::get_band_amplitude(
+        const data::FrequencyBand band,
+        const ChannelHandle channel) const
+    {
+        const auto band_idx = static_cast<size_t>(band);
+        if (band_idx >= m_standard_indices.size() || !m_standard_indices[band_idx])
+        {
+            throw std::invalid_argument(fmt::format("Band set has no {} band", BandSet::standard_name(band)));
+        }
+
+        return get_band_amplitude(*m_standard_indices[band_idx], channel);
+    }
+
+    StridedSpan<const double> FrequencyAnalyzer::get_band_amplitude(
+        const data::FrequencyBand band,
+        const std::string_view channel_name) const
+    {
+        return get_band_amplitude(band, get_channel_handle(channel_name));
+    }
+
+    size_t FrequencyAnalyzer::get_max_frame_index() const
+    {
+        if (get_channel_count() == 0)
+        {
+            return 0;
+        }
+
+        // channels can be a block apart while data is arriving, only report frames every channel has
+        size_t frames = get_frame_count(0);
+        for (ChannelHandle channel = 1; channel < get_channel_count(); ++channel)
+        {
+            frames = std::min(frames, get_frame_count(channel));
+        }
+
+        return frames > 0 ? frames - 1 : 0;
+    }
+
+    data::FrequencyBand FrequencyAnalyzer::get_dominant_band(
+        const ChannelHandle channel,
+        const size_t time_index) const
+    {
+        const size_t frame_index = time_index_to_frame(time_index);
+
+        double max_amplitude = -1.0;
+        auto dominant_band = data::FrequencyBand::Delta;
+
+        if (frame_index >= get_frame_count(channel))
+        {
+            return dominant_band;
+        }
+
+        const auto frame = get_frame(channel, frame_index);
+
+        for (int band_idx = 0; band_idx < 5; ++band_idx)
+        {
+            if (!m_standard_indices[band_idx])
+                continue;
+
+            const double amplitude = frame[*m_standard_indices[band_idx]];
+            if (amplitude > max_amplitude)
+            {
+                max_amplitude = amplitude;
+                dominant_band = static_cast<data::FrequencyBand>(band_idx);
+            }
+        }
+
+        return dominant_band;
+    }
+
+    data::FrequencyBand FrequencyAnalyzer::get_dominant_band(
+        const std::string_view channel_name,
+        const size_t time_index) const
+    {
+        return get_dominant_band(get_channel_handle(channel_name), time_index);
+    }
+
+    std::vector<FrequencyAnalyzer::VisualizationInfo> FrequencyAnalyzer::get_visualization_info(
+        const ChannelHandle channel,
+        const size_t time_index) const
+    {
+        return get_frame_visualization_info(channel, time_index_to_frame(time_index));
+    }
+
+    std::vector<FrequencyAnalyzer::VisualizationInfo> FrequencyAnalyzer::get_frame_visualization_info(
+        const ChannelHandle channel,
+        const size_t frame_index) const
+    {
+        std::vector<VisualizationInfo> result(get_band_count());
+        get_frame_visualization_info(channel, frame_index, result);
+
+        return result;
+    }
+
+    void FrequencyAnalyzer::get_frame_visualization_info(
+        const ChannelHandle channel,
+        const size_t frame_index,
+        const std::span<VisualizationInfo> info) const
+    {
+        const size_t bands = get_band_count();
+
+        std::span<const double> frame;
+        double max_amplitude = 0.0;
+
+        if (frame_index < get_frame_count(channel) && !is_artifact(channel, frame_index))
+        {
+            // one contiguous read for every band of the frame
+            frame = get_frame(channel, frame_index);
+            max_amplitude = std::ranges::max(frame);
+        }
+
+        for (size_t band_idx = 0; band_idx < bands; ++band_idx)
+        {
+            const double amplitude = frame.empty() ? 0.0 : frame[band_idx];
+
+            info[band_idx].band_index = band_idx;
+            info[band_idx].radius_multiplier = calculate_radius_multiplier(amplitude, max_amplitude);
+            info[band_idx].transparency = calculate_transparency(amplitude, max_amplitude);
+        }
+    }
+
+    std::vector<FrequencyAnalyzer::VisualizationInfo> FrequencyAnalyzer::get_visualization_info(
+        const std::string_view channel_name,
+        const size_t time_index) const
+    {
+        return get_visualization_info(get_channel_handle(channel_name), time_index);
+    }
+
+    void FrequencyAnalyzer::build_visualization_table()
+    {
+        m_visualization_table = VisualizationTable(*this);
+
+        g_logger.debug("Built visualization table: {} frames x {} channels",
+                       m_visualization_table.get_frame_count(), m_visualization_table.get_channel_count());
+    }
+
+    const VisualizationTable* FrequencyAnalyzer::find_visualization_table(const size_t frame_index) const
+    {
+        return m_visualization_table.contains(frame_index) ? &m_visualization_table : nullptr;
+    }
+
+    void FrequencyAnalyzer::set_band_set(BandSet bands)
+    {
+        if (bands.empty())
+        {
+            throw std::invalid_argument("Band set must hold at least one band");
+        }
+
+        m_bands = std::move(bands);
+        m_band_table = BandBinTable(m_bands, m_sampling_rate, m_window_size);
+        m_standard_indices = m_bands.standard_indices();
+
+        if (m_artifact_detection)
+        {
+            m_artifact_detector = ArtifactDetector(m_bands, m_artifact_detector.get_options());
+        }
+
+        for (auto& mask : m_artifact_masks)
+        {
+            mask.clear();
+        }
+
+        // same handles, no frames
+        m_visualization_table = {};
+        m_results = BandTensor(m_bands.size());
+        for (size_t i = 0; i < m_channel_names.size(); ++i)
+        {
+            m_results.add_channel();
+        }
+    }
+
+    ChannelHandle FrequencyAnalyzer::add_channel_results(const std::string& channel_name)
+    {
+        if (const auto it = m_channel_handles.find(channel_name); it != m_channel_handles.end())
+        {
+            return it->second;
+        }
+
+        const ChannelHandle channel = m_results.add_channel();
+        m_channel_handles.emplace(channel_name, channel);
+        m_channel_names.push_back(channel_name);
+        m_artifact_masks.emplace_back();
+
+        return channel;
+    }
+
+    void FrequencyAnalyzer::store_frame(
+        const ChannelHandle channel,
+        const size_t frame,
+        const std::span<const double> power_spectrum)
+    {
+        m_band_table.reduce(power_spectrum, m_results.frame(channel, frame));
+    }
+
+    void FrequencyAnalyzer::enable_artifact_detection(const ArtifactOptions options)
+    {
+        m_artifact_detector = ArtifactDetector(m_bands, options);
+        m_artifact_detection = true;
+    }
+
+    void FrequencyAnalyzer::disable_artifact_detection()
+    {
+        m_artifact_detection = false;
+    }
+
+    std::uint8_t FrequencyAnalyzer::get_artifact_flags(const ChannelHandle channel, const size_t frame_index) const
+    {
+        if (channel >= m_artifact_masks.size() || frame_index >= m_artifact_masks[channel].size())
+        {
+            return 0;
+        }
+
+        return m_artifact_masks[channel][frame_index];
+    }
+
+    std::span<const std::uint8_t> FrequencyAnalyzer::get_artifact_mask(const ChannelHandle channel) const
+    {
+        if (channel >= m_artifact_masks.size())
+        {
+            throw std::out_of_range(fmt::format("Channel handle {} out of range", channel));
+        }
+
+        return m_artifact_masks[channel];
+    }
+
+    void FrequencyAnalyzer::detect_artifacts(
+        const ChannelHandle channel,
+        const std::span<const double> samples,
+        const size_t first_frame,
+        const size_t frame_count)
+    {
+        auto& mask = m_artifact_masks[channel];
+        mask.resize(first_frame + frame_count, 0);
+
+        const auto flags = std::span(mask).subspan(first_frame, frame_count);
+
+        // frames analyzed with detection off are clean, stale flags of an earlier run must not stick
+        if (!m_artifact_detection)
+        {
+            std::fill(flags.begin(), flags.end(), std::uint8_t{0});
+            return;
+        }
+
+        m_artifact_detector.classify_samples(samples, m_window_size, m_hop_size, flags);
+
+        for (size_t i = 0; i < frame_count; ++i)
+        {
+            flags[i] |= m_artifact_detector.classify_bands(m_results.frame(channel, first_frame + i));
+        }
+    }
+
+    void FrequencyAnalyzer::redetect_muscle_artifacts(const ChannelHandle channel, const size_t frame_count)
+    {
+        auto& mask = m_artifact_masks[channel];
+        mask.resize(frame_count, 0);
+
+        if (!m_artifact_detection)
+        {
+            std::ranges::fill(mask, std::uint8_t{0});
+            return;
+        }
+
+        constexpr auto muscle = static_cast<std::uint8_t>(ArtifactFlag::Muscle);
+        for (size_t frame = 0; frame < frame_count; ++frame)
+        {
+            mask[frame] = (mask[frame] & ~muscle) | m_artifact_detector.classify_bands(m_results.frame(channel, frame));
+        }
+    }
+
+    double FrequencyAnalyzer::variance_to_band_power() const
+    {
+        // parseval over the one-sided spectrum of a hann windowed frame
+        const kfr::univector<double> hann = periodic_hann(m_window_size);
+
+        double hann_energy = 0.0;
+        for (const double w : hann)
+        {
+            hann_energy += w * w;
+        }
+
+        return 0.5 * static_cast<double>(m_window_size) * hann_energy;
+    }
+
+    double FrequencyAnalyzer::calculate_radius_multiplier(const double amplitude, const double max_amplitude)
+    {
+        if (max_amplitude <= 0.0)
+            return 0.0;
+
+        const double normalized = amplitude / max_amplitude;
+
+        constexpr double base_radius = 0.2;
+        constexpr double max_radius = 1.0;
+
+        return base_radius + normalized * (max_radius - base_radius);
+    }
+
+    double FrequencyAnalyzer::calculate_transparency(const double amplitude, const double max_amplitude)
+    {
+        if (max_amplitude <= 0.0)
+            return 0.0;
+
+        const double normalized = amplitude / max_amplitude;
+
+        constexpr double min_transparency = 0.2;
+        constexpr double max_transparency = 1.0;
+
+        return min_transparency + normalized * (max_transparency - min_transparency);
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,49 @@
+#include <utils/power_of_2.hpp>
+#include <analysis/hilbert_transform.hpp>
+
+namespace brainviz::analysis
+{
+    std::shared_ptr<const kfr::dft_plan<double> > HilbertTransform::get_plan(const size_t size) const
+    {
+        std::scoped_lock lock(m_plan_mutex);
+
+        auto& plan = m_plans[size];
+        if (!plan)
+        {
+            plan = std::make_shared<const kfr::dft_plan<double> >(size);
+        }
+        return plan;
+    }
+
+    void HilbertTransform::analytic_signal(const std::span<const double> signal, Workspace& workspace) const
+    {
+        const size_t fft_size = utils::next_power_of_2(signal.size());
+        const auto dft = get_plan(fft_size);
+
+        auto& analytic = workspace.analytic;
+        auto& spectrum = workspace.spectrum;
+
+        analytic.resize(fft_size);
+        spectrum.resize(fft_size);
+        workspace.temp.resize(dft->temp_size);
+
+        for (size_t i = 0; i < fft_size; ++i)
+        {
+            analytic[i] = kfr::complex<double>(i < signal.size() ? signal[i] : 0.0, 0.0);
+        }
+
+        dft->execute(spectrum, analytic, workspace.temp, false);
+
+        // keep DC and nyquist, double the positive and drop the negative frequencies
+        for (size_t k = 1; k < fft_size / 2; ++k)
+        {
+            spectrum[k] *= 2.0;
+        }
+        for (size_t k = fft_size / 2 + 1; k < fft_size; ++k)
+        {
+            spectrum[k] = kfr::complex<double>(0.0, 0.0);
+        }
+
+        dft->execute(analytic, spectrum, workspace.temp, true);
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,401 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <map>
+#include <mutex>
+#include <numbers>
+#include <stdexcept>
+#include <tuple>
+
+#include <fmt/format.h>
+
+#include <logging/logger.hpp>
+#include <analysis/iir_filter_bank.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // butterworth low-pass (high_pass = false) or high-pass sections of one edge, bilinear transform
+        void append_butterworth(
+            std::vector<Biquad>& sections,
+            const double sampling_rate,
+            const double cutoff,
+            const size_t order,
+            const bool high_pass)
+        {
+            const double w0 = 2.0 * std::numbers::pi * cutoff / sampling_rate;
+            const double cos_w0 = std::cos(w0);
+            const double sin_w0 = std::sin(w0);
+
+            // conjugate pole pairs, Q from the pole angles of the analog prototype
+            for (size_t k = 0; k < order / 2; ++k)
+            {
+                const double angle = std::numbers::pi * static_cast<double>(2 * k + 1) / static_cast<double>(2 * order);
+                const double q = 1.0 / (2.0 * std::cos(angle));
+                const double alpha = sin_w0 / (2.0 * q);
+                const double a0 = 1.0 + alpha;
+
+                const double edge = high_pass ? (1.0 + cos_w0) / 2.0 : (1.0 - cos_w0) / 2.0;
+
+                sections.push_back({
+                    edge / a0,
+                    (high_pass ? -2.0 : 2.0) * edge / a0,
+                    edge / a0,
+                    -2.0 * cos_w0 / a0,
+                    (1.0 - alpha) / a0
+                });
+            }
+
+            // the real pole of an odd order
+            if (order % 2 == 1)
+            {
+                const double k = std::tan(w0 / 2.0);
+                const double b0 = high_pass ? 1.0 / (1.0 + k) : k / (1.0 + k);
+
+                sections.push_back({b0, high_pass ? -b0 : b0, 0.0, (k - 1.0) / (k + 1.0), 0.0});
+            }
+        }
+
+        // butterworth band-pass of twice the given order: analog prototype poles moved to the band with the
+        // low-pass to band-pass transform, then bilinear. Each section gets one zero at DC and one at nyquist
+        void append_band_pass(
+            std::vector<Biquad>& sections,
+            const double sampling_rate,
+            const double low_freq,
+            const double high_freq,
+            const size_t order)
+        {
+            // prewarped edges so the digital -3 dB points land on the band edges
+            const double w_low = 2.0 * sampling_rate * std::tan(std::numbers::pi * low_freq / sampling_rate);
+            const double w_high = 2.0 * sampling_rate * std::tan(std::numbers::pi * high_freq / sampling_rate);
+            const double w_centre = std::sqrt(w_low * w_high);
+            const double bandwidth = w_high - w_low;
+
+            // the section gains are set for unit gain at the centre frequency
+            const std::complex<double> z_centre = std::polar(1.0, 2.0 * std::atan(w_centre / (2.0 * sampling_rate)));
+
+            for (size_t k = 0; k < order; ++k)
+            {
+                // the middle pole of an odd order is real, set exactly so its band-pass poles are exactly real or
+                // conjugate
+                const bool real_prototype = 2 * k + 1 == order;
+                const double angle =
+                    std::numbers::pi * static_cast<double>(2 * k + order + 1) / static_cast<double>(2 * order);
+                const std::complex<double> prototype = real_prototype ? -1.0 : std::polar(1.0, angle);
+
+                // each prototype pole splits into a conjugate pair's worth of band-pass poles, keep the upper one
+                const std::complex<double> half = prototype * bandwidth / 2.0;
+                const std::complex<double> root = std::sqrt(half * half - w_centre * w_centre);
+                std::complex<double> pole = half + root;
+                if (pole.imag() < 0.0)
+                {
+                    pole = half - root;
+                }
+
+                // a real prototype pole on a band wider than twice its centre splits into two distinct real poles
+                // instead of a conjugate pair, both go into the section
+                const std::complex<double> partner = real_prototype ? 2.0 * half - pole : std::conj(pole);
+
+                const std::complex<double> z = (2.0 * sampling_rate + pole) / (2.0 * sampling_rate - pole);
+                const std::complex<double> z_partner =
+                    (2.0 * sampling_rate + partner) / (2.0 * sampling_rate - partner);
+
+                Biquad section{1.0, 0.0, -1.0, -(z + z_partner).real(), (z * z_partner).real()};
+
+                const std::complex<double> zi = 1.0 / z_centre;
+                const double gain = std::abs((1.0 + section.a1 * zi + section.a2 * zi * zi) / (1.0 - zi * zi));
+
+                section.b0 = gain;
+                section.b2 = -gain;
+                sections.push_back(section);
+            }
+        }
+
+        std::shared_ptr<const std::vector<Biquad> > compute_band_pass(
+            const double sampling_rate,
+            const double low_freq,
+            const double high_freq,
+            const size_t order)
+        {
+            auto sections = std::make_shared<std::vector<Biquad> >();
+            const double nyquist = sampling_rate / 2.0;
+
+            // nothing of the band is below nyquist, a zero section keeps the output silent
+            if (low_freq >= nyquist)
+            {
+                sections->push_back({0.0, 0.0, 0.0, 0.0, 0.0});
+                return sections;
+            }
+
+            // a band touching DC or nyquist is a plain low-pass or high-pass
+            if (low_freq > 0.0 && high_freq < nyquist)
+            {
+                append_band_pass(*sections, sampling_rate, low_freq, high_freq, order);
+            }
+            else if (low_freq > 0.0)
+            {
+                append_butterworth(*sections, sampling_rate, low_freq, order, true);
+            }
+            else if (high_freq < nyquist)
+            {
+                append_butterworth(*sections, sampling_rate, high_freq, order, false);
+            }
+
+            return sections;
+        }
+
+        // one transposed direct form II step of a section for LANES channels, the lane loop vectorizes
+        inline void step_section(
+            const Biquad& s,
+            std::array<double, IirFilterBank::LANES>& x,
+            std::array<double, IirFilterBank::LANES>& z1,
+            std::array<double, IirFilterBank::LANES>& z2)
+        {
+            for (size_t lane = 0; lane < IirFilterBank::LANES; ++lane)
+            {
+                const double y = s.b0 * x[lane] + z1[lane];
+                z1[lane] = s.b1 * x[lane] - s.a1 * y + z2[lane];
+                z2[lane] = s.b2 * x[lane] - s.a2 * y;
+                x[lane] = y;
+            }
+        }
+    }
+
+    std::shared_ptr<const std::vector<Biquad> > design_band_pass(
+        const double sampling_rate,
+        const double low_freq,
+        const double high_freq,
+        const size_t order)
+    {
+        if (!(sampling_rate > 0.0) || order == 0 || !(high_freq > low_freq))
+        {
+            throw std::invalid_argument(fmt::format("Invalid band-pass design: {}-{} Hz at {} Hz, order {}",
+                                                    low_freq, high_freq, sampling_rate, order));
+        }
+
+        static std::mutex cache_mutex;
+        static std::map<std::tuple<double, double, double, size_t>, std::shared_ptr<const std::vector<Biquad> > > cache;
+
+        const auto key = std::make_tuple(sampling_rate, low_freq, high_freq, order);
+
+        std::lock_guard lock(cache_mutex);
+
+        if (const auto it = cache.find(key); it != cache.end())
+        {
+            return it->second;
+        }
+
+        auto sections = compute_band_pass(sampling_rate, low_freq, high_freq, order);
+        g_logger.debug("Designed {}-{} Hz band-pass at {} Hz: {} sections", low_freq, high_freq, sampling_rate,
+                       sections->size());
+
+        cache.emplace(key, sections);
+        return sections;
+    }
+
+    IirFilterBank::IirFilterBank(const double sampling_rate, const BandSet& bands, const size_t order)
+    {
+        for (const auto& band : bands)
+        {
+            m_state_offset.push_back(m_state_rows);
+            m_sections.push_back(design_band_pass(sampling_rate, band.min_freq, band.max_freq, order));
+            m_state_rows += 2 * m_sections.back()->size();
+        }
+    }
+
+    size_t IirFilterBank::add_channel()
+    {
+        resize_channels(m_channels + 1);
+        return m_channels - 1;
+    }
+
+    void IirFilterBank::resize_channels(const size_t channels)
+    {
+        std::vector<double> state(m_state_rows * channels, 0.0);
+
+        for (size_t row = 0; row < m_state_rows; ++row)
+        {
+            std::copy_n(m_state.begin() + static_cast<std::ptrdiff_t>(row * m_channels), m_channels,
+                        state.begin() + static_cast<std::ptrdiff_t>(row * channels));
+        }
+
+        m_state = std::move(state);
+        m_output.assign(m_sections.size() * channels, 0.0);
+        m_channels = channels;
+    }
+
+    void IirFilterBank::reset()
+    {
+        std::fill(m_state.begin(), m_state.end(), 0.0);
+        std::fill(m_output.begin(), m_output.end(), 0.0);
+    }
+
+    void IirFilterBank::push(const std::span<const double> samples)
+    {
+        if (samples.size() != m_channels)
+        {
+            throw std::invalid_argument("Filter bank push needs exactly one sample per channel");
+        }
+
+        const size_t channels = m_channels;
+
+        for (size_t band = 0; band < m_sections.size(); ++band)
+        {
+            double* x = m_output.data() + band * channels;
+            std::copy(samples.begin(), samples.end(), x);
+
+            double* state = m_state.data() + m_state_offset[band] * channels;
+
+            for (const auto& s : *m_sections[band])
+            {
+                double* z1 = state;
+                double* z2 = state + channels;
+
+                // contiguous across channels, no dependencies between iterations
+                for (size_t c = 0; c < channels; ++c)
+                {
+                    const double y = s.b0 * x[c] + z1[c];
+                    z1[c] = s.b1 * x[c] - s.a1 * y + z2[c];
+                    z2[c] = s.b2 * x[c] - s.a2 * y;
+                    x[c] = y;
+                }
+
+                state += 2 * channels;
+            }
+        }
+    }
+
+    void IirFilterBank::push_channel(const size_t slot, const double sample)
+    {
+        const size_t channels = m_channels;
+
+        for (size_t band = 0; band < m_sections.size(); ++band)
+        {
+            double x = sample;
+            size_t row = m_state_offset[band];
+
+            for (const auto& s : *m_sections[band])
+            {
+                double& z1 = m_state[row * channels + slot];
+                double& z2 = m_state[(row + 1) * channels + slot];
+
+                const double y = s.b0 * x + z1;
+                z1 = s.b1 * x - s.a1 * y + z2;
+                z2 = s.b2 * x - s.a2 * y;
+                x = y;
+
+                row += 2;
+            }
+
+            m_output[band * channels + slot] = x;
+        }
+    }
+
+    void IirFilterBank::filter_block(
+        const size_t band,
+        const std::span<double* const> signals,
+        const size_t sample_count,
+        const bool zero_phase) const
+    {
+        const auto& sections = *m_sections[band];
+        std::vector<double> state(2 * sections.size() * LANES, 0.0);
+
+        run_cascade(sections, signals, sample_count, state, false);
+
+        // the backward pass cancels the phase of the forward one and squares the magnitude response
+        if (zero_phase)
+        {
+            std::fill(state.begin(), state.end(), 0.0);
+            run_cascade(sections, signals, sample_count, state, true);
+        }
+    }
+
+    std::shared_ptr<const std::vector<Biquad> > design_notch(
+        const double sampling_rate,
+        const double frequency,
+        const size_t harmonics,
+        const double quality)
+    {
+        if (!(sampling_rate > 0.0) || !(frequency > 0.0) || !(quality > 0.0))
+        {
+            throw std::invalid_argument(fmt::format("Invalid notch design: {} Hz at {} Hz, Q {}",
+                                                    frequency, sampling_rate, quality));
+        }
+
+        auto sections = std::make_shared<std::vector<Biquad> >();
+
+        for (size_t harmonic = 1; harmonic <= harmonics; ++harmonic)
+        {
+            const double centre = frequency * static_cast<double>(harmonic);
+            if (centre >= sampling_rate / 2.0)
+                break;
+
+            const double w0 = 2.0 * std::numbers::pi * centre / sampling_rate;
+            const double alpha = std::sin(w0) / (2.0 * quality);
+            const double a0 = 1.0 + alpha;
+            const double cos_w0 = std::cos(w0);
+
+            sections->push_back({1.0 / a0, -2.0 * cos_w0 / a0, 1.0 / a0, -2.0 * cos_w0 / a0, (1.0 - alpha) / a0});
+        }
+
+        return sections;
+    }
+
+    void run_cascade(
+        const std::span<const Biquad> sections,
+        const std::span<double* const> signals,
+        const size_t sample_count,
+        const std::span<double> state,
+        const bool backward)
+    {
+        constexpr size_t lanes = IirFilterBank::LANES;
+
+        if (signals.size() > lanes || state.size() < 2 * sections.size() * lanes)
+        {
+            throw std::invalid_argument(fmt::format("Cascade takes at most {} signals and 2 state rows per section, "
+                                                    "got {} signals and {} state values",
+                                                    lanes, signals.size(), state.size()));
+        }
+
+        const size_t active = signals.size();
+
+        std::vector<std::array<double, lanes> > z1(sections.size());
+        std::vector<std::array<double, lanes> > z2(sections.size());
+
+        for (size_t i = 0; i < sections.size(); ++i)
+        {
+            std::copy_n(state.begin() + static_cast<std::ptrdiff_t>(2 * i * lanes), lanes, z1[i].begin());
+            std::copy_n(state.begin() + static_cast<std::ptrdiff_t>((2 * i + 1) * lanes), lanes, z2[i].begin());
+        }
+
+        std::array<double, lanes> x{};
+
+        for (size_t n = 0; n < sample_count; ++n)
+        {
+            const size_t t = backward ? sample_count - 1 - n : n;
+
+            for (size_t lane = 0; lane < active; ++lane)
+            {
+                x[lane] = signals[lane][t];
+            }
+
+            for (size_t i = 0; i < sections.size(); ++i)
+            {
+                step_section(sections[i], x, z1[i], z2[i]);
+            }
+
+            for (size_t lane = 0; lane < active; ++lane)
+            {
+                signals[lane][t] = x[lane];
+            }
+        }
+
+        for (size_t i = 0; i < sections.size(); ++i)
+        {
+            std::copy_n(z1[i].begin(), lanes, state.begin() + static_cast<std::ptrdiff_t>(2 * i * lanes));
+            std::copy_n(z2[i].begin(), lanes, state.begin() + static_cast<std::ptrdiff_t>((2 * i + 1) * lanes));
+        }
+    }
+} // namespace brainviz::analysis
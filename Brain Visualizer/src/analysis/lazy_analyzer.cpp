@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <exception>
+#include <span>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <logging/logger.hpp>
+
+#include <utils/parallel.hpp>
+#include <analysis/lazy_analyzer.hpp>
+
+namespace brainviz::analysis
+{
+    LazyAnalyzer::LazyAnalyzer(
+        const data::EEGData& eeg_data,
+        const size_t window_size,
+        const double overlap_percentage,
+        const LazyOptions options)
+        : FrequencyAnalyzer(eeg_data.m_samplingRate, window_size, overlap_percentage),
+          m_eeg_data(eeg_data),
+          m_options(options)
+    {
+        m_options.block_frames = std::max<size_t>(m_options.block_frames, 1);
+        if (m_options.max_cached_blocks > 0)
+        {
+            // the playhead's block and its prefetched and trailing blocks must fit, otherwise they are dropped as
+            // they arrive
+            m_options.max_cached_blocks = std::max(m_options.max_cached_blocks,
+                                                   m_options.prefetch_blocks + m_options.trailing_blocks + 1);
+        }
+
+        size_t max_frames = 0;
+        for (const auto& channel_name : m_eeg_data.get_channel_names())
+        {
+            add_channel_results(channel_name);
+
+            m_raw_data.push_back(&m_eeg_data.get_channel(channel_name));
+            m_frame_counts.push_back(frame_count(m_raw_data.back()->size()));
+            max_frames = std::max(max_frames, m_frame_counts.back());
+        }
+
+        // every frame is addressable from the start, only zero until its block is analyzed
+        m_block_states.resize((max_frames + m_options.block_frames - 1) / m_options.block_frames);
+        m_zero_frame.assign(get_band_count(), 0.0);
+
+        reset_blocks();
+
+        m_worker = std::jthread([this](const std::stop_token& stop) {
+            run_worker(stop);
+        });
+    }
+
+    void LazyAnalyzer::prepare_frame(const size_t frame_index)
+    {
+        if (m_block_states.empty())
+        {
+            return;
+        }
+
+        const size_t block = std::min(frame_index / m_options.block_frames, m_block_states.size() - 1);
+
+        std::vector<Block> finished;
+        {
+            std::scoped_lock lock(m_mutex);
+            finished.swap(m_finished);
+        }
+
+        for (auto& result : finished)
+        {
+            // blocks of older settings, or analyzed on the spot while they were on the background thread
+            if (result.generation != m_generation || m_block_states[result.index].state != BlockState::Queued)
+            {
+                continue;
+            }
+
+            if (result.amplitudes.empty())
+            {
+                // failed on the background thread, left to the playhead so the error surfaces there
+                m_block_states[result.index].state = BlockState::Empty;
+                continue;
+            }
+
+            publish_block(std::move(result));
+        }
+
+        // short steps back are reverse playback, long jumps back are scrubbing or playback wrapping around
+        if (block < m_last_block && m_last_block - block <= m_options.prefetch_blocks)
+        {
+            m_backward = true;
+        }
+        else if (block > m_last_block)
+        {
+            m_backward = false;
+        }
+        m_last_block = block;
+
+        if (m_block_states[block].state != BlockState::Ready)
+        {
+            const Settings& settings = *m_settings;
+
+            Block result = make_block(settings, block, m_generation);
+            utils::parallel_for(m_raw_data.size(), [&](const size_t begin, const size_t end) {
+                const auto estimator = make_spectral_estimator(settings.window_size, settings.spectral_options);
+                analyze_block(settings, *estimator, result, begin, end);
+            });
+
+            publish_block(std::move(result));
+        }
+
+        {
+            std::scoped_lock lock(m_mutex);
+
+            // requeue from the new playhead, blocks nobody needs anymore are dropped before they are analyzed
+            for (const size_t queued : m_queue)
+            {
+                m_block_states[queued].state = BlockState::Empty;
+            }
+            m_queue.clear();
+
+            for (size_t i = 1; i <= m_options.prefetch_blocks; ++i)
+            {
+                if (m_backward && i > block)
+                {
+                    break;
+                }
+
+                // forward playback loops, so the prefetch wraps to the start
+                const size_t next = m_backward ? block - i : (block + i) % m_block_states.size();
+                if (next == block)
+                {
+                    break;
+                }
+
+                queue_block(next);
+            }
+
+            // already prefetched when playing backward
+            for (size_t i = 1; i <= m_options.trailing_blocks && i <= block; ++i)
+            {
+                queue_block(block - i);
+            }
+        }
+        m_wake.notify_one();
+
+        if (m_options.max_cached_blocks == 0)
+        {
+            return;
+        }
+
+        while (m_resident.size() > m_options.max_cached_blocks)
+        {
+            // furthest from the playhead, measured around the loop
+            const auto distance = [&](const Block& other) {
+                const size_t d = (other.index > block) ? other.index - block : block - other.index;
+                return std::min(d, m_block_states.size() - d);
+            };
+
+            const auto furthest = std::ranges::max_element(m_resident, {}, distance);
+            evict_block(static_cast<size_t>(furthest - m_resident.begin()));
+        }
+    }
+
+    bool LazyAnalyzer::is_frame_ready(const size_t frame_index) const
+    {
+        const size_t block = frame_index / m_options.block_frames;
+        return block < m_block_states.size() && m_block_states[block].state == BlockState::Ready &&
+               frame_index <= get_max_frame_index();
+    }
+
+    size_t LazyAnalyzer::get_frame_count(const ChannelHandle channel) const
+    {
+        return channel < m_frame_counts.size() ? m_frame_counts[channel] : 0;
+    }
+
+    std::span<const double> LazyAnalyzer::get_frame(const ChannelHandle channel, const size_t frame_index) const
+    {
+        if (frame_index >= get_frame_count(channel))
+        {
+            throw std::out_of_range(fmt::format("Frame {} of channel handle {} out of range", frame_index, channel));
+        }
+
+        const Block* block = find_block(frame_index);
+        if (!block)
+        {
+            return m_zero_frame;
+        }
+
+        const size_t bands = get_band_count();
+        const size_t offset = channel * m_options.block_frames + frame_index % m_options.block_frames;
+
+        return std::span(block->amplitudes).subspan(offset * bands, bands);
+    }
+
+    std::uint8_t LazyAnalyzer::get_artifact_flags(const ChannelHandle channel, const size_t frame_index) const
+    {
+        const Block* block = frame_index < get_frame_count(channel) ? find_block(frame_index) : nullptr;
+        if (!block)
+        {
+            return 0;
+        }
+
+        return block->flags[channel * m_options.block_frames + frame_index % m_options.block_frames];
+    }
+
+    const VisualizationTable* LazyAnalyzer::find_visualization_table(const size_t frame_index) const
+    {
+        const Block* block = find_block(frame_index);
+        return block ? &block->table : nullptr;
+    }
+
+    const LazyAnalyzer::Block* LazyAnalyzer::find_block(const size_t frame_index) const
+    {
+        const size_t block = frame_index / m_options.block_frames;
+        if (block >= m_block_states.size() || m_block_states[block].state != BlockState::Ready)
+        {
+            return nullptr;
+        }
+
+        return &m_resident[m_block_states[block].slot];
+    }
+
+    void LazyAnalyzer::set_spectral_options(const SpectralOptions& options)
+    {
+        FrequencyAnalyzer::set_spectral_options(options);
+        reset_blocks();
+    }
+
+    void LazyAnalyzer::set_band_set(BandSet bands)
+    {
+        FrequencyAnalyzer::set_band_set(std::move(bands));
+
+        m_zero_frame.assign(get_band_count(), 0.0);
+        reset_blocks();
+    }
+
+    void LazyAnalyzer::enable_artifact_detection(const ArtifactOptions options)
+    {
+        FrequencyAnalyzer::enable_artifact_detection(options);
+        reset_blocks();
+    }
+
+    void LazyAnalyzer::disable_artifact_detection()
+    {
+        FrequencyAnalyzer::disable_artifact_detection();
+        reset_blocks();
+    }
+
+    void LazyAnalyzer::queue_block(const size_t index)
+    {
+        if (m_block_states[index].state == BlockState::Empty)
+        {
+            m_block_states[index].state = BlockState::Queued;
+            m_queue.push_back(index);
+        }
+    }
+
+    void LazyAnalyzer::reset_blocks()
+    {
+        auto settings = std::make_shared<const Settings>(Settings{
+            .window_size = m_window_size,
+            .hop_size = m_hop_size,
+            .band_count = m_bands.size(),
+            .spectral_options = m_spectral_options,
+            .band_table = m_band_table,
+            .artifact_detection = m_artifact_detection,
+            .artifact_detector = m_artifact_detector
+        });
+
+        {
+            std::scoped_lock lock(m_mutex);
+
+            // whatever the background thread is still working on comes back with the old generation
+            m_settings = std::move(settings);
+            ++m_generation;
+
+            for (const size_t queued : m_queue)
+            {
+                m_block_states[queued] = {};
+            }
+            for (const auto& block : m_finished)
+            {
+                m_block_states[block.index] = {};
+            }
+            if (m_in_flight)
+            {
+                m_block_states[*m_in_flight] = {};
+            }
+
+            m_queue.clear();
+            m_finished.clear();
+        }
+
+        for (const auto& block : m_resident)
+        {
+            m_block_states[block.index] = {};
+        }
+        m_resident.clear();
+    }
+
+    LazyAnalyzer::Block LazyAnalyzer::make_block(
+        const Settings& settings,
+        const size_t index,
+        const size_t generation) const
+    {
+        Block block;
+        block.index = index;
+        block.generation = generation;
+        block.amplitudes.assign(m_raw_data.size() * m_options.block_frames * settings.band_count, 0.0);
+        block.flags.assign(m_raw_data.size() * m_options.block_frames, 0);
+
+        return block;
+    }
+
+    void LazyAnalyzer::analyze_block(
+        const Settings& settings,
+        SpectralEstimator& estimator,
+        Block& block,
+        const size_t first_channel,
+        const size_t last_channel) const
+    {
+        const size_t block_frames = m_options.block_frames;
+        const size_t bands = settings.band_count;
+        const size_t first_frame = block.index * block_frames;
+
+        for (size_t channel = first_channel; channel < last_channel; ++channel)
+        {
+            if (first_frame >= m_frame_counts[channel])
+            {
+                continue;
+            }
+
+            const std::span<const double> raw_data = *m_raw_data[channel];
+            const size_t frames = std::min(block_frames, m_frame_counts[channel] - first_frame);
+
+            const auto amplitudes = std::span(block.amplitudes).subspan(channel * block_frames * bands, frames * bands);
+
+            for (size_t i = 0; i < frames; ++i)
+            {
+                const size_t start_idx = (first_frame + i) * settings.hop_size;
+                const size_t count = std::min(settings.window_size, raw_data.size() - start_idx);
+
+                const auto& power_spectrum = estimator.compute(raw_data.subspan(start_idx, count));
+                settings.band_table.reduce(power_spectrum, amplitudes.subspan(i * bands, bands));
+            }
+
+            if (!settings.artifact_detection)
+            {
+                continue;
+            }
+
+            // only the samples the block's frames cover, the detector sums whatever it is given
+            const size_t first_sample = std::min(first_frame * settings.hop_size, raw_data.size());
+            const size_t sample_count = std::min((frames - 1) * settings.hop_size + settings.window_size,
+                                                 raw_data.size() - first_sample);
+
+            const auto flags = std::span(block.flags).subspan(channel * block_frames, frames);
+            settings.artifact_detector.classify_samples(
+                raw_data.subspan(first_sample, sample_count), settings.window_size, settings.hop_size, flags);
+
+            for (size_t i = 0; i < frames; ++i)
+            {
+                flags[i] |= settings.artifact_detector.classify_bands(amplitudes.subspan(i * bands, bands));
+            }
+        }
+    }
+
+    void LazyAnalyzer::publish_block(Block block)
+    {
+        const size_t index = block.index;
+
+        m_block_states[index] = {BlockState::Ready, m_resident.size()};
+        m_resident.push_back(std::move(block));
+
+        // reads the block back through get_frame(), so only once it is resident
+        m_resident.back().table = VisualizationTable(*this, index * m_options.block_frames, m_options.block_frames);
+    }
+
+    void LazyAnalyzer::evict_block(const size_t slot)
+    {
+        m_block_states[m_resident[slot].index] = {};
+
+        if (slot + 1 != m_resident.size())
+        {
+            m_resident[slot] = std::move(m_resident.back());
+            m_block_states[m_resident[slot].index].slot = slot;
+        }
+        m_resident.pop_back();
+    }
+
+    void LazyAnalyzer::run_worker(const std::stop_token& stop)
+    {
+        std::shared_ptr<const Settings> settings;
+        std::unique_ptr<SpectralEstimator> estimator;
+
+        while (true)
+        {
+            size_t index;
+            size_t generation;
+            std::shared_ptr<const Settings> current;
+            {
+                std::unique_lock lock(m_mutex);
+                if (!m_wake.wait(lock, stop, [this] { return !m_queue.empty(); }))
+                {
+                    return;
+                }
+
+                index = m_queue.front();
+                m_queue.pop_front();
+                m_in_flight = index;
+                current = m_settings;
+                generation = m_generation;
+            }
+
+            Block block = make_block(*current, index, generation);
+            try
+            {
+                if (current != settings)
+                {
+                    estimator = make_spectral_estimator(current->window_size, current->spectral_options);
+                    settings = current;
+                }
+
+                analyze_block(*settings, *estimator, block, 0, m_raw_data.size());
+            }
+            catch (const std::exception& e)
+            {
+                g_logger.warn("Prefetch of frame block {} failed: {}", index, e.what());
+                block.amplitudes.clear();
+            }
+
+            std::scoped_lock lock(m_mutex);
+            m_finished.push_back(std::move(block));
+            m_in_flight.reset();
+        }
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <utils/power_of_2.hpp>
+#include <analysis/morlet_cwt.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // wavelet spectra are cut where the gaussian drops below exp(-8), ~3e-4 in amplitude
+        constexpr double SPECTRUM_WIDTH = 4.0;
+    }
+
+    MorletCwt::MorletCwt(const double sampling_rate, CwtOptions options)
+        : m_sampling_rate(sampling_rate),
+          m_options(options)
+    {
+        m_options.max_freq = std::min(m_options.max_freq, 0.45 * sampling_rate);
+
+        if (!(m_options.min_freq > 0.0) || !(m_options.max_freq >= m_options.min_freq) ||
+            m_options.voices_per_octave == 0 || !(m_options.cycles > 0.0))
+        {
+            throw std::invalid_argument(fmt::format("Invalid CWT options: {}-{} Hz, {} voices, {} cycles",
+                                                    m_options.min_freq, m_options.max_freq,
+                                                    m_options.voices_per_octave, m_options.cycles));
+        }
+
+        const auto voices = static_cast<double>(m_options.voices_per_octave);
+        const auto scale_count = static_cast<size_t>(
+            std::floor(std::log2(m_options.max_freq / m_options.min_freq) * voices + 1e-9)) + 1;
+
+        m_frequencies.resize(scale_count);
+        for (size_t scale = 0; scale < scale_count; ++scale)
+        {
+            m_frequencies[scale] = m_options.min_freq * std::exp2(static_cast<double>(scale) / voices);
+        }
+
+        // neighbouring scales overlap, at a scale's own frequency the squared responses of all scales add up to
+        // g; a band's summed |W|^2 divided by 2g is then the variance of the signal inside it
+        m_variance_weights.resize(scale_count);
+        for (size_t scale = 0; scale < scale_count; ++scale)
+        {
+            double overlap = 0.0;
+            for (size_t other = 0; other < scale_count; ++other)
+            {
+                const double distance = (m_frequencies[scale] - m_frequencies[other]) / bandwidth(other);
+                overlap += std::exp(-distance * distance);
+            }
+
+            m_variance_weights[scale] = 1.0 / (2.0 * overlap);
+        }
+    }
+
+    size_t MorletCwt::get_fft_size(const size_t sample_count) const
+    {
+        // time domain half width of the widest (lowest) wavelet
+        const double sigma_t = 1.0 / (2.0 * std::numbers::pi * bandwidth(0));
+        const auto padding = static_cast<size_t>(std::ceil(SPECTRUM_WIDTH * sigma_t * m_sampling_rate));
+
+        return utils::next_power_of_2(sample_count + padding);
+    }
+
+    std::shared_ptr<const kfr::dft_plan<double> > MorletCwt::get_dft_locked(const size_t size) const
+    {
+        auto& dft = m_dfts[size];
+        if (!dft)
+        {
+            dft = std::make_shared<const kfr::dft_plan<double> >(size);
+        }
+        return dft;
+    }
+
+    std::shared_ptr<const kfr::dft_plan<double> > MorletCwt::get_dft(const size_t size) const
+    {
+        std::scoped_lock lock(m_cache_mutex);
+        return get_dft_locked(size);
+    }
+
+    std::shared_ptr<const MorletCwt::Plan> MorletCwt::get_plan(const size_t fft_size, const size_t hop_size) const
+    {
+        std::scoped_lock lock(m_cache_mutex);
+
+        auto& cached = m_plans[{fft_size, hop_size}];
+        if (cached)
+        {
+            return cached;
+        }
+
+        auto plan = std::make_shared<Plan>();
+        plan->scales.resize(m_frequencies.size());
+
+        const double bin_width = m_sampling_rate / static_cast<double>(fft_size);
+
+        // at least two output samples per hop so every frame window averages a few points
+        const size_t min_output = std::min(fft_size, utils::next_power_of_2(2 * fft_size / std::max<size_t>(hop_size, 1)));
+
+        for (size_t scale = 0; scale < m_frequencies.size(); ++scale)
+        {
+            const double centre = m_frequencies[scale];
+            const double sigma = bandwidth(scale);
+
+            const auto first_bin = static_cast<size_t>(
+                std::max(1.0, std::floor((centre - SPECTRUM_WIDTH * sigma) / bin_width)));
+            const auto last_bin = static_cast<size_t>(
+                std::min(static_cast<double>(fft_size / 2), std::ceil((centre + SPECTRUM_WIDTH * sigma) / bin_width)));
+
+            auto& [first, spectrum, inverse] = plan->scales[scale];
+            first = first_bin;
+            spectrum.resize(last_bin - first_bin + 1);
+
+            for (size_t k = first_bin; k <= last_bin; ++k)
+            {
+                const double distance = (static_cast<double>(k) * bin_width - centre) / sigma;
+
+                // analytic (x2) and the 1 / N of the inverse transform folded in
+                spectrum[k - first_bin] = 2.0 * std::exp(-0.5 * distance * distance) / static_cast<double>(fft_size);
+            }
+
+            // |W|^2 has twice the bandwidth of W, keep the decimated series above nyquist for it
+            const size_t output_size = std::clamp(utils::next_power_of_2(2 * spectrum.size()), min_output, fft_size);
+            inverse = get_dft_locked(output_size);
+        }
+
+        cached = std::move(plan);
+        return cached;
+    }
+
+    void MorletCwt::transform_signal(
+        const std::span<const double> samples,
+        kfr::univector<kfr::complex<double> >& spectrum,
+        Workspace& workspace) const
+    {
+        const size_t fft_size = get_fft_size(samples.size());
+        const auto dft = get_dft(fft_size);
+
+        workspace.input.resize(fft_size);
+        workspace.temp.resize(std::max<size_t>(workspace.temp.size(), dft->temp_size));
+        spectrum.resize(fft_size);
+
+        // remove the mean so the DC step at the padding doesnt leak into the low scales
+        double mean = 0.0;
+        for (const double sample : samples)
+        {
+            mean += sample;
+        }
+        mean /= static_cast<double>(std::max<size_t>(samples.size(), 1));
+
+        for (size_t i = 0; i < samples.size(); ++i)
+        {
+            workspace.input[i] = kfr::complex<double>(samples[i] - mean, 0.0);
+        }
+
+        std::fill(workspace.input.begin() + static_cast<std::ptrdiff_t>(samples.size()), workspace.input.end(),
+                  kfr::complex<double>(0.0, 0.0));
+
+        dft->execute(spectrum, workspace.input, workspace.temp, false);
+    }
+
+    void MorletCwt::frame_power(
+        const kfr::univector<kfr::complex<double> >& spectrum,
+        const size_t scale,
+        const size_t sample_count,
+        const size_t window_size,
+        const size_t hop_size,
+        const std::span<double> power,
+        Workspace& workspace) const
+    {
+        const size_t fft_size = spectrum.size();
+        const auto plan = get_plan(fft_size, hop_size);
+        const auto& [first_bin, wavelet, inverse] = plan->scales[scale];
+
+        const size_t output_size = inverse->size;
+        const size_t step = fft_size / output_size; // input samples per output sample
+
+        workspace.input.resize(output_size);
+        workspace.output.resize(output_size);
+        workspace.temp.resize(std::max<size_t>(workspace.temp.size(), inverse->temp_size));
+
+        // shift the wavelet's bins down to 0, this only rotates the phase of the result
+        std::fill(workspace.input.begin(), workspace.input.end(), kfr::complex<double>(0.0, 0.0));
+        for (size_t k = 0; k < wavelet.size(); ++k)
+        {
+            workspace.input[k] = spectrum[first_bin + k] * wavelet[k];
+        }
+
+        inverse->execute(workspace.output, workspace.input, workspace.temp, true);
+
+        // prefix sums of |W|^2 over the output samples that cover the signal
+        const size_t valid = std::min(output_size, (sample_count + step - 1) / step);
+        auto& prefix = workspace.prefix;
+        prefix.resize(valid + 1);
+        prefix[0] = 0.0;
+
+        for (size_t j = 0; j < valid; ++j)
+        {
+            prefix[j + 1] = prefix[j] + std::norm(workspace.output[j]);
+        }
+
+        for (size_t frame = 0; frame < power.size(); ++frame)
+        {
+            const size_t start = frame * hop_size;
+            const size_t first = std::min(valid, (start + step - 1) / step);
+            const size_t last = std::min(valid, (start + window_size + step - 1) / step);
+
+            power[frame] = last > first ? (prefix[last] - prefix[first]) / static_cast<double>(last - first) : 0.0;
+        }
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <logging/logger.hpp>
+#include <utils/parallel.hpp>
+#include <utils/power_of_2.hpp>
+#include <analysis/multi_resolution_analyzer.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // half-band low-pass of 2 * HALF_BAND_REACH + 1 taps, only the centre and odd offsets are non zero.
+        // blackman windowed: flat to 0.175 fs and -76 dB from 0.325 fs, so whatever lands below the decimated
+        // nyquist margin after folding is attenuated
+        constexpr size_t HALF_BAND_REACH = 19;
+
+        // taps at offsets 1, 3, ..., HALF_BAND_REACH, the centre tap is 0.5
+        std::array<double, (HALF_BAND_REACH + 1) / 2> make_half_band()
+        {
+            std::array<double, (HALF_BAND_REACH + 1) / 2> taps{};
+
+            constexpr double span = HALF_BAND_REACH + 1;
+            double sum = 0.0;
+
+            for (size_t i = 0; i < taps.size(); ++i)
+            {
+                const auto k = static_cast<double>(2 * i + 1);
+                const double window = 0.42 + 0.5 * std::cos(std::numbers::pi * k / span) +
+                                      0.08 * std::cos(2.0 * std::numbers::pi * k / span);
+
+                taps[i] = std::sin(std::numbers::pi * k / 2.0) / (std::numbers::pi * k) * window;
+                sum += 2.0 * taps[i];
+            }
+
+            // unit gain at DC, the odd taps together carry the other half
+            for (double& tap : taps)
+            {
+                tap *= 0.5 / sum;
+            }
+
+            return taps;
+        }
+
+        const auto HALF_BAND = make_half_band();
+
+        // native frames that cover common frames [0, frames) of a resolution, the last one at or past the end
+        size_t native_frame_count(const size_t frames, const size_t decimation)
+        {
+            return frames > 0 ? (frames - 1 + decimation - 1) / decimation + 1 : 0;
+        }
+
+        double hann_energy(const size_t size)
+        {
+            const kfr::univector<double> hann = periodic_hann(size);
+
+            double energy = 0.0;
+            for (const double w : hann)
+            {
+                energy += w * w;
+            }
+
+            return energy;
+        }
+    }
+
+    MultiResolutionAnalyzer::MultiResolutionAnalyzer(
+        const data::EEGData& eeg_data,
+        const size_t window_size,
+        const double overlap_percentage,
+        const MultiResolutionOptions options)
+        : FrequencyAnalyzer(eeg_data.m_samplingRate, window_size, overlap_percentage),
+          m_eeg_data(eeg_data),
+          m_options(options)
+    {
+        m_fft_size = m_options.fft_size > 0 ? utils::round_to_power_of_2(m_options.fft_size) : std::max<size_t>(m_window_size / 2, 8);
+        m_options.max_decimation = utils::round_to_power_of_2(std::max<size_t>(m_options.max_decimation, 1));
+
+        build_resolutions();
+    }
+
+    void MultiResolutionAnalyzer::set_band_set(BandSet bands)
+    {
+        FrequencyAnalyzer::set_band_set(std::move(bands));
+        build_resolutions();
+    }
+
+    void MultiResolutionAnalyzer::build_resolutions()
+    {
+        m_resolutions.clear();
+        m_band_resolution.assign(m_bands.size(), 0);
+        m_band_slot.assign(m_bands.size(), 0);
+
+        const double window_energy = static_cast<double>(m_window_size) * hann_energy(m_window_size);
+        const double fft_energy = static_cast<double>(m_fft_size) * hann_energy(m_fft_size);
+
+        std::vector<size_t> decimations(m_bands.size());
+        for (size_t band = 0; band < m_bands.size(); ++band)
+        {
+            const auto& definition = m_bands[band];
+
+            // seconds the window must span, a band starting at 0 Hz asks for as much as the nyquist limit allows
+            const double needed = m_options.min_cycles / std::max(definition.min_freq, 1e-3);
+
+            size_t decimation = 1;
+            while (decimation * 2 <= m_options.max_decimation &&
+                   static_cast<double>(m_fft_size * decimation) / m_sampling_rate < needed &&
+                   definition.max_freq <= m_options.nyquist_margin * m_sampling_rate / (4.0 * decimation))
+            {
+                decimation *= 2;
+            }
+
+            decimations[band] = decimation;
+        }
+
+        for (size_t decimation = 1; decimation <= m_options.max_decimation; decimation *= 2)
+        {
+            std::vector<BandDefinition> definitions;
+            std::vector<size_t> bands;
+
+            for (size_t band = 0; band < m_bands.size(); ++band)
+            {
+                if (decimations[band] == decimation)
+                {
+                    m_band_resolution[band] = m_resolutions.size();
+                    m_band_slot[band] = bands.size();
+
+                    bands.push_back(band);
+                    definitions.push_back(m_bands[band]);
+                }
+            }
+
+            if (bands.empty())
+            {
+                continue;
+            }
+
+            const BandSet subset(std::move(definitions));
+
+            Resolution resolution{
+                .shape = {
+                    .decimation = decimation,
+                    .fft_size = m_fft_size,
+                    .window_size = m_fft_size * decimation,
+                    .hop_size = m_hop_size * decimation
+                },
+                .bands = std::move(bands),
+                .band_table = BandBinTable(subset, m_sampling_rate / static_cast<double>(decimation), m_fft_size),
+                // band power of a band limited signal is variance * N * hann energy / 2 at any rate
+                .amplitude_scale = std::sqrt(window_energy / fft_energy),
+                .native = BandTensor(subset.size())
+            };
+
+            g_logger.debug("Multi-resolution: decimation {} window {} samples ({:.2f} s) for {} band(s)",
+                           decimation, resolution.shape.window_size,
+                           static_cast<double>(resolution.shape.window_size) / m_sampling_rate,
+                           resolution.bands.size());
+
+            m_resolutions.push_back(std::move(resolution));
+        }
+    }
+
+    const BandResolution& MultiResolutionAnalyzer::get_band_resolution(const size_t band) const
+    {
+        if (band >= m_band_resolution.size())
+        {
+            throw std::out_of_range(fmt::format("Band index {} out of range, {} bands", band, m_bands.size()));
+        }
+
+        return m_resolutions[m_band_resolution[band]].shape;
+    }
+
+    size_t MultiResolutionAnalyzer::band_time_index_to_frame(const size_t band, const size_t time_index) const
+    {
+        const auto& resolution = m_resolutions[m_band_resolution.at(band)];
+
+        size_t frames = 0;
+        for (ChannelHandle channel = 0; channel < resolution.native.get_channel_count(); ++channel)
+        {
+            frames = std::max(frames, resolution.native.get_frame_count(channel));
+        }
+
+        if (time_index < m_window_size / 2 || frames == 0)
+        {
+            return 0;
+        }
+
+        const size_t hop = resolution.shape.hop_size;
+        const size_t frame = (time_index - m_window_size / 2 + hop / 2) / hop;
+        return std::min(frame, frames - 1);
+    }
+
+    size_t MultiResolutionAnalyzer::band_frame_to_time_index(const size_t band, const size_t frame) const
+    {
+        return m_window_size / 2 + frame * get_band_resolution(band).hop_size;
+    }
+
+    StridedSpan<const double> MultiResolutionAnalyzer::get_native_band_amplitude(
+        const size_t band,
+        const ChannelHandle channel) const
+    {
+        const auto& resolution = m_resolutions[m_band_resolution.at(band)];
+        if (channel >= resolution.native.get_channel_count())
+        {
+            throw std::out_of_range(fmt::format("Channel handle {} out of range", channel));
+        }
+
+        return resolution.native.band(channel, m_band_slot[band]);
+    }
+
+    void MultiResolutionAnalyzer::process_all_channels()
+    {
+        process_channels(m_eeg_data.get_channel_names());
+    }
+
+    void MultiResolutionAnalyzer::process_channel(const std::string_view channel_name)
+    {
+        process_channels({std::string(channel_name)});
+    }
+
+    void MultiResolutionAnalyzer::process_channels(const std::vector<std::string>& channel_names)
+    {
+        m_visualization_table = {};
+
+        std::vector<const std::vector<double>*> raw_data;
+        std::vector<ChannelHandle> channels;
+
+        size_t max_frames = 0;
+        for (const auto& channel_name : channel_names)
+        {
+            max_frames = std::max(max_frames, frame_count(m_eeg_data.get_channel(channel_name).size()));
+            channels.push_back(add_channel_results(channel_name));
+        }
+
+        // size everything up front so the workers only ever write into their own channel blocks
+        m_results.reserve_frames(max_frames);
+        for (auto& resolution : m_resolutions)
+        {
+            while (resolution.native.get_channel_count() < get_channel_count())
+            {
+                resolution.native.add_channel();
+            }
+
+            resolution.native.reserve_frames(native_frame_count(max_frames, resolution.shape.decimation));
+        }
+
+        for (size_t i = 0; i < channel_names.size(); ++i)
+        {
+            raw_data.push_back(&m_eeg_data.get_channel(channel_names[i]));
+
+            const size_t frames = frame_count(raw_data.back()->size());
+            m_results.resize_frames(channels[i], frames);
+
+            for (auto& resolution : m_resolutions)
+            {
+                resolution.native.resize_frames(channels[i], native_frame_count(frames, resolution.shape.decimation));
+            }
+        }
+
+        utils::parallel_for(channels.size(), [&](const size_t begin, const size_t end) {
+            std::vector<std::unique_ptr<SpectralEstimator> > estimators;
+            for (size_t i = 0; i < m_resolutions.size(); ++i)
+            {
+                estimators.push_back(make_spectral_estimator(m_fft_size, m_spectral_options));
+            }
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                analyze_channel(channels[i], *raw_data[i], estimators);
+                resample_channel(channels[i]);
+                detect_artifacts(channels[i], *raw_data[i], 0, m_results.get_frame_count(channels[i]));
+            }
+        });
+    }
+
+    void MultiResolutionAnalyzer::analyze_channel(
+        const ChannelHandle channel,
+        const std::vector<double>& raw_data,
+        const std::span<const std::unique_ptr<SpectralEstimator> > estimators)
+    {
+        // the cascade only ever goes down, each stage halves the previous one
+        std::vector<double> decimated;
+        std::vector<double> scratch;
+        std::span<const double> signal = raw_data;
+        size_t signal_decimation = 1;
+
+        for (size_t r = 0; r < m_resolutions.size(); ++r)
+        {
+            auto& resolution = m_resolutions[r];
+            const size_t decimation = resolution.shape.decimation;
+
+            while (signal_decimation < decimation)
+            {
+                decimate_by_two(signal, scratch);
+                std::swap(decimated, scratch);
+
+                signal = decimated;
+                signal_decimation *= 2;
+            }
+
+            const size_t fft_size = resolution.shape.fft_size;
+            const size_t last_start = signal.size() > fft_size ? signal.size() - fft_size : 0;
+            const double scale = resolution.amplitude_scale;
+
+            for (size_t frame = 0; frame < resolution.native.get_frame_count(channel); ++frame)
+            {
+                // centred on common frame frame * decimation, windows that would leave the signal are moved inside
+                const size_t centre = (m_window_size / 2 + frame * resolution.shape.hop_size) / decimation;
+                const size_t start = std::min(centre > fft_size / 2 ? centre - fft_size / 2 : 0, last_start);
+                const size_t count = std::min(fft_size, signal.size() - start);
+
+                const auto& power_spectrum = estimators[r]->compute(signal.subspan(start, count));
+
+                const auto amplitudes = resolution.native.frame(channel, frame);
+                resolution.band_table.reduce(power_spectrum, amplitudes);
+
+                for (double& amplitude : amplitudes)
+                {
+                    amplitude *= scale;
+                }
+            }
+        }
+    }
+
+    void MultiResolutionAnalyzer::resample_channel(const ChannelHandle channel)
+    {
+        const size_t frames = m_results.get_frame_count(channel);
+
+        for (const auto& resolution : m_resolutions)
+        {
+            const size_t decimation = resolution.shape.decimation;
+            const size_t native_frames = resolution.native.get_frame_count(channel);
+
+            for (size_t frame = 0; frame < frames; ++frame)
+            {
+                const size_t before = frame / decimation;
+                const size_t after = std::min(before + 1, native_frames - 1);
+                const double t = static_cast<double>(frame % decimation) / static_cast<double>(decimation);
+
+                const auto first = resolution.native.frame(channel, before);
+                const auto second = resolution.native.frame(channel, after);
+                const auto amplitudes = m_results.frame(channel, frame);
+
+                for (size_t slot = 0; slot < resolution.bands.size(); ++slot)
+                {
+                    amplitudes[resolution.bands[slot]] = first[slot] + t * (second[slot] - first[slot]);
+                }
+            }
+        }
+    }
+
+    void MultiResolutionAnalyzer::decimate_by_two(const std::span<const double> input, std::vector<double>& output)
+    {
+        const size_t size = input.size();
+        output.resize((size + 1) / 2);
+
+        if (size == 0)
+        {
+            return;
+        }
+
+        const auto sample = [&](const ptrdiff_t index) {
+            return input[std::clamp<ptrdiff_t>(index, 0, static_cast<ptrdiff_t>(size) - 1)];
+        };
+
+        const auto reach = static_cast<ptrdiff_t>(HALF_BAND_REACH);
+
+        for (size_t k = 0; k < output.size(); ++k)
+        {
+            const auto centre = static_cast<ptrdiff_t>(2 * k);
+
+            double sum = 0.5 * input[2 * k];
+
+            if (centre >= reach && centre + reach < static_cast<ptrdiff_t>(size))
+            {
+                // symmetric taps, one multiply per pair
+                for (size_t i = 0; i < HALF_BAND.size(); ++i)
+                {
+                    const size_t offset = 2 * i + 1;
+                    sum += HALF_BAND[i] * (input[2 * k - offset] + input[2 * k + offset]);
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < HALF_BAND.size(); ++i)
+                {
+                    const auto offset = static_cast<ptrdiff_t>(2 * i + 1);
+                    sum += HALF_BAND[i] * (sample(centre - offset) + sample(centre + offset));
+                }
+            }
+
+            output[k] = sum;
+        }
+    }
+} // namespace brainviz::analysis
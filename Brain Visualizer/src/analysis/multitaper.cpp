@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numbers>
+#include <stdexcept>
+#include <tuple>
+
+#include <logging/logger.hpp>
+#include <analysis/multitaper.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // symmetric tridiagonal matrix whose eigenvectors are the DPSS (Percival & Walden, 8.3)
+        struct Tridiagonal
+        {
+            std::vector<double> diagonal;
+            std::vector<double> off_diagonal; // off_diagonal[i] couples i - 1 and i, [0] unused
+        };
+
+        Tridiagonal dpss_matrix(const size_t n, const double half_bandwidth)
+        {
+            Tridiagonal matrix;
+            matrix.diagonal.resize(n);
+            matrix.off_diagonal.resize(n, 0.0);
+
+            const double cos_w = std::cos(2.0 * std::numbers::pi * half_bandwidth);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                const double centred = (static_cast<double>(n) - 1.0 - 2.0 * static_cast<double>(i)) / 2.0;
+                matrix.diagonal[i] = centred * centred * cos_w;
+
+                if (i > 0)
+                {
+                    matrix.off_diagonal[i] = static_cast<double>(i) * static_cast<double>(n - i) / 2.0;
+                }
+            }
+
+            return matrix;
+        }
+
+        // number of eigenvalues below x (sturm sequence)
+        size_t count_below(const Tridiagonal& matrix, const double x)
+        {
+            size_t count = 0;
+            double q = 1.0;
+
+            for (size_t i = 0; i < matrix.diagonal.size(); ++i)
+            {
+                const double coupling = (i > 0) ? matrix.off_diagonal[i] * matrix.off_diagonal[i] / q : 0.0;
+                q = matrix.diagonal[i] - x - coupling;
+
+                if (q == 0.0)
+                    q = -1e-300;
+
+                if (q < 0.0)
+                    ++count;
+            }
+
+            return count;
+        }
+
+        // index-th smallest eigenvalue by bisection
+        double eigenvalue(const Tridiagonal& matrix, const size_t index)
+        {
+            const size_t n = matrix.diagonal.size();
+
+            double lower = matrix.diagonal[0];
+            double upper = matrix.diagonal[0];
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                const double radius = std::abs(matrix.off_diagonal[i]) +
+                                      ((i + 1 < n) ? std::abs(matrix.off_diagonal[i + 1]) : 0.0);
+                lower = std::min(lower, matrix.diagonal[i] - radius);
+                upper = std::max(upper, matrix.diagonal[i] + radius);
+            }
+
+            for (int iteration = 0; iteration < 200 && upper - lower > 1e-13 * std::max(1.0, std::abs(upper)); ++iteration)
+            {
+                const double middle = 0.5 * (lower + upper);
+                if (count_below(matrix, middle) > index)
+                    upper = middle;
+                else
+                    lower = middle;
+            }
+
+            return 0.5 * (lower + upper);
+        }
+
+        // solve (T - shift * I) x = rhs in place, LU with partial pivoting like LAPACK gttrf/gtts2
+        void solve_shifted(const Tridiagonal& matrix, const double shift, std::vector<double>& rhs)
+        {
+            const size_t n = matrix.diagonal.size();
+
+            std::vector<double> lower(n, 0.0);
+            std::vector<double> diagonal(n);
+            std::vector<double> upper(n, 0.0);
+            std::vector<double> upper2(n, 0.0);
+            std::vector<bool> swapped(n, false);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                diagonal[i] = matrix.diagonal[i] - shift;
+                if (i + 1 < n)
+                {
+                    lower[i] = matrix.off_diagonal[i + 1];
+                    upper[i] = matrix.off_diagonal[i + 1];
+                }
+            }
+
+            for (size_t i = 0; i + 1 < n; ++i)
+            {
+                if (std::abs(diagonal[i]) >= std::abs(lower[i]))
+                {
+                    if (diagonal[i] == 0.0)
+                        diagonal[i] = 1e-300;
+
+                    const double factor = lower[i] / diagonal[i];
+                    lower[i] = factor;
+                    diagonal[i + 1] -= factor * upper[i];
+                }
+                else
+                {
+                    const double factor = diagonal[i] / lower[i];
+                    diagonal[i] = lower[i];
+                    lower[i] = factor;
+
+                    const double temp = upper[i];
+                    upper[i] = diagonal[i + 1];
+                    diagonal[i + 1] = temp - factor * diagonal[i + 1];
+
+                    if (i + 2 < n)
+                    {
+                        upper2[i] = upper[i + 1];
+                        upper[i + 1] = -factor * upper[i + 1];
+                    }
+
+                    swapped[i] = true;
+                }
+            }
+
+            if (diagonal[n - 1] == 0.0)
+                diagonal[n - 1] = 1e-300;
+
+            for (size_t i = 0; i + 1 < n; ++i)
+            {
+                if (!swapped[i])
+                {
+                    rhs[i + 1] -= lower[i] * rhs[i];
+                }
+                else
+                {
+                    const double temp = rhs[i];
+                    rhs[i] = rhs[i + 1];
+                    rhs[i + 1] = temp - lower[i] * rhs[i];
+                }
+            }
+
+            for (size_t i = n; i-- > 0;)
+            {
+                double value = rhs[i];
+                if (i + 1 < n)
+                    value -= upper[i] * rhs[i + 1];
+                if (i + 2 < n)
+                    value -= upper2[i] * rhs[i + 2];
+                rhs[i] = value / diagonal[i];
+            }
+        }
+
+        void normalize(std::vector<double>& vector)
+        {
+            double energy = 0.0;
+            for (const double value : vector)
+            {
+                energy += value * value;
+            }
+
+            const double norm = std::sqrt(energy);
+            if (norm > 0.0)
+            {
+                for (double& value : vector)
+                {
+                    value /= norm;
+                }
+            }
+        }
+
+        // energy fraction of a unit taper inside [-W, W], via its autocorrelation
+        double concentration(std::span<const double> taper, const double half_bandwidth)
+        {
+            const size_t n = taper.size();
+            double result = 2.0 * half_bandwidth;
+
+            for (size_t lag = 1; lag < n; ++lag)
+            {
+                double correlation = 0.0;
+                for (size_t i = 0; i + lag < n; ++i)
+                {
+                    correlation += taper[i] * taper[i + lag];
+                }
+
+                result += 2.0 * correlation * std::sin(2.0 * std::numbers::pi * half_bandwidth * lag) /
+                        (std::numbers::pi * static_cast<double>(lag));
+            }
+
+            return result;
+        }
+
+        std::shared_ptr<const DpssTapers> compute_tapers(
+            const size_t window_size,
+            const double time_bandwidth,
+            const size_t taper_count)
+        {
+            auto result = std::make_shared<DpssTapers>();
+            result->window_size = window_size;
+            result->count = taper_count;
+            result->tapers.resize(taper_count * window_size);
+            result->concentrations.resize(taper_count);
+
+            const double half_bandwidth = time_bandwidth / static_cast<double>(window_size);
+            const Tridiagonal matrix = dpss_matrix(window_size, half_bandwidth);
+
+            std::vector<double> vector(window_size);
+
+            for (size_t k = 0; k < taper_count; ++k)
+            {
+                const double lambda = eigenvalue(matrix, window_size - 1 - k);
+
+                // inverse iteration, the shift keeps the system just off singular
+                const double shift = lambda + 1e-10 * std::max(1.0, std::abs(lambda));
+                for (size_t i = 0; i < window_size; ++i)
+                {
+                    vector[i] = 1.0 + 0.01 * static_cast<double>(i % 7);
+                }
+
+                for (int iteration = 0; iteration < 3; ++iteration)
+                {
+                    solve_shifted(matrix, shift, vector);
+                    normalize(vector);
+                }
+
+                // conventional signs: symmetric tapers sum positive, antisymmetric ones start positive
+                double sum = 0.0;
+                double first_lobe = 0.0;
+                for (size_t i = 0; i < window_size; ++i)
+                {
+                    sum += vector[i];
+                    if (i < window_size / 2)
+                        first_lobe += vector[i] * static_cast<double>(window_size / 2 - i);
+                }
+
+                if ((k % 2 == 0 && sum < 0.0) || (k % 2 == 1 && first_lobe < 0.0))
+                {
+                    for (double& value : vector)
+                        value = -value;
+                }
+
+                std::copy(vector.begin(), vector.end(), result->tapers.begin() + static_cast<std::ptrdiff_t>(k * window_size));
+                result->concentrations[k] = concentration(vector, half_bandwidth);
+            }
+
+            return result;
+        }
+    }
+
+    std::shared_ptr<const DpssTapers> MultitaperEstimator::get_tapers(
+        const size_t window_size,
+        const double time_bandwidth,
+        const size_t taper_count)
+    {
+        static std::mutex cache_mutex;
+        static std::map<std::tuple<size_t, double, size_t>, std::shared_ptr<const DpssTapers> > cache;
+
+        const auto key = std::make_tuple(window_size, time_bandwidth, taper_count);
+
+        std::lock_guard lock(cache_mutex);
+
+        if (const auto it = cache.find(key); it != cache.end())
+        {
+            return it->second;
+        }
+
+        auto tapers = compute_tapers(window_size, time_bandwidth, taper_count);
+        g_logger.debug("Computed {} DPSS tapers for window {} (NW = {:.1f})", taper_count, window_size, time_bandwidth);
+
+        cache.emplace(key, tapers);
+        return tapers;
+    }
+
+    MultitaperEstimator::MultitaperEstimator(
+        const size_t window_size,
+        const double time_bandwidth,
+        const size_t taper_count,
+        const SpectralAveraging averaging)
+        : SpectralEstimator(window_size),
+          m_averaging(averaging)
+    {
+        if (time_bandwidth <= 0.0 || time_bandwidth >= static_cast<double>(window_size) / 2.0)
+        {
+            throw std::invalid_argument("Multitaper time-bandwidth must be in (0, window / 2)");
+        }
+
+        const auto default_count = static_cast<size_t>(std::max(1.0, std::floor(2.0 * time_bandwidth) - 1.0));
+        const size_t count = std::min((taper_count == 0) ? default_count : taper_count, window_size);
+
+        m_tapers = get_tapers(window_size, time_bandwidth, count);
+
+        reserve_batch(count);
+    }
+
+    const kfr::univector<double>& MultitaperEstimator::compute(const std::span<const double> frame)
+    {
+        const size_t count = m_tapers->count;
+        const size_t samples = std::min(frame.size(), m_window_size);
+
+        for (size_t k = 0; k < count; ++k)
+        {
+            const double* taper = m_tapers->tapers.data() + k * m_window_size;
+            double* row = m_batch.data() + k * m_window_size;
+
+            for (size_t i = 0; i < samples; ++i)
+            {
+                row[i] = frame[i] * taper[i];
+            }
+
+            std::fill(row + samples, row + m_window_size, 0.0);
+        }
+
+        transform_batch(count);
+        average_batch(count, m_averaging, m_tapers->concentrations, m_reference_energy);
+
+        return m_power_spectrum;
+    }
+} // namespace brainviz::analysis
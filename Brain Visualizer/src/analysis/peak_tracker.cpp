@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <analysis/peak_tracker.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // keeps empty bins finite under the log
+        constexpr double POWER_FLOOR = 1e-300;
+
+        double log_power(const double power)
+        {
+            return std::log10(std::max(power, POWER_FLOOR));
+        }
+
+        // offset of the vertex of the parabola through (-1, a), (0, b), (1, c), 0 unless b is a strict maximum
+        double vertex_offset(const double a, const double b, const double c)
+        {
+            const double curvature = a - 2.0 * b + c;
+            return curvature < 0.0 ? std::clamp(0.5 * (a - c) / curvature, -0.5, 0.5) : 0.0;
+        }
+    }
+
+    PeakTracker::PeakTracker(
+        const BandSet& bands,
+        const double sampling_rate,
+        const size_t window_size,
+        const PeakOptions options)
+        : m_table(bands, sampling_rate, window_size),
+          m_options(options),
+          m_frequency_resolution(sampling_rate / static_cast<double>(window_size))
+    {
+        const size_t bins = m_table.get_bin_count();
+
+        m_log_frequency.resize(bins, 0.0);
+        for (size_t bin = 1; bin < bins; ++bin)
+        {
+            m_log_frequency[bin] = std::log10(static_cast<double>(bin) * m_frequency_resolution);
+        }
+
+        m_residual.resize(bins, 0.0);
+
+        // peaks need a neighbour on both sides, so never DC or the last bin
+        m_first_bin = bins;
+        m_last_bin = 0;
+        for (size_t band = 0; band < m_table.get_band_count(); ++band)
+        {
+            // the aperiodic line is undefined at dc so bin 0 keeps raw log power, it cannot be a neighbor then
+            const size_t first = std::max<size_t>(m_table.first_bin(band), m_options.fit_aperiodic ? 2 : 1);
+            const size_t last = std::min(m_table.last_bin(band), bins - 2);
+
+            if (!m_table.is_band_empty(band) && first <= last)
+            {
+                m_first_bin = std::min(m_first_bin, first - 1);
+                m_last_bin = std::max(m_last_bin, last + 1);
+            }
+        }
+
+        if (!m_options.fit_aperiodic)
+        {
+            return;
+        }
+
+        m_fit_first = std::max<size_t>(static_cast<size_t>(std::ceil(m_options.fit_min_freq / m_frequency_resolution)), 1);
+        m_fit_last = std::min(static_cast<size_t>(std::floor(m_options.fit_max_freq / m_frequency_resolution)), bins - 1);
+
+        if (m_fit_last < m_fit_first + 2)
+        {
+            throw std::invalid_argument(fmt::format(
+                "Aperiodic fit range {}-{} Hz holds fewer than 3 bins at {:.3f} Hz resolution",
+                m_options.fit_min_freq, m_options.fit_max_freq, m_frequency_resolution));
+        }
+    }
+
+    void PeakTracker::track(
+        const std::span<const double> power_spectrum,
+        const std::span<double> frequencies,
+        const std::span<double> powers,
+        const std::span<double> aperiodic)
+    {
+        std::ranges::fill(frequencies, std::numeric_limits<double>::quiet_NaN());
+        std::ranges::fill(powers, 0.0);
+        std::ranges::fill(aperiodic, 0.0);
+
+        const size_t bins = std::min(power_spectrum.size(), m_table.get_bin_count());
+        if (bins < 3)
+        {
+            return;
+        }
+
+        double offset = 0.0;
+        double exponent = 0.0;
+
+        if (m_options.fit_aperiodic)
+        {
+            const size_t first = std::min(m_first_bin, m_fit_first);
+            const size_t last = std::min(std::max(m_last_bin, m_fit_last), bins - 1);
+
+            for (size_t bin = first; bin <= last; ++bin)
+            {
+                m_residual[bin] = log_power(power_spectrum[bin]);
+            }
+
+            fit_aperiodic(power_spectrum, offset, exponent);
+
+            for (size_t bin = std::max<size_t>(m_first_bin, 1); bin <= std::min(m_last_bin, bins - 1); ++bin)
+            {
+                m_residual[bin] -= offset - exponent * m_log_frequency[bin];
+            }
+
+            aperiodic[0] = offset;
+            aperiodic[1] = exponent;
+        }
+
+        // compare in the flattened spectrum with the fit, plain power is enough without (the log is monotonic)
+        const auto value = [&](const size_t bin) {
+            return m_options.fit_aperiodic ? m_residual[bin] : power_spectrum[bin];
+        };
+
+        for (size_t band = 0; band < m_table.get_band_count(); ++band)
+        {
+            if (m_table.is_band_empty(band))
+            {
+                continue;
+            }
+
+            // the aperiodic line is undefined at dc so bin 0 keeps raw log power, it cannot be a neighbor then
+            const size_t first = std::max<size_t>(m_table.first_bin(band), m_options.fit_aperiodic ? 2 : 1);
+            const size_t last = std::min(m_table.last_bin(band), bins - 2);
+
+            size_t peak = 0;
+            for (size_t bin = first; bin <= last; ++bin)
+            {
+                const double current = value(bin);
+                if (current > value(bin - 1) && current >= value(bin + 1) && (peak == 0 || current > value(peak)))
+                {
+                    peak = bin;
+                }
+            }
+
+            if (peak == 0)
+            {
+                continue;
+            }
+
+            const double a = m_options.fit_aperiodic ? m_residual[peak - 1] : log_power(power_spectrum[peak - 1]);
+            const double b = m_options.fit_aperiodic ? m_residual[peak] : log_power(power_spectrum[peak]);
+            const double c = m_options.fit_aperiodic ? m_residual[peak + 1] : log_power(power_spectrum[peak + 1]);
+
+            const double shift = vertex_offset(a, b, c);
+            const double height = b - 0.25 * (a - c) * shift;
+            const double frequency = (static_cast<double>(peak) + shift) * m_frequency_resolution;
+
+            if (!m_options.fit_aperiodic)
+            {
+                frequencies[band] = frequency;
+                powers[band] = std::pow(10.0, height);
+                continue;
+            }
+
+            // a local maximum still below the aperiodic line is a dip in the slope, not a peak
+            if (height <= 0.0)
+            {
+                continue;
+            }
+
+            frequencies[band] = frequency;
+            powers[band] = std::pow(10.0, offset - exponent * std::log10(frequency)) * (std::pow(10.0, height) - 1.0);
+        }
+    }
+
+    void PeakTracker::fit_aperiodic(const std::span<const double> power_spectrum, double& offset, double& exponent)
+    {
+        const size_t last = std::min(m_fit_last, power_spectrum.size() - 1);
+        if (last < m_fit_first + 2)
+        {
+            offset = 0.0;
+            exponent = 0.0;
+            return;
+        }
+
+        // least squares line through (log10 f, log10 power) of the bins whose residual is at most limit
+        const auto fit = [&](const double intercept, const double slope, const double limit) {
+            double n = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+
+            for (size_t bin = m_fit_first; bin <= last; ++bin)
+            {
+                const double x = m_log_frequency[bin];
+                const double y = m_residual[bin];
+
+                if (y - (intercept + slope * x) > limit)
+                {
+                    continue;
+                }
+
+                n += 1.0;
+                sx += x;
+                sy += y;
+                sxx += x * x;
+                sxy += x * y;
+            }
+
+            const double denominator = n * sxx - sx * sx;
+            if (n < 2.0 || denominator <= 0.0)
+            {
+                return std::pair{intercept, slope};
+            }
+
+            const double fitted_slope = (n * sxy - sx * sy) / denominator;
+            return std::pair{(sy - fitted_slope * sx) / n, fitted_slope};
+        };
+
+        const auto [intercept, slope] = fit(0.0, 0.0, std::numeric_limits<double>::infinity());
+
+        double squares = 0.0;
+        for (size_t bin = m_fit_first; bin <= last; ++bin)
+        {
+            const double residual = m_residual[bin] - (intercept + slope * m_log_frequency[bin]);
+            squares += residual * residual;
+        }
+
+        const double deviation = std::sqrt(squares / static_cast<double>(last - m_fit_first + 1));
+        const auto [robust_intercept, robust_slope] = fit(intercept, slope, deviation);
+
+        offset = robust_intercept;
+        exponent = -robust_slope;
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,34 @@
+#include <algorithm>
+
+#include <analysis/periodogram.hpp>
+
+namespace brainviz::analysis
+{
+    Periodogram::Periodogram(const size_t window_size)
+        : SpectralEstimator(window_size),
+          m_window(periodic_hann(window_size))
+    {
+        reserve_batch(1);
+    }
+
+    const kfr::univector<double>& Periodogram::compute(const std::span<const double> frame)
+    {
+        const size_t count = std::min(frame.size(), m_window_size);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_batch[i] = frame[i] * m_window[i];
+        }
+
+        for (size_t i = count; i < m_window_size; ++i)
+        {
+            m_batch[i] = 0.0;
+        }
+
+        transform_batch(1);
+
+        std::copy_n(m_batch_power.begin(), get_bin_count(), m_power_spectrum.begin());
+
+        return m_power_spectrum;
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#include <fmt/format.h>
+#include <kfr/all.hpp>
+
+#include <logging/logger.hpp>
+#include <utils/parallel.hpp>
+#include <analysis/frequency_analyzer.hpp>
+#include <analysis/phase_amplitude_coupling.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // copy samples into signal with the mean removed, zero padded to signal's size
+        void load_centred(const std::span<const double> samples, std::vector<double>& signal)
+        {
+            double mean = 0.0;
+            for (const double sample : samples)
+            {
+                mean += sample;
+            }
+            mean /= static_cast<double>(std::max<size_t>(samples.size(), 1));
+
+            std::fill(signal.begin(), signal.end(), 0.0);
+            for (size_t i = 0; i < samples.size(); ++i)
+            {
+                signal[i] = samples[i] - mean;
+            }
+        }
+
+        // forward and backward through the cascade, up to LANES signals in place
+        void filter_zero_phase(const std::vector<Biquad>& sections, const std::span<double* const> signals, const size_t n)
+        {
+            std::vector<double> state(2 * sections.size() * IirFilterBank::LANES, 0.0);
+            run_cascade(sections, signals, n, state, false);
+
+            std::fill(state.begin(), state.end(), 0.0);
+            run_cascade(sections, signals, n, state, true);
+        }
+
+        // bin of the instantaneous phase of every sample, [-pi, pi) in bins equal steps
+        void to_phase_bins(
+            const kfr::univector<kfr::complex<double> >& analytic,
+            const size_t bins,
+            const std::span<std::uint16_t> phase_bins)
+        {
+            const double scale = static_cast<double>(bins) / (2.0 * std::numbers::pi);
+
+            for (size_t i = 0; i < phase_bins.size(); ++i)
+            {
+                const double phase = std::arg(analytic[i]) + std::numbers::pi;
+                phase_bins[i] = static_cast<std::uint16_t>(std::min(static_cast<size_t>(phase * scale), bins - 1));
+            }
+        }
+
+        void to_amplitude(const kfr::univector<kfr::complex<double> >& analytic, const std::span<double> amplitude)
+        {
+            for (size_t i = 0; i < amplitude.size(); ++i)
+            {
+                amplitude[i] = std::abs(analytic[i]);
+            }
+        }
+
+        // per block amplitude sums and sample counts of each phase bin, [block][bin]
+        void sum_blocks(
+            const std::span<const std::uint16_t> phase_bins,
+            const std::span<const double> amplitude,
+            const size_t bins,
+            const size_t block_size,
+            std::vector<double>& sums,
+            std::vector<size_t>& counts)
+        {
+            const size_t block_count = (phase_bins.size() + block_size - 1) / block_size;
+
+            sums.assign(block_count * bins, 0.0);
+            counts.assign(block_count * bins, 0);
+
+            for (size_t i = 0; i < phase_bins.size(); ++i)
+            {
+                const size_t slot = (i / block_size) * bins + phase_bins[i];
+                sums[slot] += amplitude[i];
+                ++counts[slot];
+            }
+        }
+    }
+
+    double PacEngine::modulation_index(const std::span<const double> bin_amplitudes)
+    {
+        const double total = std::accumulate(bin_amplitudes.begin(), bin_amplitudes.end(), 0.0);
+        if (bin_amplitudes.size() < 2 || !(total > 0.0))
+        {
+            return 0.0;
+        }
+
+        double entropy = 0.0;
+        for (const double amplitude : bin_amplitudes)
+        {
+            const double p = amplitude / total;
+            if (p > 0.0)
+            {
+                entropy -= p * std::log(p);
+            }
+        }
+
+        const double max_entropy = std::log(static_cast<double>(bin_amplitudes.size()));
+        return std::max(0.0, (max_entropy - entropy) / max_entropy);
+    }
+
+    PacEngine::PacEngine(const data::EEGData& eeg_data, PacOptions options)
+        : m_eeg_data(eeg_data),
+          m_options(std::move(options)),
+          m_sampling_rate(eeg_data.m_samplingRate)
+    {
+        const auto& o = m_options;
+
+        if (o.phase_bins < 2 || o.phase_bins > std::numeric_limits<std::uint16_t>::max())
+        {
+            throw std::invalid_argument(fmt::format("Invalid phase bin count {}", o.phase_bins));
+        }
+
+        if (!(o.phase_min_freq < o.phase_max_freq) || !(o.amplitude_min_freq < o.amplitude_max_freq) ||
+            !(o.phase_max_freq <= o.amplitude_min_freq))
+        {
+            throw std::invalid_argument(fmt::format("Invalid coupling bands: phase {}-{} Hz, amplitude {}-{} Hz",
+                                                    o.phase_min_freq, o.phase_max_freq, o.amplitude_min_freq,
+                                                    o.amplitude_max_freq));
+        }
+
+        m_window_size = static_cast<size_t>(std::round(o.window_seconds * m_sampling_rate));
+        m_hop_size = static_cast<size_t>(std::round(o.hop_seconds * m_sampling_rate));
+
+        if (m_window_size == 0 || m_hop_size == 0)
+        {
+            throw std::invalid_argument(fmt::format("Invalid coupling window {} s, hop {} s", o.window_seconds,
+                                                    o.hop_seconds));
+        }
+
+        m_phase_filter = design_band_pass(m_sampling_rate, o.phase_min_freq, o.phase_max_freq, o.order);
+        m_amplitude_filter = design_band_pass(m_sampling_rate, o.amplitude_min_freq, o.amplitude_max_freq, o.order);
+
+        g_logger.info("Initialized phase-amplitude coupling, phase {}-{} Hz, amplitude {}-{} Hz, {} bins",
+                      o.phase_min_freq, o.phase_max_freq, o.amplitude_min_freq, o.amplitude_max_freq, o.phase_bins);
+    }
+
+    void PacEngine::process_all_channels()
+    {
+        process_channels(m_eeg_data.get_channel_names());
+    }
+
+    void PacEngine::process_channel(const std::string_view channel_name)
+    {
+        process_channels({std::string(channel_name)});
+    }
+
+    std::span<const double> PacEngine::get_modulation_index(const std::string_view channel_name) const
+    {
+        const auto it = m_modulation_index.find(std::string(channel_name));
+        if (it == m_modulation_index.end())
+        {
+            throw std::out_of_range(fmt::format("No coupling results for channel {}", channel_name));
+        }
+        return it->second;
+    }
+
+    void PacEngine::process_channels(const std::vector<std::string>& channel_names)
+    {
+        const size_t bins = m_options.phase_bins;
+        const size_t block_size = std::gcd(m_window_size, m_hop_size);
+        const size_t blocks_per_window = m_window_size / block_size;
+        const size_t blocks_per_hop = m_hop_size / block_size;
+
+        std::vector<const std::vector<double>*> raw_data;
+        std::vector<std::vector<double>*> results;
+
+        for (const auto& channel_name : channel_names)
+        {
+            raw_data.push_back(&m_eeg_data.get_channel(channel_name));
+            m_modulation_index[channel_name].assign(FrequencyAnalyzer::frame_count(raw_data.back()->size(), m_window_size, m_hop_size), 0.0);
+        }
+
+        // pointers only after every insert, a rehash moves the values
+        for (const auto& channel_name : channel_names)
+        {
+            results.push_back(&m_modulation_index.find(channel_name).value());
+        }
+
+        constexpr size_t lanes = IirFilterBank::LANES;
+        const size_t groups = (raw_data.size() + lanes - 1) / lanes;
+
+        utils::parallel_for(groups, [&](const size_t begin, const size_t end) {
+            std::vector<std::vector<double> > phase_signals(lanes);
+            std::vector<std::vector<double> > amplitude_signals(lanes);
+            std::vector<double*> phase_lanes;
+            std::vector<double*> amplitude_lanes;
+
+            HilbertTransform::Workspace workspace;
+            std::vector<std::uint16_t> phase_bins;
+            std::vector<double> amplitude;
+            std::vector<double> sums;
+            std::vector<size_t> counts;
+            std::vector<double> bin_amplitudes(bins);
+
+            for (size_t g = begin; g < end; ++g)
+            {
+                const size_t first = g * lanes;
+                const size_t count = std::min(lanes, raw_data.size() - first);
+
+                size_t sample_count = 0;
+                for (size_t lane = 0; lane < count; ++lane)
+                {
+                    sample_count = std::max(sample_count, raw_data[first + lane]->size());
+                }
+
+                phase_lanes.clear();
+                amplitude_lanes.clear();
+
+                for (size_t lane = 0; lane < count; ++lane)
+                {
+                    phase_signals[lane].resize(sample_count);
+                    load_centred(*raw_data[first + lane], phase_signals[lane]);
+                    amplitude_signals[lane] = phase_signals[lane];
+
+                    phase_lanes.push_back(phase_signals[lane].data());
+                    amplitude_lanes.push_back(amplitude_signals[lane].data());
+                }
+
+                filter_zero_phase(*m_phase_filter, phase_lanes, sample_count);
+                filter_zero_phase(*m_amplitude_filter, amplitude_lanes, sample_count);
+
+                for (size_t lane = 0; lane < count; ++lane)
+                {
+                    const size_t samples = raw_data[first + lane]->size();
+                    auto& result = *results[first + lane];
+
+                    phase_bins.resize(samples);
+                    amplitude.resize(samples);
+
+                    m_hilbert.analytic_signal(std::span(phase_signals[lane]).first(samples), workspace);
+                    to_phase_bins(workspace.analytic, bins, phase_bins);
+
+                    m_hilbert.analytic_signal(std::span(amplitude_signals[lane]).first(samples), workspace);
+                    to_amplitude(workspace.analytic, amplitude);
+
+                    sum_blocks(phase_bins, amplitude, bins, block_size, sums, counts);
+                    const size_t block_count = counts.size() / bins;
+
+                    // every window merges its blocks, a short channel gets one window over what it has
+                    for (size_t window = 0; window < result.size(); ++window)
+                    {
+                        const size_t first_block = window * blocks_per_hop;
+                        const size_t last_block = std::min(block_count, first_block + blocks_per_window);
+
+                        for (size_t bin = 0; bin < bins; ++bin)
+                        {
+                            double sum = 0.0;
+                            size_t samples_in_bin = 0;
+
+                            for (size_t block = first_block; block < last_block; ++block)
+                            {
+                                sum += sums[block * bins + bin];
+                                samples_in_bin += counts[block * bins + bin];
+                            }
+
+                            bin_amplitudes[bin] = samples_in_bin > 0 ? sum / static_cast<double>(samples_in_bin) : 0.0;
+                        }
+
+                        result[window] = modulation_index(bin_amplitudes);
+                    }
+                }
+            }
+        });
+    }
+
+    Comodulogram PacEngine::compute_comodulogram(
+        const std::string_view channel_name,
+        const ComodulogramGrid& grid,
+        const size_t first_sample,
+        const size_t sample_count) const
+    {
+        if (!(grid.phase_step > 0.0) || !(grid.amplitude_step > 0.0) || grid.phase_start > grid.phase_stop ||
+            grid.amplitude_start > grid.amplitude_stop)
+        {
+            throw std::invalid_argument("Invalid comodulogram grid");
+        }
+
+        const auto& raw = m_eeg_data.get_channel(channel_name);
+        const size_t first = std::min(first_sample, raw.size());
+        const size_t n = std::min(sample_count, raw.size() - first);
+        const auto samples = std::span(raw).subspan(first, n);
+
+        Comodulogram result;
+
+        // a small fraction of a step keeps the stop frequency in despite rounding
+        for (double f = grid.phase_start; f <= grid.phase_stop + 1e-9 * grid.phase_step; f += grid.phase_step)
+        {
+            result.phase_freqs.push_back(f);
+        }
+        for (double f = grid.amplitude_start; f <= grid.amplitude_stop + 1e-9 * grid.amplitude_step;
+             f += grid.amplitude_step)
+        {
+            result.amplitude_freqs.push_back(f);
+        }
+
+        const size_t phase_count = result.phase_freqs.size();
+        const size_t amplitude_count = result.amplitude_freqs.size();
+        const size_t bins = m_options.phase_bins;
+
+        result.modulation_index.assign(phase_count * amplitude_count, 0.0);
+        if (n == 0)
+        {
+            return result;
+        }
+
+        const double amplitude_bandwidth = grid.amplitude_bandwidth > 0.0
+                                               ? grid.amplitude_bandwidth
+                                               : 2.0 * result.phase_freqs.back();
+
+        // every grid frequency is filtered once, [frequency][sample]
+        std::vector<std::uint16_t> phase_bins(phase_count * n);
+        std::vector<double> amplitudes(amplitude_count * n);
+
+        utils::parallel_for(phase_count + amplitude_count, [&](const size_t begin, const size_t end) {
+            std::vector<double> signal(n);
+            HilbertTransform::Workspace workspace;
+
+            for (size_t job = begin; job < end; ++job)
+            {
+                const bool is_phase = job < phase_count;
+                const double centre = is_phase ? result.phase_freqs[job] : result.amplitude_freqs[job - phase_count];
+                const double half_width = 0.5 * (is_phase ? grid.phase_bandwidth : amplitude_bandwidth);
+
+                const auto sections = design_band_pass(m_sampling_rate, std::max(centre - half_width, 0.0),
+                                                       centre + half_width, m_options.order);
+
+                load_centred(samples, signal);
+                double* lanes[] = {signal.data()};
+                filter_zero_phase(*sections, lanes, n);
+
+                m_hilbert.analytic_signal(signal, workspace);
+
+                if (is_phase)
+                {
+                    to_phase_bins(workspace.analytic, bins, std::span(phase_bins).subspan(job * n, n));
+                }
+                else
+                {
+                    to_amplitude(workspace.analytic, std::span(amplitudes).subspan((job - phase_count) * n, n));
+                }
+            }
+        });
+
+        utils::parallel_for(phase_count * amplitude_count, [&](const size_t begin, const size_t end) {
+            std::vector<double> sums(bins);
+            std::vector<size_t> counts(bins);
+
+            for (size_t cell = begin; cell < end; ++cell)
+            {
+                const size_t p = cell / amplitude_count;
+                const size_t a = cell % amplitude_count;
+
+                // the amplitude band has to sit above the phase band, the cell stays 0 otherwise
+                if (result.amplitude_freqs[a] - 0.5 * amplitude_bandwidth <
+                    result.phase_freqs[p] + 0.5 * grid.phase_bandwidth)
+                {
+                    continue;
+                }
+
+                const std::uint16_t* phase = phase_bins.data() + p * n;
+                const double* amplitude = amplitudes.data() + a * n;
+
+                std::fill(sums.begin(), sums.end(), 0.0);
+                std::fill(counts.begin(), counts.end(), 0);
+
+                for (size_t i = 0; i < n; ++i)
+                {
+                    sums[phase[i]] += amplitude[i];
+                    ++counts[phase[i]];
+                }
+
+                for (size_t bin = 0; bin < bins; ++bin)
+                {
+                    sums[bin] = counts[bin] > 0 ? sums[bin] / static_cast<double>(counts[bin]) : 0.0;
+                }
+
+                result.modulation_index[cell] = modulation_index(sums);
+            }
+        });
+
+        return result;
+    }
+} // namespace brainviz::analysis
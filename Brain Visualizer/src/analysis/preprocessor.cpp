@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <logging/logger.hpp>
+#include <utils/parallel.hpp>
+#include <analysis/preprocessor.hpp>
+
+namespace brainviz::analysis
+{
+    Preprocessor::Preprocessor(const double sampling_rate, PreprocessingOptions options)
+        : m_sampling_rate(sampling_rate),
+          m_options(std::move(options)),
+          m_notch(std::make_shared<const std::vector<Biquad> >()),
+          m_high_pass(std::make_shared<const std::vector<Biquad> >())
+    {
+        if (m_options.line_frequency > 0.0 && m_options.line_harmonics > 0)
+        {
+            m_notch = design_notch(sampling_rate, m_options.line_frequency, m_options.line_harmonics,
+                                   m_options.notch_quality);
+        }
+
+        if (m_options.high_pass > 0.0)
+        {
+            m_high_pass = design_band_pass(sampling_rate, m_options.high_pass, sampling_rate / 2.0,
+                                           std::max<size_t>(m_options.high_pass_order, 1));
+        }
+
+        reset_stage_costs();
+    }
+
+    void Preprocessor::reset_stage_costs()
+    {
+        m_stage_costs = {StageCost{"notch"}, StageCost{"high-pass"}, StageCost{"re-reference"}};
+    }
+
+    void Preprocessor::reset()
+    {
+        m_stream_state.clear();
+    }
+
+    void Preprocessor::process(data::EEGData& data)
+    {
+        run(data, false);
+
+        for (const auto& stage : m_stage_costs)
+        {
+            g_logger.debug("Preprocessing {}: {:.3f} ms, {:.2f} ns/sample", stage.name, stage.seconds * 1e3,
+                           stage.get_ns_per_sample());
+        }
+    }
+
+    void Preprocessor::process_block(data::EEGData& block)
+    {
+        run(block, true);
+    }
+
+    void Preprocessor::run(data::EEGData& data, const bool stream)
+    {
+        const auto names = data.get_channel_names();
+        const size_t state_size = 2 * (m_notch->size() + m_high_pass->size());
+
+        std::vector<std::vector<double>*> channels;
+        for (const auto& name : names)
+        {
+            channels.push_back(&data.get_channel(name));
+        }
+
+        // a recording starts from rest, a stream picks up where each channel's last block ended
+        std::vector<std::vector<double> > fresh_states;
+        std::vector<std::vector<double>*> states;
+
+        if (stream)
+        {
+            for (const auto& name : names)
+            {
+                m_stream_state.try_emplace(name, state_size, 0.0);
+            }
+
+            // pointers only after every insert, a rehash moves the values
+            for (const auto& name : names)
+            {
+                states.push_back(&m_stream_state.find(name).value());
+            }
+        }
+        else
+        {
+            fresh_states.assign(names.size(), std::vector<double>(state_size, 0.0));
+            for (auto& state : fresh_states)
+            {
+                states.push_back(&state);
+            }
+        }
+
+        if (!m_notch->empty())
+        {
+            run_filter_stage(0, *m_notch, 0, channels, states);
+        }
+
+        if (!m_high_pass->empty())
+        {
+            run_filter_stage(1, *m_high_pass, 2 * m_notch->size(), channels, states);
+        }
+
+        if (m_options.reference != Reference::None)
+        {
+            rereference(channels, names);
+        }
+    }
+
+    void Preprocessor::run_filter_stage(
+        const size_t stage,
+        const std::vector<Biquad>& sections,
+        const size_t state_offset,
+        const std::span<std::vector<double>* const> channels,
+        const std::span<std::vector<double>* const> states)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        constexpr size_t lanes = IirFilterBank::LANES;
+
+        // runs of up to LANES neighbouring channels of the same length filter together
+        std::vector<std::pair<size_t, size_t> > groups;
+        size_t samples = 0;
+
+        for (size_t i = 0; i < channels.size(); ++i)
+        {
+            samples += channels[i]->size();
+
+            if (!groups.empty() && groups.back().second < lanes &&
+                channels[groups.back().first]->size() == channels[i]->size())
+            {
+                ++groups.back().second;
+            }
+            else
+            {
+                groups.emplace_back(i, 1);
+            }
+        }
+
+        utils::parallel_for(groups.size(), [&](const size_t begin, const size_t end) {
+            std::vector<double> lane_state(2 * sections.size() * lanes);
+            std::vector<double*> signals;
+
+            for (size_t g = begin; g < end; ++g)
+            {
+                const auto [first, count] = groups[g];
+
+                // per channel [row] state to the cascade's [row][lane] layout and back
+                std::fill(lane_state.begin(), lane_state.end(), 0.0);
+                signals.clear();
+
+                for (size_t lane = 0; lane < count; ++lane)
+                {
+                    signals.push_back(channels[first + lane]->data());
+
+                    const double* state = states[first + lane]->data() + state_offset;
+                    for (size_t row = 0; row < 2 * sections.size(); ++row)
+                    {
+                        lane_state[row * lanes + lane] = state[row];
+                    }
+                }
+
+                run_cascade(sections, signals, channels[first]->size(), lane_state);
+
+                for (size_t lane = 0; lane < count; ++lane)
+                {
+                    double* state = states[first + lane]->data() + state_offset;
+                    for (size_t row = 0; row < 2 * sections.size(); ++row)
+                    {
+                        state[row] = lane_state[row * lanes + lane];
+                    }
+                }
+            }
+        });
+
+        auto& cost = m_stage_costs[stage];
+        cost.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        cost.samples += samples;
+    }
+
+    void Preprocessor::rereference(
+        const std::span<std::vector<double>* const> channels,
+        const std::span<const std::string> names)
+    {
+        if (channels.empty())
+        {
+            return;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        // channels of a block can differ in length, only the samples they all have are re-referenced
+        size_t sample_count = channels.front()->size();
+        for (const auto* channel : channels)
+        {
+            sample_count = std::min(sample_count, channel->size());
+        }
+
+        std::vector<double> reference(sample_count, 0.0);
+
+        if (m_options.reference == Reference::CommonAverage)
+        {
+            for (const auto* channel : channels)
+            {
+                const double* x = channel->data();
+                for (size_t t = 0; t < sample_count; ++t)
+                {
+                    reference[t] += x[t];
+                }
+            }
+
+            const double scale = 1.0 / static_cast<double>(channels.size());
+            for (double& value : reference)
+            {
+                value *= scale;
+            }
+        }
+        else
+        {
+            std::array<const std::vector<double>*, 2> mastoids{};
+
+            for (size_t m = 0; m < mastoids.size(); ++m)
+            {
+                const auto it = std::find(names.begin(), names.end(), m_options.mastoid_channels[m]);
+                if (it == names.end())
+                {
+                    throw std::runtime_error(fmt::format("Linked mastoid reference needs channels {} and {}",
+                                                         m_options.mastoid_channels[0],
+                                                         m_options.mastoid_channels[1]));
+                }
+
+                mastoids[m] = channels[static_cast<size_t>(it - names.begin())];
+            }
+
+            for (size_t t = 0; t < sample_count; ++t)
+            {
+                reference[t] = 0.5 * ((*mastoids[0])[t] + (*mastoids[1])[t]);
+            }
+        }
+
+        for (auto* channel : channels)
+        {
+            double* x = channel->data();
+            for (size_t t = 0; t < sample_count; ++t)
+            {
+                x[t] -= reference[t];
+            }
+        }
+
+        auto& cost = m_stage_costs[2];
+        cost.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        cost.samples += sample_count * channels.size();
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <stdexcept>
+
+#include <analysis/sliding_dft.hpp>
+
+namespace brainviz::analysis
+{
+    SlidingDftBank::SlidingDftBank(const BandBinTable& bands, const size_t window_size, const double damping)
+        : m_window_size(window_size),
+          m_damping(damping),
+          m_damping_n(std::pow(damping, static_cast<double>(window_size)))
+    {
+        if (window_size < 4)
+        {
+            throw std::invalid_argument("Sliding DFT window must hold at least 4 samples");
+        }
+
+        if (bands.get_bin_count() != window_size / 2 + 1)
+        {
+            throw std::invalid_argument("Sliding DFT band table was built for a different window size");
+        }
+
+        m_band_slots.resize(bands.get_band_count());
+        m_band_empty.resize(bands.get_band_count());
+
+        // the bin edges come from the same table the FFT path reduces with
+        size_t lowest_bin = std::numeric_limits<size_t>::max();
+        size_t highest_bin = 0;
+
+        for (size_t band = 0; band < bands.get_band_count(); ++band)
+        {
+            m_band_empty[band] = bands.is_band_empty(band);
+            if (m_band_empty[band])
+                continue;
+
+            lowest_bin = std::min(lowest_bin, bands.first_bin(band));
+            highest_bin = std::max(highest_bin, bands.last_bin(band));
+        }
+
+        if (lowest_bin > highest_bin)
+        {
+            // nothing to track, every band is outside the spectrum
+            return;
+        }
+
+        // one bin of margin below and above for the hann kernel, wrapping around for DC
+        const size_t first_bin = (lowest_bin + window_size - 1) % window_size;
+        const size_t tracked = highest_bin - lowest_bin + 3;
+
+        m_bins.resize(tracked);
+        m_cos.resize(tracked);
+        m_sin.resize(tracked);
+
+        for (size_t slot = 0; slot < tracked; ++slot)
+        {
+            m_bins[slot] = (first_bin + slot) % window_size;
+
+            const double angle = 2.0 * std::numbers::pi * static_cast<double>(m_bins[slot]) /
+                                 static_cast<double>(window_size);
+            m_cos[slot] = m_damping * std::cos(angle);
+            m_sin[slot] = m_damping * std::sin(angle);
+        }
+
+        for (size_t band = 0; band < m_band_slots.size(); ++band)
+        {
+            if (!m_band_empty[band])
+            {
+                m_band_slots[band] = {bands.first_bin(band) - lowest_bin + 1, bands.last_bin(band) - lowest_bin + 1};
+            }
+        }
+    }
+
+    size_t SlidingDftBank::add_channel()
+    {
+        resize_channels(m_channels + 1);
+        return m_channels - 1;
+    }
+
+    void SlidingDftBank::resize_channels(const size_t channels)
+    {
+        const size_t bins = m_bins.size();
+
+        std::vector<double> real(bins * channels, 0.0);
+        std::vector<double> imag(bins * channels, 0.0);
+
+        for (size_t k = 0; k < bins; ++k)
+        {
+            for (size_t c = 0; c < m_channels; ++c)
+            {
+                real[k * channels + c] = m_real[k * m_channels + c];
+                imag[k * channels + c] = m_imag[k * m_channels + c];
+            }
+        }
+
+        m_real = std::move(real);
+        m_imag = std::move(imag);
+
+        m_delay.resize(channels * m_window_size, 0.0);
+        m_delay_pos.resize(channels, 0);
+        m_delta.resize(channels, 0.0);
+
+        m_channels = channels;
+    }
+
+    void SlidingDftBank::push(const std::span<const double> samples)
+    {
+        if (samples.size() != m_channels)
+        {
+            throw std::invalid_argument("Sliding DFT push needs exactly one sample per channel");
+        }
+
+        const size_t channels = m_channels;
+        const size_t window_size = m_window_size;
+
+        for (size_t c = 0; c < channels; ++c)
+        {
+            double& oldest = m_delay[c * window_size + m_delay_pos[c]];
+            m_delta[c] = samples[c] - m_damping_n * oldest;
+            oldest = samples[c];
+            m_delay_pos[c] = (m_delay_pos[c] + 1 == window_size) ? 0 : m_delay_pos[c] + 1;
+        }
+
+        const double* delta = m_delta.data();
+
+        for (size_t k = 0; k < m_bins.size(); ++k)
+        {
+            const double wc = m_cos[k];
+            const double ws = m_sin[k];
+
+            double* re = m_real.data() + k * channels;
+            double* im = m_imag.data() + k * channels;
+
+            // contiguous across channels, no dependencies between iterations
+            for (size_t c = 0; c < channels; ++c)
+            {
+                const double t = re[c] + delta[c];
+                const double i = im[c];
+                re[c] = wc * t - ws * i;
+                im[c] = ws * t + wc * i;
+            }
+        }
+    }
+
+    void SlidingDftBank::push_channel(const size_t slot, const double sample)
+    {
+        const size_t channels = m_channels;
+
+        double& oldest = m_delay[slot * m_window_size + m_delay_pos[slot]];
+        const double delta = sample - m_damping_n * oldest;
+        oldest = sample;
+        m_delay_pos[slot] = (m_delay_pos[slot] + 1 == m_window_size) ? 0 : m_delay_pos[slot] + 1;
+
+        for (size_t k = 0; k < m_bins.size(); ++k)
+        {
+            double& re = m_real[k * channels + slot];
+            double& im = m_imag[k * channels + slot];
+
+            const double t = re + delta;
+            const double i = im;
+            re = m_cos[k] * t - m_sin[k] * i;
+            im = m_sin[k] * t + m_cos[k] * i;
+        }
+    }
+
+    void SlidingDftBank::band_amplitudes(const size_t slot, const std::span<double> amplitudes) const
+    {
+        const size_t channels = m_channels;
+
+        for (size_t band = 0; band < m_band_slots.size(); ++band)
+        {
+            amplitudes[band] = 0.0;
+
+            if (m_band_empty[band])
+                continue;
+
+            double band_power = 0.0;
+
+            for (size_t k = m_band_slots[band].first; k <= m_band_slots[band].second; ++k)
+            {
+                // hann in the frequency domain: 0.5 X[k] - 0.25 (X[k - 1] + X[k + 1])
+                const double re = 0.5 * m_real[k * channels + slot]
+                                  - 0.25 * (m_real[(k - 1) * channels + slot] + m_real[(k + 1) * channels + slot]);
+                const double im = 0.5 * m_imag[k * channels + slot]
+                                  - 0.25 * (m_imag[(k - 1) * channels + slot] + m_imag[(k + 1) * channels + slot]);
+
+                band_power += re * re + im * im;
+            }
+
+            amplitudes[band] = std::sqrt(band_power);
+        }
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <numbers>
+#include <stdexcept>
+
+#include <analysis/spectral_estimator.hpp>
+#include <analysis/periodogram.hpp>
+#include <analysis/welch.hpp>
+#include <analysis/multitaper.hpp>
+#include <analysis/burg.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // expected median / mean ratio of chi-square(2) samples, same correction scipy applies for welch medians
+        double median_bias(const size_t count)
+        {
+            double bias = 1.0;
+            for (size_t i = 2; i < count; i += 2)
+            {
+                bias += 1.0 / static_cast<double>(i + 1) - 1.0 / static_cast<double>(i);
+            }
+            return bias;
+        }
+    }
+
+    kfr::univector<double> periodic_hann(const size_t size)
+    {
+        kfr::univector<double> window(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            window[i] = 0.5 - 0.5 * std::cos(2.0 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(size));
+        }
+        return window;
+    }
+
+    SpectralEstimator::SpectralEstimator(const size_t window_size)
+        : m_window_size(window_size),
+          m_reference_energy(0.0),
+          m_power_spectrum(window_size / 2 + 1),
+          m_dft(window_size),
+          m_temp(m_dft.temp_size),
+          m_input(window_size),
+          m_output(window_size)
+    {
+        const kfr::univector<double> hann = periodic_hann(window_size);
+        for (size_t i = 0; i < window_size; ++i)
+        {
+            m_reference_energy += hann[i] * hann[i];
+        }
+    }
+
+    void SpectralEstimator::reserve_batch(const size_t rows)
+    {
+        if (m_batch.size() < rows * m_window_size)
+        {
+            m_batch.resize(rows * m_window_size);
+            m_batch_power.resize(rows * get_bin_count());
+        }
+    }
+
+    void SpectralEstimator::transform_batch(const size_t rows)
+    {
+        const size_t n = m_window_size;
+        const size_t bins = get_bin_count();
+
+        for (size_t row = 0; row < rows; row += 2)
+        {
+            const double* a = m_batch.data() + row * n;
+            const bool paired = row + 1 < rows;
+
+            // pack two real rows as re/im of one complex transform
+            if (paired)
+            {
+                const double* b = a + n;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    m_input[i] = kfr::complex<double>(a[i], b[i]);
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    m_input[i] = kfr::complex<double>(a[i], 0.0);
+                }
+            }
+
+            m_dft.execute(m_output, m_input, m_temp, false);
+
+            double* power_a = m_batch_power.data() + row * bins;
+
+            if (!paired)
+            {
+                for (size_t k = 0; k < bins; ++k)
+                {
+                    power_a[k] = std::norm(m_output[k]);
+                }
+                continue;
+            }
+
+            double* power_b = power_a + bins;
+
+            // A[k] = (Z[k] + conj(Z[n - k])) / 2, B[k] = (Z[k] - conj(Z[n - k])) / 2j
+            for (size_t k = 0; k < bins; ++k)
+            {
+                const auto z = m_output[k];
+                const auto z_mirror = std::conj(m_output[(n - k) % n]);
+
+                power_a[k] = std::norm(z + z_mirror) * 0.25;
+                power_b[k] = std::norm(z - z_mirror) * 0.25;
+            }
+        }
+    }
+
+    void SpectralEstimator::average_batch(
+        const size_t rows,
+        const SpectralAveraging averaging,
+        const std::span<const double> weights,
+        const double scale)
+    {
+        const size_t bins = get_bin_count();
+
+        if (averaging == SpectralAveraging::Median && rows > 2)
+        {
+            m_scratch.resize(rows);
+            const double correction = scale / median_bias(rows);
+
+            for (size_t k = 0; k < bins; ++k)
+            {
+                for (size_t row = 0; row < rows; ++row)
+                {
+                    m_scratch[row] = m_batch_power[row * bins + k];
+                }
+
+                const auto middle = m_scratch.begin() + static_cast<std::ptrdiff_t>(rows / 2);
+                std::nth_element(m_scratch.begin(), middle, m_scratch.begin() + static_cast<std::ptrdiff_t>(rows));
+                double median = *middle;
+
+                if (rows % 2 == 0)
+                {
+                    median = 0.5 * (median + *std::max_element(m_scratch.begin(), middle));
+                }
+
+                m_power_spectrum[k] = median * correction;
+            }
+
+            return;
+        }
+
+        const bool weighted = averaging == SpectralAveraging::EigenvalueWeighted && weights.size() >= rows;
+
+        double weight_sum = 0.0;
+        for (size_t row = 0; row < rows; ++row)
+        {
+            weight_sum += weighted ? weights[row] : 1.0;
+        }
+
+        std::fill(m_power_spectrum.begin(), m_power_spectrum.end(), 0.0);
+
+        for (size_t row = 0; row < rows; ++row)
+        {
+            const double weight = scale * (weighted ? weights[row] : 1.0) / weight_sum;
+            const double* power = m_batch_power.data() + row * bins;
+
+            for (size_t k = 0; k < bins; ++k)
+            {
+                m_power_spectrum[k] += weight * power[k];
+            }
+        }
+    }
+
+    std::unique_ptr<SpectralEstimator> make_spectral_estimator(
+        const size_t window_size,
+        const SpectralOptions& options)
+    {
+        switch (options.method)
+        {
+            case SpectralMethod::Periodogram:
+                return std::make_unique<Periodogram>(window_size);
+            case SpectralMethod::Welch:
+                return std::make_unique<WelchEstimator>(window_size,
+                                                        options.welch_segment_size,
+                                                        options.welch_overlap_percentage,
+                                                        options.averaging);
+            case SpectralMethod::Multitaper:
+                return std::make_unique<MultitaperEstimator>(window_size,
+                                                             options.time_bandwidth,
+                                                             options.taper_count,
+                                                             options.averaging);
+            case SpectralMethod::Burg:
+                return std::make_unique<BurgEstimator>(window_size, options.burg_segment_size, options.ar_order);
+            default:
+                throw std::invalid_argument("Invalid spectral method");
+        }
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <stdexcept>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <analysis/spectrogram_store.hpp>
+
+namespace brainviz::analysis
+{
+    SpectrogramStore::SpectrogramStore(const size_t bin_count, SpectrogramOptions options)
+        : m_bin_count(bin_count),
+          m_options(std::move(options))
+    {
+        if (!(m_options.log_ceiling > m_options.log_floor))
+        {
+            throw std::invalid_argument(fmt::format("Invalid spectrogram log range: {} to {}",
+                                                    m_options.log_floor, m_options.log_ceiling));
+        }
+
+        // code 0 is reserved for "below the floor"
+        m_code_scale = 65534.0 / (m_options.log_ceiling - m_options.log_floor);
+    }
+
+    void SpectrogramStore::reserve(const size_t channels, const size_t frames)
+    {
+        if (channels <= m_frame_counts.size() && frames <= m_frame_capacity)
+        {
+            return;
+        }
+
+        const size_t new_channels = std::max(channels, m_frame_counts.size());
+        const size_t new_capacity = std::max(frames, m_frame_capacity);
+
+        // each mapping gets its own scratch file, the old one is removed when it is released below
+        std::filesystem::path backing_file;
+        if (!m_options.backing_file.empty())
+        {
+            static std::atomic<size_t> generation = 0;
+            backing_file = m_options.backing_file;
+            backing_file += fmt::format(".{}", generation++);
+        }
+
+        utils::MappedBuffer buffer(new_channels * new_capacity * m_bin_count * element_size(), backing_file);
+
+        const size_t old_block = m_frame_capacity * m_bin_count * element_size();
+        const size_t new_block = new_capacity * m_bin_count * element_size();
+
+        for (size_t channel = 0; channel < m_frame_counts.size(); ++channel)
+        {
+            std::memcpy(buffer.data() + channel * new_block,
+                        m_buffer.data() + channel * old_block,
+                        m_frame_counts[channel] * m_bin_count * element_size());
+        }
+
+        m_buffer = std::move(buffer);
+        m_frame_capacity = new_capacity;
+        m_frame_counts.resize(new_channels, 0);
+    }
+
+    void SpectrogramStore::set_frame_count(const ChannelHandle channel, const size_t frames)
+    {
+        if (channel >= m_frame_counts.size() || frames > m_frame_capacity)
+        {
+            throw std::out_of_range(fmt::format("Spectrogram has no room for {} frames of channel handle {}",
+                                                frames, channel));
+        }
+
+        m_frame_counts[channel] = frames;
+    }
+
+    void SpectrogramStore::write_frame(
+        const ChannelHandle channel,
+        const size_t frame,
+        const std::span<const double> power)
+    {
+        const size_t bins = std::min(power.size(), m_bin_count);
+        const size_t start = offset(channel, frame);
+
+        if (m_options.format == SpectrogramFormat::Float32)
+        {
+            auto* out = reinterpret_cast<float*>(m_buffer.data()) + start;
+            for (size_t k = 0; k < bins; ++k)
+            {
+                out[k] = static_cast<float>(power[k]);
+            }
+            return;
+        }
+
+        auto* out = reinterpret_cast<std::uint16_t*>(m_buffer.data()) + start;
+        for (size_t k = 0; k < bins; ++k)
+        {
+            const double level = power[k] > 0.0 ? std::log10(power[k]) : m_options.log_floor;
+            const double code = std::round((level - m_options.log_floor) * m_code_scale) + 1.0;
+
+            out[k] = level <= m_options.log_floor ? 0 : static_cast<std::uint16_t>(std::clamp(code, 1.0, 65535.0));
+        }
+    }
+
+    template <typename T>
+    void SpectrogramStore::decode(
+        const ChannelHandle channel,
+        const size_t frame,
+        const std::span<T> out,
+        const size_t first_bin) const
+    {
+        if (channel >= m_frame_counts.size() || frame >= m_frame_counts[channel] ||
+            first_bin + out.size() > m_bin_count)
+        {
+            throw std::out_of_range(fmt::format("Spectrogram frame {} of channel handle {} out of range",
+                                                frame, channel));
+        }
+
+        const size_t start = offset(channel, frame) + first_bin;
+
+        if (m_options.format == SpectrogramFormat::Float32)
+        {
+            const auto* in = reinterpret_cast<const float*>(m_buffer.data()) + start;
+            std::copy_n(in, out.size(), out.begin());
+            return;
+        }
+
+        const auto* in = reinterpret_cast<const std::uint16_t*>(m_buffer.data()) + start;
+        const double step = std::numbers::ln10 / m_code_scale;
+        const double base = std::numbers::ln10 * m_options.log_floor - step;
+
+        for (size_t k = 0; k < out.size(); ++k)
+        {
+            out[k] = in[k] == 0 ? T{0} : static_cast<T>(std::exp(base + step * in[k]));
+        }
+    }
+
+    void SpectrogramStore::read_frame(
+        const ChannelHandle channel,
+        const size_t frame,
+        const std::span<double> out,
+        const size_t first_bin) const
+    {
+        decode(channel, frame, out, first_bin);
+    }
+
+    void SpectrogramStore::read_frame(
+        const ChannelHandle channel,
+        const size_t frame,
+        const std::span<float> out,
+        const size_t first_bin) const
+    {
+        decode(channel, frame, out, first_bin);
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <iterator>
+#include <numbers>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <utils/parallel.hpp>
+#include <analysis/frequency_analyzer.hpp>
+#include <analysis/statistics.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // statistics of each series, its chunks summarized in parallel and merged in order
+        std::vector<SummaryStatistics> summarize(
+            const std::vector<std::span<const double> >& series,
+            const double compression)
+        {
+            struct Chunk
+            {
+                size_t series;
+                size_t begin;
+                size_t end;
+            };
+
+            std::vector<Chunk> chunks;
+            for (size_t i = 0; i < series.size(); ++i)
+            {
+                for (size_t begin = 0; begin < series[i].size(); begin += ChannelStatistics::CHUNK_SIZE)
+                {
+                    chunks.push_back({i, begin, std::min(begin + ChannelStatistics::CHUNK_SIZE, series[i].size())});
+                }
+            }
+
+            std::vector<SummaryStatistics> partials(chunks.size(), {{}, QuantileSketch(compression)});
+
+            utils::parallel_for(chunks.size(), [&](const size_t begin, const size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    const auto& chunk = chunks[i];
+
+                    partials[i].push(series[chunk.series].subspan(chunk.begin, chunk.end - chunk.begin));
+                    partials[i].quantiles.flush();
+                }
+            });
+
+            std::vector<SummaryStatistics> result(series.size(), {{}, QuantileSketch(compression)});
+            for (size_t i = 0; i < chunks.size(); ++i)
+            {
+                result[chunks[i].series].merge(partials[i]);
+            }
+
+            for (auto& summary : result)
+            {
+                summary.quantiles.flush();
+            }
+
+            return result;
+        }
+    }
+
+    void RunningStats::push(const std::span<const double> values)
+    {
+        for (const double value : values)
+        {
+            push(value);
+        }
+    }
+
+    void RunningStats::merge(const RunningStats& other)
+    {
+        if (other.m_count == 0)
+        {
+            return;
+        }
+
+        if (m_count == 0)
+        {
+            *this = other;
+            return;
+        }
+
+        const auto count = static_cast<double>(m_count);
+        const auto other_count = static_cast<double>(other.m_count);
+        const double total = count + other_count;
+        const double delta = other.m_mean - m_mean;
+
+        m_mean += delta * other_count / total;
+        m_m2 += other.m_m2 + delta * delta * count * other_count / total;
+        m_count += other.m_count;
+
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    QuantileSketch::QuantileSketch(const double compression)
+        : m_compression(std::max(compression, 10.0))
+    {
+    }
+
+    size_t QuantileSketch::buffer_limit() const
+    {
+        // many times the centroid count, so each flush mostly sorts new values instead of re-merging centroids
+        return static_cast<size_t>(20.0 * m_compression);
+    }
+
+    void QuantileSketch::push(const double value)
+    {
+        m_buffer.push_back({value, 1.0});
+        m_buffer_weight += 1.0;
+
+        m_min = std::min(m_min, value);
+        m_max = std::max(m_max, value);
+
+        if (m_buffer.size() >= buffer_limit())
+        {
+            flush();
+        }
+    }
+
+    void QuantileSketch::push(const std::span<const double> values)
+    {
+        for (const double value : values)
+        {
+            push(value);
+        }
+    }
+
+    void QuantileSketch::merge(const QuantileSketch& other)
+    {
+        if (other.get_total_weight() == 0.0)
+        {
+            return;
+        }
+
+        m_buffer.insert(m_buffer.end(), other.m_centroids.begin(), other.m_centroids.end());
+        m_buffer.insert(m_buffer.end(), other.m_buffer.begin(), other.m_buffer.end());
+        m_buffer_weight += other.get_total_weight();
+
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+
+        if (m_buffer.size() >= buffer_limit())
+        {
+            flush();
+        }
+    }
+
+    void QuantileSketch::flush()
+    {
+        if (m_buffer.empty())
+        {
+            return;
+        }
+
+        const auto by_mean = [](const Centroid& a, const Centroid& b) {
+            return a.mean < b.mean;
+        };
+
+        std::ranges::sort(m_buffer, by_mean);
+
+        std::vector<Centroid> merged;
+        merged.reserve(m_centroids.size() + m_buffer.size());
+        std::ranges::merge(m_centroids, m_buffer, std::back_inserter(merged), by_mean);
+
+        m_merged_weight += m_buffer_weight;
+        compress(merged, m_merged_weight, m_compression);
+
+        m_centroids = std::move(merged);
+        m_buffer.clear();
+        m_buffer_weight = 0.0;
+    }
+
+    void QuantileSketch::compress(std::vector<Centroid>& centroids, const double total_weight, const double compression)
+    {
+        if (centroids.size() <= 1)
+        {
+            return;
+        }
+
+        // k1 scale, a centroid may span at most one unit of k. the weight a centroid may grow to is worked out
+        // once per centroid written instead of evaluating the scale for every candidate
+        const double scale = compression / (2.0 * std::numbers::pi);
+        const auto weight_limit = [&](const double weight_before) {
+            const double k = scale * std::asin(std::clamp(2.0 * weight_before / total_weight - 1.0, -1.0, 1.0));
+            return total_weight * (std::sin(std::min((k + 1.0) / scale, std::numbers::pi / 2.0)) + 1.0) / 2.0;
+        };
+
+        size_t count = 0;
+        double weight_before = 0.0; // of the centroids already written
+        double limit = weight_limit(weight_before);
+
+        Centroid current = centroids[0];
+        for (size_t i = 1; i < centroids.size(); ++i)
+        {
+            const Centroid& next = centroids[i];
+            const double proposed = current.weight + next.weight;
+
+            if (weight_before + proposed <= limit)
+            {
+                current.mean += (next.mean - current.mean) * next.weight / proposed;
+                current.weight = proposed;
+                continue;
+            }
+
+            weight_before += current.weight;
+            limit = weight_limit(weight_before);
+
+            centroids[count++] = current;
+            current = next;
+        }
+
+        centroids[count++] = current;
+        centroids.resize(count);
+    }
+
+    double QuantileSketch::quantile(const double q) const
+    {
+        if (get_total_weight() == 0.0)
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        if (!m_buffer.empty())
+        {
+            QuantileSketch flushed = *this;
+            flushed.flush();
+            return flushed.quantile(q);
+        }
+
+        const double target = std::clamp(q, 0.0, 1.0) * m_merged_weight;
+
+        // each centroid's mean sits at the middle of its weight, the extremes are exact at both ends
+        const Centroid& first = m_centroids.front();
+        if (target <= first.weight / 2.0)
+        {
+            return m_min + (first.mean - m_min) * target / (first.weight / 2.0);
+        }
+
+        double position = first.weight / 2.0;
+        for (size_t i = 0; i + 1 < m_centroids.size(); ++i)
+        {
+            const double gap = (m_centroids[i].weight + m_centroids[i + 1].weight) / 2.0;
+            if (target <= position + gap)
+            {
+                const double t = (target - position) / gap;
+                return m_centroids[i].mean + t * (m_centroids[i + 1].mean - m_centroids[i].mean);
+            }
+
+            position += gap;
+        }
+
+        const Centroid& last = m_centroids.back();
+        const double t = std::min((target - position) / (last.weight / 2.0), 1.0);
+        return last.mean + t * (m_max - last.mean);
+    }
+
+    ChannelStatistics::ChannelStatistics(const double compression)
+        : m_compression(compression)
+    {
+    }
+
+    void ChannelStatistics::add_samples(const data::EEGData& eeg_data)
+    {
+        const auto channel_names = eeg_data.get_channel_names();
+
+        std::vector<std::span<const double> > series;
+        for (const auto& channel_name : channel_names)
+        {
+            series.emplace_back(eeg_data.get_channel(channel_name));
+        }
+
+        const auto summaries = summarize(series, m_compression);
+        for (size_t i = 0; i < channel_names.size(); ++i)
+        {
+            auto& entry = m_channels.try_emplace(channel_names[i], SummaryStatistics{{}, QuantileSketch(m_compression)})
+                                    .first.value();
+            entry.merge(summaries[i]);
+            entry.quantiles.flush();
+        }
+    }
+
+    void ChannelStatistics::add_samples(const std::string_view channel_name, const std::span<const double> samples)
+    {
+        const auto summaries = summarize({samples}, m_compression);
+
+        auto& entry = m_channels.try_emplace(std::string(channel_name), SummaryStatistics{{}, QuantileSketch(m_compression)})
+                                .first.value();
+        entry.merge(summaries[0]);
+        entry.quantiles.flush();
+    }
+
+    void ChannelStatistics::add_bands(
+        const FrequencyAnalyzer& analyzer,
+        const size_t first_frame,
+        const size_t frame_count)
+    {
+        const size_t bands = analyzer.get_band_count();
+
+        for (ChannelHandle channel = 0; channel < analyzer.get_channel_count(); ++channel)
+        {
+            auto& entry = m_bands.try_emplace(analyzer.get_channel_name(channel)).first.value();
+            if (entry.empty())
+            {
+                entry.assign(bands, SummaryStatistics{{}, QuantileSketch(m_compression)});
+            }
+            else if (entry.size() != bands)
+            {
+                throw std::invalid_argument(fmt::format(
+                    "Band statistics of {} hold {} bands, the analyzer has {}",
+                    analyzer.get_channel_name(channel), entry.size(), bands));
+            }
+        }
+
+        // once every entry exists the map doesnt move anymore, the workers only touch their own channel's vector
+        std::vector<std::vector<SummaryStatistics>*> entries;
+        for (ChannelHandle channel = 0; channel < analyzer.get_channel_count(); ++channel)
+        {
+            entries.push_back(&m_bands.find(analyzer.get_channel_name(channel)).value());
+        }
+
+        utils::parallel_for(entries.size(), [&](const size_t begin, const size_t end) {
+            for (ChannelHandle channel = begin; channel < end; ++channel)
+            {
+                auto& entry = *entries[channel];
+
+                const size_t frames = analyzer.get_frame_count(channel);
+                const size_t last_frame = first_frame + std::min(frame_count, frames - std::min(first_frame, frames));
+
+                for (size_t frame = first_frame; frame < last_frame; ++frame)
+                {
+                    if (analyzer.is_artifact(channel, frame) || !analyzer.is_frame_ready(frame))
+                    {
+                        continue;
+                    }
+
+                    const auto amplitudes = analyzer.get_frame(channel, frame);
+                    for (size_t band = 0; band < bands; ++band)
+                    {
+                        entry[band].moments.push(amplitudes[band]);
+                        entry[band].quantiles.push(amplitudes[band]);
+                    }
+                }
+
+                for (auto& summary : entry)
+                {
+                    summary.quantiles.flush();
+                }
+            }
+        });
+    }
+
+    bool ChannelStatistics::has_channel(const std::string_view channel_name) const
+    {
+        return m_channels.contains(std::string(channel_name));
+    }
+
+    const SummaryStatistics& ChannelStatistics::get_channel(const std::string_view channel_name) const
+    {
+        const auto it = m_channels.find(std::string(channel_name));
+        if (it == m_channels.end())
+        {
+            throw std::runtime_error(fmt::format("No sample statistics for channel: {}", channel_name));
+        }
+
+        return it->second;
+    }
+
+    const SummaryStatistics& ChannelStatistics::get_band(
+        const std::string_view channel_name,
+        const size_t band_index) const
+    {
+        const auto it = m_bands.find(std::string(channel_name));
+        if (it == m_bands.end())
+        {
+            throw std::runtime_error(fmt::format("No band statistics for channel: {}", channel_name));
+        }
+
+        if (band_index >= it->second.size())
+        {
+            throw std::out_of_range(fmt::format("Band index {} out of range", band_index));
+        }
+
+        return it->second[band_index];
+    }
+
+    void ChannelStatistics::clear()
+    {
+        m_channels.clear();
+        m_bands.clear();
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <analysis/streaming_analyzer.hpp>
+
+namespace brainviz::analysis
+{
+    StreamingAnalyzer::StreamingAnalyzer(
+        const double sampling_rate,
+        const size_t window_size,
+        const double overlap_percentage,
+        const size_t history_frames,
+        const BandPowerEngine engine)
+        : FrequencyAnalyzer(sampling_rate, window_size, overlap_percentage),
+          m_history_frames(std::max<size_t>(history_frames, 1)),
+          m_trim_slack(std::max<size_t>(m_history_frames / 4, 1)),
+          m_engine(engine),
+          m_estimator(make_spectral_estimator(m_window_size, m_spectral_options)),
+          m_variance_scale(variance_to_band_power())
+    {
+        m_history.m_samplingRate = sampling_rate;
+        build_engine();
+    }
+
+    void StreamingAnalyzer::build_engine()
+    {
+        // a filter bank cant be designed for a zero width band, the other engines dont need one
+        m_sliding_dft = m_engine == BandPowerEngine::SlidingDft ? SlidingDftBank(m_band_table, m_window_size)
+                                                                : SlidingDftBank();
+        m_filter_bank = m_engine == BandPowerEngine::FilterBank ? IirFilterBank(m_sampling_rate, m_bands)
+                                                                : IirFilterBank();
+    }
+
+    void StreamingAnalyzer::set_spectral_options(const SpectralOptions& options)
+    {
+        FrequencyAnalyzer::set_spectral_options(options);
+        m_estimator = make_spectral_estimator(m_window_size, m_spectral_options);
+    }
+
+    void StreamingAnalyzer::set_band_set(BandSet bands)
+    {
+        if (!m_channels.empty())
+        {
+            throw std::logic_error("Band set cannot change once samples have been pushed");
+        }
+
+        FrequencyAnalyzer::set_band_set(std::move(bands));
+        build_engine();
+    }
+
+    ChannelHandle StreamingAnalyzer::get_or_add_channel(const std::string& name)
+    {
+        const ChannelHandle channel = add_channel_results(name);
+        if (channel < m_channels.size())
+        {
+            return channel;
+        }
+
+        m_history.set_channel(name, {});
+
+        ChannelState state;
+        if (m_engine == BandPowerEngine::SlidingDft)
+        {
+            state.slot = m_sliding_dft.add_channel();
+            m_slot_samples.resize(m_sliding_dft.get_channel_count());
+        }
+        else if (m_engine == BandPowerEngine::FilterBank)
+        {
+            state.slot = m_filter_bank.add_channel();
+            m_slot_samples.resize(m_filter_bank.get_channel_count());
+            m_envelope.resize(m_filter_bank.get_channel_count() * get_band_count() * m_window_size, 0.0);
+        }
+
+        m_channels.push_back(state);
+        return channel;
+    }
+
+    void StreamingAnalyzer::enable_preprocessing(const PreprocessingOptions options)
+    {
+        m_preprocessor.emplace(m_sampling_rate, options);
+    }
+
+    void StreamingAnalyzer::disable_preprocessing()
+    {
+        m_preprocessor.reset();
+    }
+
+    size_t StreamingAnalyzer::push_block(const data::EEGData& block)
+    {
+        if (!m_preprocessor)
+        {
+            return analyze_block(block);
+        }
+
+        data::EEGData cleaned = block;
+        m_preprocessor->process_block(cleaned);
+
+        return analyze_block(cleaned);
+    }
+
+    size_t StreamingAnalyzer::push_samples(const std::string_view channel_name, const std::span<const double> samples)
+    {
+        if (!m_preprocessor)
+        {
+            return analyze_samples(channel_name, samples);
+        }
+
+        if (m_preprocessor->get_options().reference != Reference::None)
+        {
+            throw std::logic_error("Re-referencing needs every channel in one block, push them with push_block");
+        }
+
+        data::EEGData cleaned;
+        cleaned.m_samplingRate = m_sampling_rate;
+        cleaned.set_channel(channel_name, {samples.begin(), samples.end()});
+        m_preprocessor->process_block(cleaned);
+
+        return analyze_samples(channel_name, cleaned.get_channel(channel_name));
+    }
+
+    size_t StreamingAnalyzer::analyze_block(const data::EEGData& block)
+    {
+        // new frames and trimming make a baked table stale
+        m_visualization_table = {};
+
+        const auto& block_channels = block.get_channels();
+
+        for (const auto& [channel_name, _] : block_channels)
+        {
+            get_or_add_channel(channel_name);
+        }
+
+        // the recursive banks can step every channel at once when the block covers all of them in lockstep
+        const size_t block_length = block_channels.empty() ? 0 : block_channels.begin()->second.size();
+        const bool lockstep = m_engine != BandPowerEngine::Fft &&
+                              block_channels.size() == m_channels.size() &&
+                              std::all_of(block_channels.begin(), block_channels.end(),
+                                          [block_length] (const auto& channel) {
+                                              return channel.second.size() == block_length;
+                                          });
+
+        if (!lockstep)
+        {
+            size_t new_frames = 0;
+
+            for (const auto& [channel_name, samples] : block_channels)
+            {
+                new_frames = std::max(new_frames, analyze_samples(channel_name, samples));
+            }
+
+            return new_frames;
+        }
+
+        // resolve the slots once so the per sample loop doesnt hash channel names
+        std::vector<std::pair<const double*, size_t> > columns;
+        columns.reserve(block_channels.size());
+
+        std::vector<const std::vector<double>*> histories(m_channels.size());
+        std::vector<size_t> first_new_frames(m_channels.size());
+
+        for (const auto& [channel_name, samples] : block_channels)
+        {
+            auto& raw_data = m_history.get_channel(channel_name);
+            raw_data.insert(raw_data.end(), samples.begin(), samples.end());
+
+            const ChannelHandle channel = get_channel_handle(channel_name);
+            columns.emplace_back(samples.data(), m_channels[channel].slot);
+            histories[channel] = &raw_data;
+            first_new_frames[channel] = m_results.get_frame_count(channel);
+        }
+
+        size_t new_frames = 0;
+
+        for (size_t t = 0; t < block_length; ++t)
+        {
+            for (const auto& [samples, slot] : columns)
+            {
+                m_slot_samples[slot] = samples[t];
+            }
+
+            push_bank();
+
+            size_t frames_this_sample = 0;
+            for (ChannelHandle channel = 0; channel < m_channels.size(); ++channel)
+            {
+                if (m_engine == BandPowerEngine::FilterBank)
+                {
+                    record_envelope(channel);
+                }
+
+                ++m_channels[channel].fed;
+                frames_this_sample = std::max<size_t>(frames_this_sample, emit_bank_frame_if_ready(channel));
+            }
+            new_frames += frames_this_sample;
+        }
+
+        for (ChannelHandle channel = 0; channel < m_channels.size(); ++channel)
+        {
+            detect_new_artifacts(channel, *histories[channel], first_new_frames[channel]);
+            finish_push(channel, m_history.get_channel(get_channel_name(channel)));
+        }
+
+        return new_frames;
+    }
+
+    size_t StreamingAnalyzer::analyze_samples(
+        const std::string_view channel_name,
+        const std::span<const double> samples)
+    {
+        m_visualization_table = {};
+
+        const std::string name(channel_name);
+
+        const ChannelHandle channel = get_or_add_channel(name);
+        auto& raw_data = m_history.get_channel(name);
+        raw_data.insert(raw_data.end(), samples.begin(), samples.end());
+
+        const size_t first_new_frame = m_results.get_frame_count(channel);
+
+        const size_t new_frames = (m_engine == BandPowerEngine::Fft)
+                                      ? emit_fft_frames(channel, raw_data)
+                                      : emit_bank_frames(channel, raw_data);
+
+        detect_new_artifacts(channel, raw_data, first_new_frame);
+        finish_push(channel, raw_data);
+
+        return new_frames;
+    }
+
+    size_t StreamingAnalyzer::emit_fft_frames(const ChannelHandle channel, const std::vector<double>& samples)
+    {
+        auto& state = m_channels[channel];
+        size_t new_frames = 0;
+
+        while (state.next_frame_start + m_window_size <= samples.size())
+        {
+            const auto& power_spectrum = m_estimator->compute(
+                std::span(samples).subspan(state.next_frame_start, m_window_size));
+
+            m_band_table.reduce(power_spectrum, m_results.append_frame(channel));
+
+            state.next_frame_start += m_hop_size;
+            ++new_frames;
+        }
+
+        return new_frames;
+    }
+
+    size_t StreamingAnalyzer::emit_bank_frames(const ChannelHandle channel, const std::vector<double>& samples)
+    {
+        auto& state = m_channels[channel];
+        size_t new_frames = 0;
+
+        while (state.fed < samples.size())
+        {
+            push_bank_channel(channel, samples[state.fed]);
+            ++state.fed;
+
+            new_frames += emit_bank_frame_if_ready(channel);
+        }
+
+        return new_frames;
+    }
+
+    void StreamingAnalyzer::push_bank()
+    {
+        if (m_engine == BandPowerEngine::SlidingDft)
+        {
+            m_sliding_dft.push(m_slot_samples);
+        }
+        else
+        {
+            m_filter_bank.push(m_slot_samples);
+        }
+    }
+
+    void StreamingAnalyzer::push_bank_channel(const ChannelHandle channel, const double sample)
+    {
+        const size_t slot = m_channels[channel].slot;
+
+        if (m_engine == BandPowerEngine::SlidingDft)
+        {
+            m_sliding_dft.push_channel(slot, sample);
+            return;
+        }
+
+        m_filter_bank.push_channel(slot, sample);
+        record_envelope(channel);
+    }
+
+    void StreamingAnalyzer::record_envelope(const ChannelHandle channel)
+    {
+        auto& state = m_channels[channel];
+        const size_t band_count = get_band_count();
+        double* ring = m_envelope.data() + state.slot * band_count * m_window_size;
+
+        for (size_t band = 0; band < band_count; ++band)
+        {
+            const double output = m_filter_bank.get_output(band, state.slot);
+            ring[band * m_window_size + state.envelope_pos] = output * output;
+        }
+
+        state.envelope_pos = (state.envelope_pos + 1 == m_window_size) ? 0 : state.envelope_pos + 1;
+    }
+
+    bool StreamingAnalyzer::emit_bank_frame_if_ready(const ChannelHandle channel)
+    {
+        auto& state = m_channels[channel];
+        if (state.fed != state.next_frame_start + m_window_size)
+        {
+            return false;
+        }
+
+        const auto amplitudes = m_results.append_frame(channel);
+
+        if (m_engine == BandPowerEngine::SlidingDft)
+        {
+            m_sliding_dft.band_amplitudes(state.slot, amplitudes);
+        }
+        else
+        {
+            // the ring holds exactly the frame's window, summed fresh so nothing drifts
+            const double* ring = m_envelope.data() + state.slot * amplitudes.size() * m_window_size;
+
+            for (size_t band = 0; band < amplitudes.size(); ++band)
+            {
+                double sum = 0.0;
+                for (size_t i = 0; i < m_window_size; ++i)
+                {
+                    sum += ring[band * m_window_size + i];
+                }
+
+                amplitudes[band] = std::sqrt(sum / static_cast<double>(m_window_size) * m_variance_scale);
+            }
+        }
+
+        state.next_frame_start += m_hop_size;
+        return true;
+    }
+
+    void StreamingAnalyzer::detect_new_artifacts(
+        const ChannelHandle channel,
+        const std::vector<double>& samples,
+        const size_t first_new_frame)
+    {
+        const size_t frames = m_results.get_frame_count(channel);
+        if (frames > first_new_frame)
+        {
+            detect_artifacts(channel, std::span(samples).subspan(first_new_frame * m_hop_size), first_new_frame,
+                             frames - first_new_frame);
+        }
+    }
+
+    void StreamingAnalyzer::finish_push(const ChannelHandle channel, std::vector<double>& samples)
+    {
+        if (m_results.get_frame_count(channel) > m_history_frames + m_trim_slack)
+        {
+            trim_history(channel, samples);
+        }
+    }
+
+    void StreamingAnalyzer::trim_history(const ChannelHandle channel, std::vector<double>& samples)
+    {
+        auto& state = m_channels[channel];
+        const size_t excess = m_results.get_frame_count(channel) - m_history_frames;
+
+        m_results.drop_front(channel, excess);
+
+        auto& mask = m_artifact_masks[channel];
+        mask.erase(mask.begin(), mask.begin() + static_cast<std::ptrdiff_t>(std::min(excess, mask.size())));
+
+        // keep the samples from the start of the oldest retained frame onwards
+        const size_t excess_samples = excess * m_hop_size;
+        samples.erase(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(excess_samples));
+
+        state.next_frame_start -= excess_samples;
+        state.fed -= std::min(state.fed, excess_samples);
+        state.dropped_frames += excess;
+    }
+
+    size_t StreamingAnalyzer::get_dropped_frames(const std::string_view channel_name) const
+    {
+        const auto channel = find_channel(channel_name);
+        if (!channel)
+        {
+            throw std::runtime_error(fmt::format("Channel not streamed: {}", channel_name));
+        }
+
+        return m_channels[*channel].dropped_frames;
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <optional>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <logging/logger.hpp>
+#include <utils/parallel.hpp>
+#include <analysis/topographic_map.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        // head pixels per task, a chunk's accumulator stays in L1 while every channel column streams through
+        constexpr size_t PIXEL_CHUNK = 2048;
+
+        // kernel samples over cosines in [-1, 1], linearly interpolated for the pixel weights
+        constexpr size_t KERNEL_TABLE_SIZE = 1 << 14;
+
+        struct UnitVector
+        {
+            double x, y, z;
+        };
+
+        UnitVector to_unit_vector(const electrode::Electrode& electrode)
+        {
+            return {electrode.getX(1.0), electrode.getY(1.0), electrode.getZ(1.0)};
+        }
+
+        // g(x) = 1 / 4pi sum (2n + 1) / (n (n + 1))^m P_n(x), legendre polynomials by their recurrence
+        double spline_kernel(const double cosine, const std::span<const double> factors)
+        {
+            const double x = std::clamp(cosine, -1.0, 1.0);
+
+            double previous = 1.0; // P_0
+            double current = x; // P_1
+            double sum = factors[1] * current;
+
+            for (size_t n = 2; n < factors.size(); ++n)
+            {
+                const auto order = static_cast<double>(n);
+                const double next = ((2.0 * order - 1.0) * x * current - (order - 1.0) * previous) / order;
+                previous = current;
+                current = next;
+                sum += factors[n] * current;
+            }
+
+            return sum;
+        }
+
+        class KernelTable
+        {
+        public:
+            explicit KernelTable(const std::span<const double> factors)
+                : m_values(KERNEL_TABLE_SIZE + 1)
+            {
+                for (size_t i = 0; i <= KERNEL_TABLE_SIZE; ++i)
+                {
+                    m_values[i] = spline_kernel(2.0 * static_cast<double>(i) / KERNEL_TABLE_SIZE - 1.0, factors);
+                }
+            }
+
+            [[nodiscard]] double operator()(const double cosine) const
+            {
+                const double position = (std::clamp(cosine, -1.0, 1.0) + 1.0) * 0.5 * KERNEL_TABLE_SIZE;
+                const size_t i = std::min(static_cast<size_t>(position), KERNEL_TABLE_SIZE - 1);
+                const double t = position - static_cast<double>(i);
+                return m_values[i] + t * (m_values[i + 1] - m_values[i]);
+            }
+
+        private:
+            std::vector<double> m_values;
+        };
+
+        // solve a x = b in place by gaussian elimination with partial pivoting, a is n x n row major, b n x m
+        void solve(std::vector<double>& a, std::vector<double>& b, const size_t n, const size_t m)
+        {
+            for (size_t column = 0; column < n; ++column)
+            {
+                size_t pivot = column;
+                for (size_t row = column + 1; row < n; ++row)
+                {
+                    if (std::abs(a[row * n + column]) > std::abs(a[pivot * n + column]))
+                    {
+                        pivot = row;
+                    }
+                }
+
+                if (a[pivot * n + column] == 0.0)
+                {
+                    throw std::runtime_error("Spherical spline system is singular, electrode positions repeat");
+                }
+
+                if (pivot != column)
+                {
+                    std::swap_ranges(a.begin() + pivot * n, a.begin() + (pivot + 1) * n, a.begin() + column * n);
+                    std::swap_ranges(b.begin() + pivot * m, b.begin() + (pivot + 1) * m, b.begin() + column * m);
+                }
+
+                for (size_t row = column + 1; row < n; ++row)
+                {
+                    const double factor = a[row * n + column] / a[column * n + column];
+                    if (factor == 0.0)
+                    {
+                        continue;
+                    }
+
+                    for (size_t k = column; k < n; ++k)
+                    {
+                        a[row * n + k] -= factor * a[column * n + k];
+                    }
+                    for (size_t k = 0; k < m; ++k)
+                    {
+                        b[row * m + k] -= factor * b[column * m + k];
+                    }
+                }
+            }
+
+            for (size_t column = n; column-- > 0;)
+            {
+                for (size_t k = 0; k < m; ++k)
+                {
+                    double value = b[column * m + k];
+                    for (size_t j = column + 1; j < n; ++j)
+                    {
+                        value -= a[column * n + j] * b[j * m + k];
+                    }
+                    b[column * m + k] = value / a[column * n + column];
+                }
+            }
+        }
+    }
+
+    TopographicMap::TopographicMap(
+        const std::span<const electrode::Electrode> electrodes,
+        const size_t width,
+        const size_t height,
+        const TopographyOptions options)
+        : m_width(width),
+          m_height(height),
+          m_channels(electrodes.size())
+    {
+        if (m_channels == 0 || width == 0 || height == 0)
+        {
+            throw std::invalid_argument(fmt::format("Invalid topographic map: {} electrodes onto {}x{}", m_channels,
+                                                    width, height));
+        }
+
+        if (!(options.rim_radius >= 1.0))
+        {
+            throw std::invalid_argument(fmt::format("Invalid topographic map rim radius {}", options.rim_radius));
+        }
+
+        const size_t c = m_channels;
+
+        std::vector<double> factors(std::max<size_t>(options.legendre_terms, 1) + 1, 0.0);
+        for (size_t n = 1; n < factors.size(); ++n)
+        {
+            const auto order = static_cast<double>(n);
+            factors[n] = (2.0 * order + 1.0) /
+                         (std::pow(order * (order + 1.0), static_cast<double>(options.spline_order)) * 4.0 *
+                          std::numbers::pi);
+        }
+
+        std::vector<UnitVector> positions;
+        for (const auto& electrode : electrodes)
+        {
+            positions.push_back(to_unit_vector(electrode));
+        }
+
+        // [G + lambda I, 1; 1^T, 0] [weights; constant] = [values; 0], solved for the identity so the inverse's
+        // first c columns map channel values to spline weights
+        const size_t n = c + 1;
+        std::vector<double> system(n * n, 0.0);
+        std::vector<double> inverse(n * c, 0.0);
+
+        for (size_t i = 0; i < c; ++i)
+        {
+            for (size_t j = 0; j < c; ++j)
+            {
+                const double cosine = positions[i].x * positions[j].x + positions[i].y * positions[j].y +
+                                      positions[i].z * positions[j].z;
+                system[i * n + j] = spline_kernel(cosine, factors) + (i == j ? options.regularization : 0.0);
+            }
+
+            system[i * n + c] = 1.0;
+            system[c * n + i] = 1.0;
+            inverse[i * c + i] = 1.0;
+        }
+
+        solve(system, inverse, n, c);
+
+        // lowest electrode, the head circle is unfolded down to it
+        double edge_inclination = 90.0;
+        for (const auto& electrode : electrodes)
+        {
+            edge_inclination = std::max(edge_inclination, std::abs(electrode.inclination()));
+        }
+
+        const double rim = options.rim_radius;
+
+        // point on the sphere under a pixel centre, cells of the [-rim, rim] square: orthographic inside the unit
+        // disk, the ring out to rim goes linearly from the equator down to edge_inclination
+        const auto pixel_position = [&](const size_t index) -> std::optional<UnitVector> {
+            const double u = rim * ((2.0 * (static_cast<double>(index % width) + 0.5) / static_cast<double>(width)) - 1.0);
+            const double v = rim * (1.0 - (2.0 * (static_cast<double>(index / width) + 0.5) / static_cast<double>(height)));
+            const double radius = std::sqrt(u * u + v * v);
+
+            if (radius <= 1.0)
+            {
+                return UnitVector{u, v, std::sqrt(std::max(0.0, 1.0 - radius * radius))};
+            }
+            if (radius > rim)
+            {
+                return std::nullopt;
+            }
+
+            const double inclination = (90.0 + (radius - 1.0) / (rim - 1.0) * (edge_inclination - 90.0)) *
+                                       std::numbers::pi / 180.0;
+            const double scale = std::sin(inclination) / radius;
+
+            return UnitVector{u * scale, v * scale, std::cos(inclination)};
+        };
+
+        m_mask.assign(width * height, 0);
+        for (size_t index = 0; index < width * height; ++index)
+        {
+            if (pixel_position(index))
+            {
+                m_mask[index] = 1;
+                m_pixels.push_back(index);
+            }
+        }
+
+        const size_t pixels = m_pixels.size();
+        const KernelTable kernel_table(factors);
+        m_weights.assign(c * pixels, 0.0f);
+
+        // pixel weight of channel j = sum_i g(pixel, i) inverse[i][j] + inverse[c][j]
+        utils::parallel_for(pixels, [&](const size_t begin, const size_t end) {
+            std::vector<double> kernel(c);
+            std::vector<double> weights(c);
+
+            for (size_t p = begin; p < end; ++p)
+            {
+                const UnitVector pixel = *pixel_position(m_pixels[p]);
+
+                for (size_t i = 0; i < c; ++i)
+                {
+                    kernel[i] = kernel_table(pixel.x * positions[i].x + pixel.y * positions[i].y +
+                                             pixel.z * positions[i].z);
+                }
+
+                std::copy_n(inverse.begin() + c * c, c, weights.begin());
+                for (size_t i = 0; i < c; ++i)
+                {
+                    const double* row = inverse.data() + i * c;
+                    for (size_t j = 0; j < c; ++j)
+                    {
+                        weights[j] += kernel[i] * row[j];
+                    }
+                }
+
+                for (size_t j = 0; j < c; ++j)
+                {
+                    m_weights[j * pixels + p] = static_cast<float>(weights[j]);
+                }
+            }
+        }, 256);
+
+        g_logger.debug("Built spherical spline map for {} electrodes onto {}x{} ({} head pixels)", c, width, height,
+                       pixels);
+    }
+
+    void TopographicMap::interpolate(const std::span<const float> values, const std::span<float> image) const
+    {
+        if (values.size() != m_channels || image.size() != m_width * m_height)
+        {
+            throw std::invalid_argument(fmt::format("Topographic map takes {} values into {} pixels, got {} into {}",
+                                                    m_channels, m_width * m_height, values.size(), image.size()));
+        }
+
+        const size_t pixels = m_pixels.size();
+        const size_t chunks = (pixels + PIXEL_CHUNK - 1) / PIXEL_CHUNK;
+
+        std::fill(image.begin(), image.end(), 0.0f);
+
+        utils::parallel_for(chunks, [&](const size_t begin, const size_t end) {
+            alignas(64) float accumulator[PIXEL_CHUNK];
+
+            for (size_t chunk = begin; chunk < end; ++chunk)
+            {
+                const size_t first = chunk * PIXEL_CHUNK;
+                const size_t count = std::min(PIXEL_CHUNK, pixels - first);
+
+                std::fill_n(accumulator, count, 0.0f);
+
+                // image += value[j] * column j, one contiguous column slice per channel
+                for (size_t j = 0; j < m_channels; ++j)
+                {
+                    const float value = values[j];
+                    const float* column = m_weights.data() + j * pixels + first;
+
+                    for (size_t p = 0; p < count; ++p)
+                    {
+                        accumulator[p] += value * column[p];
+                    }
+                }
+
+                for (size_t p = 0; p < count; ++p)
+                {
+                    image[m_pixels[first + p]] = accumulator[p];
+                }
+            }
+        }, 4);
+    }
+
+    std::vector<float> TopographicMap::interpolate(const std::span<const float> values) const
+    {
+        std::vector<float> image(m_width * m_height);
+        interpolate(values, image);
+        return image;
+    }
+} // namespace brainviz::analysis
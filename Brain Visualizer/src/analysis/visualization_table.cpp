@@ -0,0 +1,64 @@
+#include <algorithm>
+
+#include <utils/parallel.hpp>
+#include <analysis/frequency_analyzer.hpp>
+#include <analysis/visualization_table.hpp>
+
+namespace brainviz::analysis
+{
+    namespace
+    {
+        size_t max_frame_count(const FrequencyAnalyzer& analyzer)
+        {
+            size_t frames = 0;
+            for (ChannelHandle channel = 0; channel < analyzer.get_channel_count(); ++channel)
+            {
+                frames = std::max(frames, analyzer.get_frame_count(channel));
+            }
+
+            return frames;
+        }
+    }
+
+    VisualizationTable::VisualizationTable(const FrequencyAnalyzer& analyzer)
+        : VisualizationTable(analyzer, 0, max_frame_count(analyzer))
+    {
+    }
+
+    VisualizationTable::VisualizationTable(
+        const FrequencyAnalyzer& analyzer,
+        const size_t first_frame,
+        const size_t frame_count)
+        : m_first_frame(first_frame),
+          m_frame_count(frame_count),
+          m_channel_count(analyzer.get_channel_count()),
+          m_band_count(analyzer.get_band_count())
+    {
+        m_radii.resize(m_frame_count * m_channel_count * m_band_count);
+        m_alphas.resize(m_frame_count * m_channel_count * m_band_count);
+        m_artifacts.resize(m_frame_count * m_channel_count);
+
+        // frames are independent, each worker fills a contiguous run of them
+        utils::parallel_for(m_frame_count, [&](const size_t begin, const size_t end) {
+            std::vector<FrequencyAnalyzer::VisualizationInfo> info(m_band_count);
+
+            for (size_t frame = m_first_frame + begin; frame < m_first_frame + end; ++frame)
+            {
+                for (ChannelHandle channel = 0; channel < m_channel_count; ++channel)
+                {
+                    analyzer.get_frame_visualization_info(channel, frame, info);
+                    const size_t base = offset(frame, channel);
+
+                    m_artifacts[(frame - m_first_frame) * m_channel_count + channel] =
+                        analyzer.is_artifact(channel, frame);
+
+                    for (size_t band = 0; band < m_band_count; ++band)
+                    {
+                        m_radii[base + band] = static_cast<float>(info[band].radius_multiplier);
+                        m_alphas[base + band] = static_cast<float>(info[band].transparency);
+                    }
+                }
+            }
+        }, 64);
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cmath>
+#include <span>
+
+#include <logging/logger.hpp>
+#include <utils/parallel.hpp>
+#include <analysis/wavelet_analyzer.hpp>
+
+namespace brainviz::analysis
+{
+    WaveletAnalyzer::WaveletAnalyzer(
+        const data::EEGData& eeg_data,
+        const size_t window_size,
+        const double overlap_percentage,
+        const CwtOptions options)
+        : FrequencyAnalyzer(eeg_data.m_samplingRate, window_size, overlap_percentage),
+          m_eeg_data(eeg_data),
+          m_cwt(eeg_data.m_samplingRate, options)
+    {
+        g_logger.info("Initialized wavelet analyzer with {} scales from {:.2f} to {:.2f} Hz",
+                      m_cwt.get_scale_count(), m_cwt.get_frequencies().front(), m_cwt.get_frequencies().back());
+    }
+
+    void WaveletAnalyzer::process_all_channels()
+    {
+        process_channels(m_eeg_data.get_channel_names());
+    }
+
+    void WaveletAnalyzer::process_channel(const std::string_view channel_name)
+    {
+        process_channels({std::string(channel_name)});
+    }
+
+    std::vector<std::vector<size_t> > WaveletAnalyzer::get_scale_bands() const
+    {
+        std::vector<std::vector<size_t> > scale_bands(m_cwt.get_scale_count());
+
+        for (size_t scale = 0; scale < scale_bands.size(); ++scale)
+        {
+            const double frequency = m_cwt.get_frequencies()[scale];
+
+            for (size_t band = 0; band < m_bands.size(); ++band)
+            {
+                if (frequency >= m_bands[band].min_freq && frequency < m_bands[band].max_freq)
+                {
+                    scale_bands[scale].push_back(band);
+                }
+            }
+        }
+
+        return scale_bands;
+    }
+
+    void WaveletAnalyzer::process_channels(const std::vector<std::string>& channel_names)
+    {
+        m_visualization_table = {};
+
+        const size_t band_count = get_band_count();
+        const size_t scale_count = m_cwt.get_scale_count();
+        const auto scale_bands = get_scale_bands();
+
+        const double variance_scale = variance_to_band_power();
+
+        std::vector<const std::vector<double>*> raw_data;
+        std::vector<ChannelHandle> channels;
+        size_t max_frames = 0;
+
+        for (const auto& channel_name : channel_names)
+        {
+            raw_data.push_back(&m_eeg_data.get_channel(channel_name));
+
+            max_frames = std::max(max_frames, frame_count(raw_data.back()->size()));
+
+            channels.push_back(add_channel_results(channel_name));
+        }
+
+        m_results.reserve_frames(max_frames);
+        for (size_t i = 0; i < channels.size(); ++i)
+        {
+            m_results.resize_frames(channels[i], frame_count(raw_data[i]->size()));
+        }
+
+        const size_t workers = utils::worker_count();
+
+        // channels are taken a group at a time so only a group's spectra are in memory; when a group has fewer
+        // channels than workers each channel's scales are split into interleaved parts that run in parallel
+        for (size_t group_start = 0; group_start < channels.size(); group_start += workers)
+        {
+            const size_t group_size = std::min(workers, channels.size() - group_start);
+            const size_t parts = std::max<size_t>(1, std::min(scale_count, workers / group_size));
+
+            std::vector<kfr::univector<kfr::complex<double> > > spectra(group_size);
+
+            utils::parallel_for(group_size, [&](const size_t begin, const size_t end) {
+                MorletCwt::Workspace workspace;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    m_cwt.transform_signal(*raw_data[group_start + i], spectra[i], workspace);
+                }
+            });
+
+            // [item][band][frame], item = channel * parts + part
+            std::vector<std::vector<double> > accumulators(group_size * parts);
+
+            utils::parallel_for(group_size * parts, [&](const size_t begin, const size_t end) {
+                MorletCwt::Workspace workspace;
+                std::vector<double> power;
+
+                for (size_t item = begin; item < end; ++item)
+                {
+                    const size_t i = item / parts;
+                    const size_t part = item % parts;
+                    const ChannelHandle channel = channels[group_start + i];
+                    const size_t frames = m_results.get_frame_count(channel);
+
+                    auto& accumulator = accumulators[item];
+                    accumulator.assign(band_count * frames, 0.0);
+                    power.resize(frames);
+
+                    // interleaved so every part gets a mix of cheap low and expensive high scales
+                    for (size_t scale = part; scale < scale_count; scale += parts)
+                    {
+                        if (scale_bands[scale].empty())
+                            continue;
+
+                        m_cwt.frame_power(spectra[i], scale, raw_data[group_start + i]->size(),
+                                          m_window_size, m_hop_size, power, workspace);
+
+                        const double weight = m_cwt.get_variance_weight(scale);
+
+                        for (const size_t band : scale_bands[scale])
+                        {
+                            double* band_power = accumulator.data() + band * frames;
+                            for (size_t frame = 0; frame < frames; ++frame)
+                            {
+                                band_power[frame] += weight * power[frame];
+                            }
+                        }
+                    }
+                }
+            });
+
+            for (size_t i = 0; i < group_size; ++i)
+            {
+                const ChannelHandle channel = channels[group_start + i];
+                const size_t frames = m_results.get_frame_count(channel);
+
+                for (size_t frame = 0; frame < frames; ++frame)
+                {
+                    const auto amplitudes = m_results.frame(channel, frame);
+
+                    for (size_t band = 0; band < band_count; ++band)
+                    {
+                        double variance = 0.0;
+                        for (size_t part = 0; part < parts; ++part)
+                        {
+                            variance += accumulators[i * parts + part][band * frames + frame];
+                        }
+
+                        amplitudes[band] = std::sqrt(std::max(variance, 0.0) * variance_scale);
+                    }
+                }
+
+                detect_artifacts(channel, *raw_data[group_start + i], 0, frames);
+            }
+        }
+    }
+} // namespace brainviz::analysis
@@ -0,0 +1,55 @@
+#include <algorithm>
+
+#include <analysis/welch.hpp>
+
+namespace brainviz::analysis
+{
+    WelchEstimator::WelchEstimator(
+        const size_t window_size,
+        const size_t segment_size,
+        const double overlap_percentage,
+        const SpectralAveraging averaging)
+        : SpectralEstimator(window_size),
+          m_averaging(averaging)
+    {
+        m_segment_size = (segment_size == 0) ? window_size / 2 : segment_size;
+        m_segment_size = std::clamp<size_t>(m_segment_size, std::min<size_t>(4, window_size), window_size);
+
+        m_segment_hop = static_cast<size_t>(m_segment_size * (100.0 - overlap_percentage) / 100.0);
+        m_segment_hop = std::max<size_t>(m_segment_hop, 1);
+
+        m_segment_count = (window_size - m_segment_size) / m_segment_hop + 1;
+
+        m_window = periodic_hann(m_segment_size);
+
+        double energy = 0.0;
+        for (size_t i = 0; i < m_segment_size; ++i)
+        {
+            energy += m_window[i] * m_window[i];
+        }
+        m_scale = (energy > 0.0) ? m_reference_energy / energy : 1.0;
+
+        reserve_batch(m_segment_count);
+    }
+
+    const kfr::univector<double>& WelchEstimator::compute(const std::span<const double> frame)
+    {
+        std::fill_n(m_batch.begin(), m_segment_count * m_window_size, 0.0);
+
+        for (size_t segment = 0; segment < m_segment_count; ++segment)
+        {
+            const size_t start = segment * m_segment_hop;
+            double* row = m_batch.data() + segment * m_window_size;
+
+            for (size_t i = 0; i < m_segment_size && start + i < frame.size(); ++i)
+            {
+                row[i] = frame[start + i] * m_window[i];
+            }
+        }
+
+        transform_batch(m_segment_count);
+        average_batch(m_segment_count, m_averaging, {}, m_scale);
+
+        return m_power_spectrum;
+    }
+} // namespace brainviz::analysis
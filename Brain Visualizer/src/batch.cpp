@@ -0,0 +1,678 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <data/interface.hpp>
+#include <data/json_file_source.hpp>
+#include <analysis/batch_analyzer.hpp>
+#include <logging/logger.hpp>
+#include <utils/cli.hpp>
+#include <utils/parallel.hpp>
+
+// headless analysis of whole archives of recordings: no window, no SFML, no ImGui
+
+namespace fs = std::filesystem;
+using namespace std::string_view_literals;
+
+namespace
+{
+    enum class OutputFormat
+    {
+        Csv,
+        Binary
+    };
+
+    struct BatchOptions
+    {
+        std::vector<fs::path> inputs;
+        fs::path output = ".";
+        OutputFormat format = OutputFormat::Csv;
+
+        size_t window_size = 256;
+        double overlap = 75.0;
+
+        size_t jobs = 2; // recordings in flight
+        size_t memory_budget = size_t{4096} << 20; // bytes, see estimate_memory()
+
+        bool features = true;
+        bool peaks = false;
+    };
+
+    struct Recording
+    {
+        fs::path path;
+        fs::path relative; // output name, the path below the input directory it was found in
+        size_t size;
+    };
+
+    void print_usage()
+    {
+        fmt::print(
+            "usage: brainviz_batch [options] <file or directory>...\n"
+            "\n"
+            "Analyzes every .json recording given or found below the given directories and writes one band table\n"
+            "per recording, mirroring the directory layout below the output directory. Recordings that would write\n"
+            "the same table are refused before anything runs.\n"
+            "\n"
+            "  -o, --output <dir>        output directory (default: .)\n"
+            "  -f, --format <csv|binary> output format (default: csv)\n"
+            "  -w, --window <samples>    analysis window, rounded to a power of two (default: 256)\n"
+            "      --overlap <percent>   window overlap (default: 75)\n"
+            "  -j, --jobs <n>            recordings analyzed at once, they share the cores (default: 2)\n"
+            "  -m, --memory <MiB>        memory budget for the recordings in flight (default: 4096)\n"
+            "      --no-features         band amplitudes only, no Hjorth / entropy / ratio columns\n"
+            "      --peaks               add peak frequency and power columns for every band\n"
+            "  -h, --help                show this help\n");
+    }
+
+    // nullopt when only the help was asked for
+    std::optional<BatchOptions> parse_arguments(const std::span<char*> arguments)
+    {
+        BatchOptions options;
+
+        brainviz::utils::ArgumentReader reader(arguments);
+
+        while (reader.next())
+        {
+            const auto argument = reader.argument();
+
+            if (argument == "-h"sv || argument == "--help"sv)
+            {
+                print_usage();
+                return std::nullopt;
+            }
+
+            if (argument == "-o"sv || argument == "--output"sv)
+            {
+                options.output = reader.value();
+            }
+            else if (argument == "-f"sv || argument == "--format"sv)
+            {
+                const auto format = reader.value();
+                if (format == "csv"sv)
+                {
+                    options.format = OutputFormat::Csv;
+                }
+                else if (format == "binary"sv)
+                {
+                    options.format = OutputFormat::Binary;
+                }
+                else
+                {
+                    throw std::runtime_error(fmt::format("Unknown output format: {}", format));
+                }
+            }
+            else if (argument == "-w"sv || argument == "--window"sv)
+            {
+                options.window_size = reader.number<size_t>();
+            }
+            else if (argument == "--overlap"sv)
+            {
+                options.overlap = reader.number<double>();
+            }
+            else if (argument == "-j"sv || argument == "--jobs"sv)
+            {
+                options.jobs = std::max<size_t>(reader.number<size_t>(), 1);
+            }
+            else if (argument == "-m"sv || argument == "--memory"sv)
+            {
+                const auto mebibytes = reader.number<size_t>();
+                if (mebibytes > std::numeric_limits<size_t>::max() >> 20)
+                {
+                    throw std::runtime_error(fmt::format("Invalid value for {}: {} MiB does not fit in memory",
+                                                         argument, mebibytes));
+                }
+
+                options.memory_budget = mebibytes << 20;
+            }
+            else if (argument == "--no-features"sv)
+            {
+                options.features = false;
+            }
+            else if (argument == "--peaks"sv)
+            {
+                options.peaks = true;
+            }
+            else if (argument.starts_with('-'))
+            {
+                reader.unknown_option();
+            }
+            else
+            {
+                options.inputs.emplace_back(argument);
+            }
+        }
+
+        if (options.inputs.empty())
+        {
+            throw std::runtime_error("No input files or directories given");
+        }
+
+        if (options.window_size < 8 || !(options.overlap >= 0.0 && options.overlap < 100.0))
+        {
+            throw std::runtime_error(fmt::format(
+                "Invalid window {} / overlap {}%, need at least 8 samples and 0-100%", options.window_size,
+                options.overlap));
+        }
+
+        return options;
+    }
+
+    // every recording below the inputs, in a stable order
+    std::vector<Recording> collect_recordings(const std::vector<fs::path>& inputs)
+    {
+        std::vector<Recording> recordings;
+
+        for (const auto& input : inputs)
+        {
+            if (fs::is_regular_file(input))
+            {
+                recordings.push_back({input, input.filename(), fs::file_size(input)});
+                continue;
+            }
+
+            if (!fs::is_directory(input))
+            {
+                throw std::runtime_error(fmt::format("No such file or directory: {}", input.string()));
+            }
+
+            for (const auto& entry : fs::recursive_directory_iterator(input))
+            {
+                if (entry.is_regular_file() && entry.path().extension() == ".json")
+                {
+                    recordings.push_back({entry.path(), entry.path().lexically_relative(input), entry.file_size()});
+                }
+            }
+        }
+
+        std::ranges::sort(recordings, {}, &Recording::path);
+        const auto duplicates = std::ranges::unique(recordings, {}, &Recording::path);
+        recordings.erase(duplicates.begin(), duplicates.end());
+
+        return recordings;
+    }
+
+    // where a recording's table goes, its relative path below the output directory with the format's extension
+    fs::path output_path(const Recording& recording, const BatchOptions& options)
+    {
+        auto path = options.output / recording.relative;
+        path.replace_extension(options.format == OutputFormat::Csv ? ".csv" : ".bvb");
+
+        return path.lexically_normal();
+    }
+
+    // two recordings writing the same table, like a/x.json and b/x.json given as files, would overwrite each other
+    // from different jobs. refused before anything is analyzed
+    void check_output_collisions(const std::vector<Recording>& recordings, const BatchOptions& options)
+    {
+        std::vector<std::pair<fs::path, const Recording*> > outputs;
+        for (const auto& recording : recordings)
+        {
+            outputs.emplace_back(output_path(recording, options), &recording);
+        }
+
+        std::ranges::sort(outputs, {}, &std::pair<fs::path, const Recording*>::first);
+
+        for (size_t i = 1; i < outputs.size(); ++i)
+        {
+            if (outputs[i].first == outputs[i - 1].first)
+            {
+                throw std::runtime_error(fmt::format(
+                    "{} and {} would both be written to {}, analyze them in separate runs or output directories",
+                    outputs[i - 1].second->path.string(), outputs[i].second->path.string(),
+                    outputs[i].first.string()));
+            }
+        }
+    }
+
+    // peak memory of one recording in flight: the file and simdjson's copy of it while parsing, the samples as
+    // doubles (text numbers take about as many bytes) and the band tables. rough, errs on the high side
+    size_t estimate_memory(const Recording& recording)
+    {
+        return 3 * recording.size;
+    }
+
+    /**
+     * @brief Byte budget the recordings in flight share, so memory stays bounded however many jobs run
+     */
+    class MemoryBudget
+    {
+    public:
+        explicit MemoryBudget(const size_t limit)
+            : m_limit(limit)
+        {
+        }
+
+        // blocks until bytes fit next to what is in flight, a recording larger than the whole budget runs alone
+        void acquire(const size_t bytes)
+        {
+            std::unique_lock lock(m_mutex);
+            m_released.wait(lock, [&] {
+                return m_used == 0 || m_used + bytes <= m_limit;
+            });
+
+            m_used += bytes;
+        }
+
+        void release(const size_t bytes)
+        {
+            {
+                std::scoped_lock lock(m_mutex);
+                m_used -= bytes;
+            }
+
+            m_released.notify_all();
+        }
+
+    private:
+        size_t m_limit;
+        size_t m_used = 0;
+
+        std::mutex m_mutex;
+        std::condition_variable m_released;
+    };
+
+    /**
+     * @brief Throughput and ETA, one line per finished recording so it reads fine in a log file too
+     */
+    class Progress
+    {
+    public:
+        explicit Progress(const std::vector<Recording>& recordings)
+            : m_total_files(recordings.size()),
+              m_start(std::chrono::steady_clock::now())
+        {
+            for (const auto& recording : recordings)
+            {
+                m_total_bytes += recording.size;
+            }
+        }
+
+        void finish(const Recording& recording, const size_t samples, const std::string_view error = {})
+        {
+            std::scoped_lock lock(m_mutex);
+
+            ++m_done_files;
+            m_done_bytes += recording.size;
+            m_samples += samples;
+            m_failed += error.empty() ? 0 : 1;
+
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+            const double bytes_per_second = static_cast<double>(m_done_bytes) / std::max(elapsed, 1e-9);
+            const double remaining = static_cast<double>(m_total_bytes - m_done_bytes) / std::max(bytes_per_second, 1e-9);
+
+            const auto eta = static_cast<size_t>(remaining);
+
+            fmt::print(stderr, "[{}/{}] {:5.1f}%  {:7.2f} MB/s  {:7.2f} Msamples/s  ETA {:02}:{:02}:{:02}  {}{}\n",
+                       m_done_files, m_total_files,
+                       100.0 * static_cast<double>(m_done_bytes) / static_cast<double>(std::max<size_t>(m_total_bytes, 1)),
+                       bytes_per_second / 1e6, static_cast<double>(m_samples) / std::max(elapsed, 1e-9) / 1e6,
+                       eta / 3600, eta / 60 % 60, eta % 60, recording.relative.string(),
+                       error.empty() ? std::string() : fmt::format(" FAILED: {}", error));
+        }
+
+        [[nodiscard]] size_t get_failed() const
+        {
+            return m_failed;
+        }
+
+        void summary() const
+        {
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+
+            fmt::print(stderr, "{} recording(s), {} failed, {:.1f} MB and {} samples in {:.1f} s\n",
+                       m_total_files, m_failed, static_cast<double>(m_done_bytes) / 1e6, m_samples, elapsed);
+        }
+
+    private:
+        size_t m_total_files;
+        size_t m_total_bytes = 0;
+
+        size_t m_done_files = 0;
+        size_t m_done_bytes = 0;
+        size_t m_samples = 0;
+        size_t m_failed = 0;
+
+        std::chrono::steady_clock::time_point m_start;
+        std::mutex m_mutex;
+    };
+
+    std::vector<std::string> column_names(const brainviz::analysis::BatchAnalyzer& analyzer, const BatchOptions& options)
+    {
+        std::vector<std::string> columns;
+
+        for (const auto& band : analyzer.get_band_set())
+        {
+            columns.push_back(band.name);
+        }
+
+        if (options.features)
+        {
+            const auto& features = analyzer.get_feature_extractor().get_feature_names();
+            columns.insert(columns.end(), features.begin(), features.end());
+        }
+
+        if (options.peaks)
+        {
+            for (const auto& band : analyzer.get_band_set())
+            {
+                columns.push_back(band.name + "PeakHz");
+                columns.push_back(band.name + "PeakPower");
+            }
+        }
+
+        return columns;
+    }
+
+    // one output row, in column_names() order
+    void fill_row(
+        const brainviz::analysis::BatchAnalyzer& analyzer,
+        const brainviz::analysis::ChannelHandle channel,
+        const size_t frame,
+        const BatchOptions& options,
+        std::vector<double>& row)
+    {
+        row.clear();
+
+        const auto amplitudes = analyzer.get_frame(channel, frame);
+        row.insert(row.end(), amplitudes.begin(), amplitudes.end());
+
+        if (options.features)
+        {
+            const auto features = analyzer.get_features().frame(channel, frame);
+            row.insert(row.end(), features.begin(), features.end());
+        }
+
+        if (options.peaks)
+        {
+            for (size_t band = 0; band < analyzer.get_band_count(); ++band)
+            {
+                row.push_back(analyzer.get_peak_frequency(band, channel)[frame]);
+                row.push_back(analyzer.get_peak_power(band, channel)[frame]);
+            }
+        }
+    }
+
+    // a csv field as is, or quoted with its quotes doubled when it holds a separator, a quote or a line break
+    std::string csv_field(const std::string_view text)
+    {
+        if (text.find_first_of(",\"\r\n") == std::string_view::npos)
+        {
+            return std::string(text);
+        }
+
+        std::string quoted = "\"";
+        for (const char c : text)
+        {
+            quoted += c;
+            if (c == '"')
+            {
+                quoted += '"';
+            }
+        }
+        quoted += '"';
+
+        return quoted;
+    }
+
+    // channel,frame,time (window centre, seconds),columns...
+    void write_csv(
+        const fs::path& path,
+        const brainviz::analysis::BatchAnalyzer& analyzer,
+        const std::vector<std::string>& channel_names,
+        const BatchOptions& options)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            throw std::runtime_error(fmt::format("Failed to create {}", path.string()));
+        }
+
+        constexpr size_t flush_size = size_t{1} << 20;
+
+        fmt::memory_buffer buffer;
+        auto columns = column_names(analyzer, options);
+        std::ranges::transform(columns, columns.begin(), csv_field);
+        fmt::format_to(std::back_inserter(buffer), "channel,frame,time,{}\n", fmt::join(columns, ","));
+
+        std::vector<double> row;
+        const double sampling_rate = analyzer.get_sampling_rate();
+
+        for (const auto& channel_name : channel_names)
+        {
+            const auto channel = analyzer.get_channel_handle(channel_name);
+            const auto field = csv_field(channel_name);
+
+            for (size_t frame = 0; frame < analyzer.get_frame_count(channel); ++frame)
+            {
+                fill_row(analyzer, channel, frame, options, row);
+
+                const double time = static_cast<double>(frame * analyzer.get_hop_size() + analyzer.get_window_size() / 2) /
+                                    sampling_rate;
+
+                fmt::format_to(std::back_inserter(buffer), "{},{},{:.4f},{:.6g}\n", field, frame, time,
+                               fmt::join(row, ","));
+
+                if (buffer.size() >= flush_size)
+                {
+                    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                    buffer.clear();
+                }
+            }
+        }
+
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+        if (!file)
+        {
+            throw std::runtime_error(fmt::format("Failed to write {}", path.string()));
+        }
+    }
+
+    template <typename T>
+    void write_value(std::ofstream& file, const T value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void write_string(std::ofstream& file, const std::string_view text)
+    {
+        write_value(file, static_cast<std::uint16_t>(text.size()));
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+    // host byte order (little endian on every target we build):
+    //   "BVZB", u32 version
+    //   f64 sampling rate, u32 window size, u32 hop size
+    //   u32 column count, then every column name as u16 length + bytes
+    //   u32 channel count, then per channel: name as u16 length + bytes, u64 frame count, frames x columns f32
+    void write_binary(
+        const fs::path& path,
+        const brainviz::analysis::BatchAnalyzer& analyzer,
+        const std::vector<std::string>& channel_names,
+        const BatchOptions& options)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            throw std::runtime_error(fmt::format("Failed to create {}", path.string()));
+        }
+
+        constexpr std::uint32_t version = 1;
+        file.write("BVZB", 4);
+        write_value(file, version);
+
+        write_value(file, analyzer.get_sampling_rate());
+        write_value(file, static_cast<std::uint32_t>(analyzer.get_window_size()));
+        write_value(file, static_cast<std::uint32_t>(analyzer.get_hop_size()));
+
+        const auto columns = column_names(analyzer, options);
+        write_value(file, static_cast<std::uint32_t>(columns.size()));
+        for (const auto& column : columns)
+        {
+            write_string(file, column);
+        }
+
+        write_value(file, static_cast<std::uint32_t>(channel_names.size()));
+
+        std::vector<double> row;
+        std::vector<float> matrix;
+
+        for (const auto& channel_name : channel_names)
+        {
+            const auto channel = analyzer.get_channel_handle(channel_name);
+            const size_t frames = analyzer.get_frame_count(channel);
+
+            matrix.clear();
+            for (size_t frame = 0; frame < frames; ++frame)
+            {
+                fill_row(analyzer, channel, frame, options, row);
+                std::ranges::transform(row, std::back_inserter(matrix), [](const double value) {
+                    return static_cast<float>(value);
+                });
+            }
+
+            write_string(file, channel_name);
+            write_value(file, static_cast<std::uint64_t>(frames));
+            file.write(reinterpret_cast<const char*>(matrix.data()), static_cast<std::streamsize>(matrix.size() * sizeof(float)));
+        }
+
+        if (!file)
+        {
+            throw std::runtime_error(fmt::format("Failed to write {}", path.string()));
+        }
+    }
+
+    // load, analyze and write one recording, returns the samples analyzed
+    size_t analyze_recording(const Recording& recording, const BatchOptions& options)
+    {
+        brainviz::data::JSONFileSource source(recording.path.string());
+        const auto eeg_data = source.load_data();
+
+        brainviz::analysis::BatchAnalyzer analyzer(*eeg_data, options.window_size, options.overlap);
+        if (options.features)
+        {
+            analyzer.enable_feature_extraction();
+        }
+        if (options.peaks)
+        {
+            analyzer.enable_peak_tracking();
+        }
+
+        // channels are spread across this job's share of the cores, see run_batch
+        analyzer.process_all_channels();
+
+        auto channel_names = eeg_data->get_channel_names();
+        std::ranges::sort(channel_names);
+
+        const auto path = output_path(recording, options);
+        fs::create_directories(path.parent_path());
+
+        if (options.format == OutputFormat::Csv)
+        {
+            write_csv(path, analyzer, channel_names, options);
+        }
+        else
+        {
+            write_binary(path, analyzer, channel_names, options);
+        }
+
+        return eeg_data->get_sample_count() * channel_names.size();
+    }
+
+    // every recording on options.jobs workers, a failed recording is reported and skipped. returns the failures
+    size_t run_batch(const std::vector<Recording>& recordings, const BatchOptions& options)
+    {
+        MemoryBudget budget(options.memory_budget);
+        Progress progress(recordings);
+        std::atomic<size_t> next{0};
+
+        const size_t jobs = std::min(options.jobs, recordings.size());
+
+        // every job's analysis gets an equal share of the cores, jobs * cores threads would only fight each other
+        const size_t job_workers = std::max<size_t>(brainviz::utils::worker_count() / jobs, 1);
+
+        {
+            std::vector<std::jthread> workers;
+            for (size_t i = 0; i < jobs; ++i)
+            {
+                workers.emplace_back([&] {
+                    const brainviz::utils::ScopedWorkerLimit limit(job_workers);
+
+                    for (size_t index = next++; index < recordings.size(); index = next++)
+                    {
+                        const auto& recording = recordings[index];
+                        const size_t memory = estimate_memory(recording);
+
+                        budget.acquire(memory);
+
+                        try
+                        {
+                            progress.finish(recording, analyze_recording(recording, options));
+                        }
+                        catch (const std::exception& e)
+                        {
+                            progress.finish(recording, 0, e.what());
+                        }
+
+                        budget.release(memory);
+                    }
+                });
+            }
+        }
+
+        progress.summary();
+        return progress.get_failed();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    // the analyzers log every setup at info, per recording that is noise here
+    g_logger.set_level(LogLevel::Warn);
+    g_logger.add_sink(ConsoleSink(), "[{level}] {message}", LogLevel::Warn);
+
+    try
+    {
+        const auto options = parse_arguments(std::span(argv, static_cast<size_t>(argc)));
+        if (!options)
+        {
+            return 0;
+        }
+
+        const auto recordings = collect_recordings(options->inputs);
+        if (recordings.empty())
+        {
+            fmt::print(stderr, "No .json recordings found\n");
+            return 1;
+        }
+
+        check_output_collisions(recordings, *options);
+
+        fs::create_directories(options->output);
+
+        return run_batch(recordings, *options) == 0 ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        fmt::print(stderr, "Error: {}\nRun brainviz_batch --help for usage\n", e.what());
+        return 2;
+    }
+}
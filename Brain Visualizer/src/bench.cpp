@@ -0,0 +1,1152 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <simdjson.h>
+#include <SFML/Graphics.hpp>
+
+#include <data/interface.hpp>
+#include <data/json_file_source.hpp>
+#include <analysis/batch_analyzer.hpp>
+#include <analysis/connectivity.hpp>
+#include <analysis/filter_bank_analyzer.hpp>
+#include <analysis/lazy_analyzer.hpp>
+#include <analysis/multi_resolution_analyzer.hpp>
+#include <analysis/phase_amplitude_coupling.hpp>
+#include <analysis/statistics.hpp>
+#include <analysis/topographic_map.hpp>
+#include <analysis/wavelet_analyzer.hpp>
+#include <electrode/electrode_set.hpp>
+#include <logging/logger.hpp>
+#include <utils/cli.hpp>
+#include <ui/band_renderer.hpp>
+#include <ui/detail/electrode_state_manager.hpp>
+#include <ui/electrode_frame.hpp>
+#include <ui/electrode_renderer.hpp>
+
+// micro and macro benchmarks on synthetic recordings, results as json so runs can be diffed across commits
+
+namespace fs = std::filesystem;
+using namespace std::string_view_literals;
+
+namespace
+{
+    struct BenchOptions
+    {
+        fs::path output; // json results, stdout when empty
+        fs::path baseline; // earlier results to compare against
+        std::string label; // free text stored with the results, e.g. a commit hash
+        std::string filter; // only benchmarks whose id contains this
+
+        double min_time = 0.5; // seconds per benchmark
+        size_t min_samples = 10;
+        size_t max_samples = 1000;
+
+        double threshold = 5.0; // percent slowdown of the median that counts as a regression
+        double seconds = 300.0; // length of the synthetic recordings
+        bool render = true;
+    };
+
+    void print_usage()
+    {
+        fmt::print(
+            "usage: brainviz_bench [options]\n"
+            "\n"
+            "Times loading, analysis, electrode state and rendering on synthetic recordings and writes the results\n"
+            "with their statistics as json.\n"
+            "\n"
+            "  -o, --output <file>       json results (default: stdout)\n"
+            "      --label <text>        stored with the results, e.g. the commit hash\n"
+            "      --filter <text>       only run benchmarks whose id contains the text\n"
+            "      --min-time <seconds>  time spent sampling each benchmark (default: 0.5)\n"
+            "      --min-samples <n>     samples per benchmark at least (default: 10)\n"
+            "      --max-samples <n>     samples per benchmark at most (default: 1000)\n"
+            "      --seconds <seconds>   length of the synthetic recordings (default: 300)\n"
+            "      --compare <file>      compare medians against earlier results, exit 1 on a regression\n"
+            "                            (a benchmark over its target budget exits 1 too)\n"
+            "      --threshold <percent> slowdown that counts as a regression (default: 5)\n"
+            "      --no-render           skip the offscreen rendering benchmarks\n"
+            "  -h, --help                show this help\n");
+    }
+
+    // nullopt when only the help was asked for
+    std::optional<BenchOptions> parse_arguments(const std::span<char*> arguments)
+    {
+        BenchOptions options;
+
+        brainviz::utils::ArgumentReader reader(arguments);
+
+        while (reader.next())
+        {
+            const auto argument = reader.argument();
+
+            if (argument == "-h"sv || argument == "--help"sv)
+            {
+                print_usage();
+                return std::nullopt;
+            }
+
+            if (argument == "-o"sv || argument == "--output"sv)
+            {
+                options.output = reader.value();
+            }
+            else if (argument == "--label"sv)
+            {
+                options.label = reader.value();
+            }
+            else if (argument == "--filter"sv)
+            {
+                options.filter = reader.value();
+            }
+            else if (argument == "--min-time"sv)
+            {
+                options.min_time = reader.number<double>();
+            }
+            else if (argument == "--min-samples"sv)
+            {
+                options.min_samples = std::max<size_t>(reader.number<size_t>(), 1);
+            }
+            else if (argument == "--max-samples"sv)
+            {
+                options.max_samples = std::max<size_t>(reader.number<size_t>(), 1);
+            }
+            else if (argument == "--seconds"sv)
+            {
+                options.seconds = reader.number<double>();
+            }
+            else if (argument == "--compare"sv)
+            {
+                options.baseline = reader.value();
+            }
+            else if (argument == "--threshold"sv)
+            {
+                options.threshold = reader.number<double>();
+            }
+            else if (argument == "--no-render"sv)
+            {
+                options.render = false;
+            }
+            else
+            {
+                reader.unknown_option();
+            }
+        }
+
+        if (!(options.seconds >= 10.0))
+        {
+            throw std::runtime_error(fmt::format("Recordings of {} s are too short, need at least 10", options.seconds));
+        }
+
+        options.max_samples = std::max(options.max_samples, options.min_samples);
+        return options;
+    }
+
+    using Params = std::vector<std::pair<std::string_view, size_t> >;
+
+    struct Summary
+    {
+        double min, max, mean, stddev, median, mad, p95;
+    };
+
+    struct Result
+    {
+        std::string id; // name and params, what runs are matched by
+        std::string name;
+        Params params;
+
+        size_t operations = 1; // per sample, the stats are per operation
+        size_t samples = 0;
+        Summary stats{};
+
+        // work per operation, for throughput
+        double items = 0.0;
+        std::string_view item_unit;
+        double bytes = 0.0;
+
+        double budget = 0.0; // ns per operation the median must stay under, 0 is none
+
+        std::string skipped; // reason, empty when the benchmark ran
+    };
+
+    // linear interpolation between the closest ranks
+    double quantile(const std::span<const double> sorted, const double q)
+    {
+        const double position = q * static_cast<double>(sorted.size() - 1);
+        const auto lower = static_cast<size_t>(position);
+        const size_t upper = std::min(lower + 1, sorted.size() - 1);
+        return sorted[lower] + (position - static_cast<double>(lower)) * (sorted[upper] - sorted[lower]);
+    }
+
+    Summary summarize(std::vector<double> values)
+    {
+        brainviz::analysis::RunningStats moments;
+        moments.push(values);
+
+        std::ranges::sort(values);
+        const double median = quantile(values, 0.5);
+
+        // median absolute deviation, robust against the odd sample a context switch lands in
+        std::vector<double> deviations(values.size());
+        std::ranges::transform(values, deviations.begin(), [&](const double value) { return std::abs(value - median); });
+        std::ranges::sort(deviations);
+
+        return {
+            moments.get_min(), moments.get_max(), moments.get_mean(), moments.get_stddev(),
+            median, quantile(deviations, 0.5), quantile(values, 0.95)
+        };
+    }
+
+    std::string make_id(const std::string_view name, const Params& params)
+    {
+        std::string id(name);
+        for (const auto& [key, value] : params)
+        {
+            id += fmt::format("/{}={}", key, value);
+        }
+        return id;
+    }
+
+    class Suite
+    {
+    public:
+        explicit Suite(const BenchOptions& options)
+            : m_options(options)
+        {
+        }
+
+        [[nodiscard]] bool selected(const std::string_view name, const Params& params) const
+        {
+            return make_id(name, params).find(m_options.filter) != std::string::npos;
+        }
+
+        // times body, which does `operations` units of work per call: one warmup call, then samples until both
+        // min_time and min_samples are reached (or max_samples)
+        Result* run(const std::string_view name, const Params& params, const size_t operations,
+                    const std::function<void()>& body)
+        {
+            if (!selected(name, params))
+            {
+                return nullptr;
+            }
+
+            using clock = std::chrono::steady_clock;
+
+            body();
+
+            std::vector<double> samples;
+            const auto start = clock::now();
+
+            while (samples.size() < m_options.min_samples ||
+                   (samples.size() < m_options.max_samples &&
+                    std::chrono::duration<double>(clock::now() - start).count() < m_options.min_time))
+            {
+                const auto before = clock::now();
+                body();
+                const auto after = clock::now();
+
+                samples.push_back(std::chrono::duration<double, std::nano>(after - before).count() /
+                                  static_cast<double>(operations));
+            }
+
+            auto& result = m_results.emplace_back();
+            result.id = make_id(name, params);
+            result.name = name;
+            result.params = params;
+            result.operations = operations;
+            result.samples = samples.size();
+            result.stats = summarize(std::move(samples));
+
+            fmt::print(stderr, "{:<64} {:>14} ns  +- {:.1f}%  ({} samples)\n", result.id,
+                       fmt::format("{:.1f}", result.stats.median),
+                       100.0 * result.stats.mad / std::max(result.stats.median, 1e-9), result.samples);
+
+            return &result;
+        }
+
+        void skip(const std::string_view name, const Params& params, std::string reason)
+        {
+            if (!selected(name, params))
+            {
+                return;
+            }
+
+            auto& result = m_results.emplace_back();
+            result.id = make_id(name, params);
+            result.name = name;
+            result.params = params;
+            result.skipped = std::move(reason);
+
+            fmt::print(stderr, "{:<64} skipped: {}\n", result.id, result.skipped);
+        }
+
+        [[nodiscard]] const std::vector<Result>& get_results() const
+        {
+            return m_results;
+        }
+
+        [[nodiscard]] const BenchOptions& get_options() const
+        {
+            return m_options;
+        }
+
+    private:
+        const BenchOptions& m_options;
+        std::vector<Result> m_results;
+    };
+
+    // results the optimizer must not drop
+    volatile double g_sink = 0.0;
+
+    const Params STATE_PARAMS = {{"electrodes", 64}};
+    const Params RENDER_PARAMS = {{"electrodes", 64}, {"width", 1280}, {"height", 720}};
+
+    // ---- synthetic data ----
+
+    constexpr double SAMPLING_RATE = 128.0; // what JSONFileSource reports, so loaded and generated data match
+
+    // channels named after the electrodes of the 64 channel system, so the state manager finds all of them.
+    // a sine in every band with per channel phases over pink-ish noise, seeded so every run sees the same data
+    std::unique_ptr<brainviz::data::EEGData> make_recording(const size_t channels, const double seconds)
+    {
+        const brainviz::electrode::ElectrodeSet electrodes(brainviz::electrode::SystemType::System64);
+        const auto sample_count = static_cast<size_t>(seconds * SAMPLING_RATE);
+
+        constexpr std::array frequencies = {2.0, 6.0, 10.0, 20.0, 40.0};
+        constexpr std::array amplitudes = {30.0, 15.0, 20.0, 6.0, 2.0};
+
+        std::mt19937_64 generator(0x6272616976697a);
+        std::normal_distribution noise(0.0, 4.0);
+
+        auto recording = std::make_unique<brainviz::data::EEGData>();
+        recording->m_samplingRate = SAMPLING_RATE;
+
+        for (size_t channel = 0; channel < channels; ++channel)
+        {
+            const auto& electrode = electrodes.all()[channel % electrodes.size()];
+            const std::string name = channel < electrodes.size()
+                                         ? std::string(electrode.name())
+                                         : fmt::format("{}_{}", electrode.name(), channel / electrodes.size());
+
+            std::vector<double> samples(sample_count);
+            double drift = 0.0;
+
+            for (size_t i = 0; i < sample_count; ++i)
+            {
+                const double t = static_cast<double>(i) / SAMPLING_RATE;
+
+                double value = 0.0;
+                for (size_t band = 0; band < frequencies.size(); ++band)
+                {
+                    const double phase = 0.37 * static_cast<double>(channel * (band + 1));
+                    value += amplitudes[band] * std::sin(2.0 * std::numbers::pi * frequencies[band] * t + phase);
+                }
+
+                drift = 0.98 * drift + noise(generator);
+                samples[i] = value + drift;
+            }
+
+            recording->set_channel(name, std::move(samples));
+        }
+
+        return recording;
+    }
+
+    // removes the file when the benchmark is done with it
+    struct TempFile
+    {
+        fs::path path;
+
+        explicit TempFile(const std::string_view name)
+            : path(fs::temp_directory_path() / fmt::format("brainviz_bench_{:08x}_{}", std::random_device{}(), name))
+        {
+        }
+
+        ~TempFile()
+        {
+            std::error_code error;
+            fs::remove(path, error);
+        }
+
+        TempFile(const TempFile&) = delete;
+        TempFile& operator=(const TempFile&) = delete;
+    };
+
+    void write_json_recording(const brainviz::data::EEGData& recording, const fs::path& path)
+    {
+        std::ofstream stream(path, std::ios::binary);
+
+        stream << '{';
+        bool first_channel = true;
+
+        for (const auto& [name, samples] : recording.get_channels())
+        {
+            stream << (first_channel ? "" : ",") << fmt::format("\"{}\":[", name);
+            first_channel = false;
+
+            fmt::memory_buffer buffer;
+            for (size_t i = 0; i < samples.size(); ++i)
+            {
+                fmt::format_to(std::back_inserter(buffer), "{}{:.6f}", i == 0 ? "" : ",", samples[i]);
+            }
+
+            stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            stream << ']';
+        }
+
+        stream << '}';
+
+        if (!stream)
+        {
+            throw std::runtime_error(fmt::format("Failed to write {}", path.string()));
+        }
+    }
+
+    // there is no binary recording format yet, this is the floor any would have: channel name and raw doubles
+    // per channel, read straight into the channel vectors
+    void write_raw_recording(const brainviz::data::EEGData& recording, const fs::path& path)
+    {
+        std::ofstream stream(path, std::ios::binary);
+
+        const auto write = [&](const auto value) {
+            stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        };
+
+        write(static_cast<uint32_t>(recording.get_channels().size()));
+        write(static_cast<uint64_t>(recording.get_sample_count()));
+
+        for (const auto& [name, samples] : recording.get_channels())
+        {
+            write(static_cast<uint32_t>(name.size()));
+            stream.write(name.data(), static_cast<std::streamsize>(name.size()));
+            stream.write(reinterpret_cast<const char*>(samples.data()),
+                         static_cast<std::streamsize>(samples.size() * sizeof(double)));
+        }
+
+        if (!stream)
+        {
+            throw std::runtime_error(fmt::format("Failed to write {}", path.string()));
+        }
+    }
+
+    std::unique_ptr<brainviz::data::EEGData> read_raw_recording(const fs::path& path)
+    {
+        std::ifstream stream(path, std::ios::binary);
+
+        const auto read = [&]<typename T>(T& value) {
+            stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+        };
+
+        uint32_t channels = 0;
+        uint64_t sample_count = 0;
+        read(channels);
+        read(sample_count);
+
+        auto recording = std::make_unique<brainviz::data::EEGData>();
+        recording->m_samplingRate = SAMPLING_RATE;
+
+        for (uint32_t channel = 0; channel < channels && stream; ++channel)
+        {
+            uint32_t length = 0;
+            read(length);
+
+            std::string name(length, '\0');
+            stream.read(name.data(), length);
+
+            std::vector<double> samples(sample_count);
+            stream.read(reinterpret_cast<char*>(samples.data()),
+                        static_cast<std::streamsize>(sample_count * sizeof(double)));
+
+            recording->set_channel(name, std::move(samples));
+        }
+
+        if (!stream)
+        {
+            throw std::runtime_error(fmt::format("Truncated recording {}", path.string()));
+        }
+
+        return recording;
+    }
+
+    // ---- benchmarks ----
+
+    void bench_loading(Suite& suite)
+    {
+        for (const size_t channels : {8, 64})
+        {
+            const Params params = {{"channels", channels}, {"seconds", static_cast<size_t>(suite.get_options().seconds)}};
+            if (!suite.selected("load/json", params) && !suite.selected("load/binary", params))
+            {
+                continue;
+            }
+
+            const auto recording = make_recording(channels, suite.get_options().seconds);
+            const double samples = static_cast<double>(channels * recording->get_sample_count());
+
+            const TempFile json(fmt::format("{}.json", channels));
+            write_json_recording(*recording, json.path);
+
+            if (auto* result = suite.run("load/json", params, 1, [&] {
+                brainviz::data::JSONFileSource source(json.path.string());
+                g_sink = g_sink + static_cast<double>(source.load_data()->get_sample_count());
+            }))
+            {
+                result->items = samples;
+                result->item_unit = "samples";
+                result->bytes = static_cast<double>(fs::file_size(json.path));
+            }
+
+            const TempFile raw(fmt::format("{}.bin", channels));
+            write_raw_recording(*recording, raw.path);
+
+            if (auto* result = suite.run("load/binary", params, 1, [&] {
+                g_sink = g_sink + static_cast<double>(read_raw_recording(raw.path)->get_sample_count());
+            }))
+            {
+                result->items = samples;
+                result->item_unit = "samples";
+                result->bytes = static_cast<double>(fs::file_size(raw.path));
+            }
+        }
+    }
+
+    void bench_analysis(Suite& suite)
+    {
+        const auto seconds = static_cast<size_t>(suite.get_options().seconds);
+        const auto single = make_recording(1, suite.get_options().seconds);
+        const std::string channel = single->get_channel_names().front();
+        const auto samples = static_cast<double>(single->get_sample_count());
+
+        // one channel across window sizes, the per frame cost of the transform and band integration
+        for (const size_t window : {128, 256, 512, 1024})
+        {
+            const Params params = {{"window", window}, {"seconds", seconds}};
+            if (!suite.selected("analysis/process_channel", params))
+            {
+                continue;
+            }
+
+            brainviz::analysis::BatchAnalyzer analyzer(*single, window);
+
+            if (auto* result = suite.run("analysis/process_channel", params, 1, [&] {
+                analyzer.process_channel(channel);
+            }))
+            {
+                result->items = samples;
+                result->item_unit = "samples";
+            }
+        }
+
+        // the same with everything derived per frame on top
+        {
+            const Params params = {{"window", 256}, {"seconds", seconds}};
+            if (suite.selected("analysis/process_channel_derived", params))
+            {
+                brainviz::analysis::BatchAnalyzer analyzer(*single, 256);
+                analyzer.enable_peak_tracking({.fit_aperiodic = true});
+                analyzer.enable_feature_extraction();
+
+                if (auto* result = suite.run("analysis/process_channel_derived", params, 1, [&] {
+                    analyzer.process_channel(channel);
+                }))
+                {
+                    result->items = samples;
+                    result->item_unit = "samples";
+                }
+            }
+        }
+
+        // whole recordings, spread across the worker threads
+        for (const size_t channels : {8, 32, 64})
+        {
+            const Params params = {{"channels", channels}, {"window", 256}, {"seconds", seconds}};
+            if (!suite.selected("analysis/process_all_channels", params))
+            {
+                continue;
+            }
+
+            const auto recording = make_recording(channels, suite.get_options().seconds);
+            brainviz::analysis::BatchAnalyzer analyzer(*recording, 256);
+
+            if (auto* result = suite.run("analysis/process_all_channels", params, 1, [&] {
+                analyzer.process_all_channels();
+            }))
+            {
+                result->items = samples * static_cast<double>(channels);
+                result->item_unit = "samples";
+            }
+        }
+
+        // what the app pays when the playhead lands on a block that isnt analyzed: the block computed on the spot
+        // across every channel and its table baked. no prefetch or trailing blocks, so the background worker stays
+        // idle, and one cached block, so every jump misses
+        {
+            constexpr size_t BLOCK_FRAMES = 64;
+
+            const Params params = {{"channels", 64}, {"window", 128}, {"block_frames", BLOCK_FRAMES}};
+            if (suite.selected("analysis/lazy_miss", params))
+            {
+                const auto recording = make_recording(64, suite.get_options().seconds);
+                brainviz::analysis::LazyAnalyzer analyzer(
+                    *recording, 128, 75.0,
+                    {.block_frames = BLOCK_FRAMES, .prefetch_blocks = 0, .trailing_blocks = 0,
+                     .max_cached_blocks = 1});
+
+                const size_t blocks = analyzer.get_block_count();
+                size_t block = 0;
+
+                if (auto* result = suite.run("analysis/lazy_miss", params, 1, [&] {
+                    block = (block + blocks / 2 + 1) % blocks;
+                    analyzer.prepare_frame(block * BLOCK_FRAMES);
+                }))
+                {
+                    result->items = static_cast<double>(BLOCK_FRAMES * 64);
+                    result->item_unit = "frames";
+                }
+            }
+        }
+    }
+
+    // the other engines on the 64 channel recording the app targets, with the costs their designs promise as budgets
+    void bench_engines(Suite& suite)
+    {
+        const auto seconds = static_cast<size_t>(suite.get_options().seconds);
+        const Params params = {{"channels", 64}, {"window", 256}, {"seconds", seconds}};
+
+        std::unique_ptr<brainviz::data::EEGData> recording;
+        const auto get_recording = [&]() -> const brainviz::data::EEGData& {
+            if (!recording)
+            {
+                recording = make_recording(64, suite.get_options().seconds);
+            }
+            return *recording;
+        };
+
+        const auto samples = [&] {
+            return static_cast<double>(64 * get_recording().get_sample_count());
+        };
+
+        // a 64 channel hour in under a minute, scaled to the recording's length
+        if (suite.selected("engine/wavelet", params))
+        {
+            brainviz::analysis::WaveletAnalyzer analyzer(get_recording(), 256);
+
+            if (auto* result = suite.run("engine/wavelet", params, 1, [&] {
+                analyzer.process_all_channels();
+            }))
+            {
+                result->items = samples();
+                result->item_unit = "samples";
+                result->budget = 60e9 * suite.get_options().seconds / 3600.0;
+            }
+        }
+
+        if (suite.selected("engine/filter_bank", params))
+        {
+            brainviz::analysis::FilterBankAnalyzer analyzer(get_recording(), 256);
+
+            if (auto* result = suite.run("engine/filter_bank", params, 1, [&] {
+                analyzer.process_all_channels();
+            }))
+            {
+                result->items = samples();
+                result->item_unit = "samples";
+            }
+        }
+
+        // no more than the single window path, timed on the same recording just before
+        if (suite.selected("engine/multi_resolution", params))
+        {
+            brainviz::analysis::MultiResolutionAnalyzer analyzer(get_recording(), 256);
+
+            if (auto* result = suite.run("engine/multi_resolution", params, 1, [&] {
+                analyzer.process_all_channels();
+            }))
+            {
+                result->items = samples();
+                result->item_unit = "samples";
+
+                const auto single = make_id("analysis/process_all_channels", params);
+                for (const auto& other : suite.get_results())
+                {
+                    if (other.id == single && other.skipped.empty())
+                    {
+                        result->budget = other.stats.median;
+                    }
+                }
+            }
+        }
+
+        // every pair over a run of frames, on the frame grid of the app's 128 sample window
+        {
+            const Params pair_params = {{"channels", 64}, {"window", 128}, {"frames", 256}};
+            if (suite.selected("engine/connectivity", pair_params))
+            {
+                // the engine takes its channels and frame grid from a processed analyzer
+                brainviz::analysis::BatchAnalyzer analyzer(get_recording(), 128);
+                analyzer.process_all_channels();
+                brainviz::analysis::ConnectivityEngine engine(analyzer);
+
+                const size_t frames = std::min<size_t>(256, analyzer.get_max_frame_index() + 1);
+
+                if (auto* result = suite.run("engine/connectivity", pair_params, 1, [&] {
+                    engine.compute(0, frames);
+                }))
+                {
+                    result->items = static_cast<double>(frames);
+                    result->item_unit = "frames";
+                }
+            }
+        }
+
+        // the amplitude band stays below the synthetic recordings' 64 Hz nyquist
+        {
+            const Params pac_params = {{"channels", 64}, {"seconds", seconds}};
+            const brainviz::analysis::PacOptions options{.amplitude_min_freq = 30.0, .amplitude_max_freq = 55.0};
+
+            if (suite.selected("engine/pac", pac_params))
+            {
+                brainviz::analysis::PacEngine engine(get_recording(), options);
+
+                if (auto* result = suite.run("engine/pac", pac_params, 1, [&] {
+                    engine.process_all_channels();
+                }))
+                {
+                    result->items = samples();
+                    result->item_unit = "samples";
+                }
+            }
+
+            const Params grid_params = {{"channels", 1}, {"seconds", seconds}};
+            if (suite.selected("engine/pac_comodulogram", grid_params))
+            {
+                brainviz::analysis::PacEngine engine(get_recording(), options);
+                const std::string channel = get_recording().get_channel_names().front();
+
+                const brainviz::analysis::ComodulogramGrid grid{
+                    .phase_start = 2.0, .phase_stop = 10.0, .phase_step = 1.0, .phase_bandwidth = 2.0,
+                    .amplitude_start = 20.0, .amplitude_stop = 45.0, .amplitude_step = 5.0,
+                    .amplitude_bandwidth = 20.0};
+
+                if (auto* result = suite.run("engine/pac_comodulogram", grid_params, 1, [&] {
+                    g_sink = g_sink + engine.compute_comodulogram(channel, grid).at(0, 0);
+                }))
+                {
+                    result->items = static_cast<double>(get_recording().get_sample_count());
+                    result->item_unit = "samples";
+                }
+            }
+        }
+
+        // one frame of one band onto the scalp map, under 2 ms to keep up with 60 fps
+        {
+            const Params map_params = {{"channels", 64}, {"width", 256}, {"height", 256}};
+            if (suite.selected("engine/topography", map_params))
+            {
+                const brainviz::electrode::ElectrodeSet electrodes(brainviz::electrode::SystemType::System64);
+                const brainviz::analysis::TopographicMap map(electrodes.all(), 256, 256);
+
+                std::vector<float> values(map.get_channel_count());
+                for (size_t channel = 0; channel < values.size(); ++channel)
+                {
+                    values[channel] = static_cast<float>(std::sin(0.37 * static_cast<double>(channel)));
+                }
+
+                std::vector<float> image(256 * 256);
+
+                if (auto* result = suite.run("engine/topography", map_params, 1, [&] {
+                    map.interpolate(values, image);
+                    g_sink = g_sink + image[image.size() / 2];
+                }))
+                {
+                    result->items = 1.0;
+                    result->item_unit = "frames";
+                    result->budget = 2e6;
+                }
+            }
+        }
+    }
+
+    // the frame loop of the app without the window: state update, then electrodes, frame and band circles
+    struct Scene
+    {
+        std::unique_ptr<brainviz::data::EEGData> recording;
+        brainviz::electrode::ElectrodeSet electrodes{brainviz::electrode::SystemType::System64};
+        std::unique_ptr<brainviz::analysis::BatchAnalyzer> analyzer;
+        std::unique_ptr<ElectrodeStateManager> state;
+
+        // every frame analyzed and baked before anything is timed, so updates only read the visualization table.
+        // the app's lazy analyzer would have its background worker race the timings, its miss path is timed on
+        // its own in analysis/lazy_miss
+        explicit Scene(const double seconds)
+            : recording(make_recording(64, seconds)),
+              analyzer(std::make_unique<brainviz::analysis::BatchAnalyzer>(*recording, 128, 75.0))
+        {
+            analyzer->process_all_channels();
+            analyzer->build_visualization_table();
+            state = std::make_unique<ElectrodeStateManager>(electrodes, *analyzer);
+        }
+    };
+
+    void bench_state(Suite& suite, Scene& scene)
+    {
+        constexpr size_t UPDATES = 1000;
+
+        // 144 Hz with the default speed: mostly interpolation, a new analysis frame every 8th update
+        if (auto* result = suite.run("state/update", STATE_PARAMS, UPDATES, [&] {
+            for (size_t i = 0; i < UPDATES; ++i)
+            {
+                scene.state->update(1.0f / 144.0f, 1.0f);
+            }
+        }))
+        {
+            result->items = 1.0;
+            result->item_unit = "updates";
+        }
+
+        // a new analysis frame on every update
+        if (auto* result = suite.run("state/update_advance", STATE_PARAMS, UPDATES, [&] {
+            for (size_t i = 0; i < UPDATES; ++i)
+            {
+                scene.state->update(1.0f, 1.0f);
+            }
+        }))
+        {
+            result->items = 1.0;
+            result->item_unit = "updates";
+        }
+    }
+
+    void draw_scene(sf::RenderTexture& target, Scene& scene, std::vector<sf::Vector2f>& points)
+    {
+        const sf::Vector2u size = target.getSize();
+        const double head_radius = (size.y / 2.0) * 0.7;
+        const double circle_radius = head_radius * 1.2;
+
+        target.clear({20, 20, 30});
+
+        brainviz::visualization::draw_electrodes(target, scene.electrodes, points, head_radius, circle_radius, size);
+        brainviz::visualization::draw_frame(target, brainviz::electrode::SystemType::System64, points);
+
+        brainviz::visualization::draw_band_circles(target, *scene.state, points);
+
+        target.display();
+    }
+
+    void bench_rendering(Suite& suite, Scene& scene)
+    {
+        const Params& params = RENDER_PARAMS;
+
+        const auto skip = [&](const std::string_view reason) {
+            suite.skip("render/frame", params, std::string(reason));
+            suite.skip("render/frame_readback", params, std::string(reason));
+        };
+
+        if (!suite.get_options().render)
+        {
+            skip("disabled with --no-render");
+            return;
+        }
+
+        if (!suite.selected("render/frame", params) && !suite.selected("render/frame_readback", params))
+        {
+            return;
+        }
+
+        // needs an OpenGL context, which headless machines may not be able to give
+        sf::RenderTexture target;
+        if (!target.resize({1280, 720}))
+        {
+            skip("no offscreen render target available");
+            return;
+        }
+
+        std::vector<sf::Vector2f> points;
+
+        // submission only, the driver may still be drawing when the sample ends
+        if (auto* result = suite.run("render/frame", params, 1, [&] {
+            scene.state->update(1.0f / 144.0f, 1.0f);
+            draw_scene(target, scene, points);
+        }))
+        {
+            result->items = 1.0;
+            result->item_unit = "frames";
+        }
+
+        // reading the pixels back waits for the gpu, so this includes the drawing itself (and the copy)
+        if (auto* result = suite.run("render/frame_readback", params, 1, [&] {
+            scene.state->update(1.0f / 144.0f, 1.0f);
+            draw_scene(target, scene, points);
+            g_sink = g_sink + static_cast<double>(target.getTexture().copyToImage().getSize().x);
+        }))
+        {
+            result->items = 1.0;
+            result->item_unit = "frames";
+        }
+    }
+
+    // ---- output ----
+
+    std::string escape(const std::string_view text)
+    {
+        std::string escaped;
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                escaped += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    std::string to_json(const Suite& suite)
+    {
+        const auto& options = suite.get_options();
+
+        const std::time_t now = std::time(nullptr);
+        std::tm utc{};
+#ifdef _WIN32
+        gmtime_s(&utc, &now);
+#else
+        gmtime_r(&now, &utc);
+#endif
+        char timestamp[32];
+        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+#if defined(__clang__)
+        const std::string compiler = fmt::format("clang {}", __clang_version__);
+#elif defined(__GNUC__)
+        const std::string compiler = fmt::format("gcc {}", __VERSION__);
+#elif defined(_MSC_VER)
+        const std::string compiler = fmt::format("msvc {}", _MSC_FULL_VER);
+#else
+        const std::string compiler = "unknown";
+#endif
+
+#ifdef NDEBUG
+        constexpr bool optimized = true;
+#else
+        constexpr bool optimized = false;
+#endif
+
+        fmt::memory_buffer out;
+        const auto append = [&]<typename... Args>(fmt::format_string<Args...> format, Args&&... args) {
+            fmt::format_to(std::back_inserter(out), format, std::forward<Args>(args)...);
+        };
+
+        append("{{\n  \"schema\": 1,\n  \"label\": \"{}\",\n  \"timestamp\": \"{}\",\n", escape(options.label), timestamp);
+        append("  \"build\": {{\"compiler\": \"{}\", \"ndebug\": {}}},\n", escape(compiler), optimized);
+        append("  \"host\": {{\"threads\": {}}},\n", std::thread::hardware_concurrency());
+        append("  \"config\": {{\"min_time\": {}, \"min_samples\": {}, \"max_samples\": {}, \"seconds\": {}}},\n",
+               options.min_time, options.min_samples, options.max_samples, options.seconds);
+        append("  \"benchmarks\": [");
+
+        const auto& results = suite.get_results();
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const auto& result = results[i];
+
+            append("{}\n    {{\"id\": \"{}\", \"name\": \"{}\", \"params\": {{", i == 0 ? "" : ",", result.id, result.name);
+            for (size_t p = 0; p < result.params.size(); ++p)
+            {
+                append("{}\"{}\": {}", p == 0 ? "" : ", ", result.params[p].first, result.params[p].second);
+            }
+            append("}}");
+
+            if (!result.skipped.empty())
+            {
+                append(", \"skipped\": \"{}\"}}", escape(result.skipped));
+                continue;
+            }
+
+            const auto& stats = result.stats;
+            append(", \"unit\": \"ns\", \"operations\": {}, \"samples\": {},\n", result.operations, result.samples);
+            if (result.budget > 0.0)
+            {
+                append("     \"budget\": {:.3f},\n", result.budget);
+            }
+            append("     \"stats\": {{\"min\": {:.3f}, \"max\": {:.3f}, \"mean\": {:.3f}, \"stddev\": {:.3f}, "
+                   "\"median\": {:.3f}, \"mad\": {:.3f}, \"p95\": {:.3f}}}",
+                   stats.min, stats.max, stats.mean, stats.stddev, stats.median, stats.mad, stats.p95);
+
+            if (result.items > 0.0)
+            {
+                append(",\n     \"throughput\": {{\"{}_per_second\": {:.3f}", result.item_unit,
+                       result.items * 1e9 / stats.median);
+                if (result.bytes > 0.0)
+                {
+                    append(", \"bytes_per_second\": {:.3f}", result.bytes * 1e9 / stats.median);
+                }
+                append("}}");
+            }
+
+            append("}}");
+        }
+
+        append("\n  ]\n}}\n");
+        return fmt::to_string(out);
+    }
+
+    // medians against the budgets of the benchmarks that have one. returns the number over budget
+    size_t check_budgets(const Suite& suite)
+    {
+        size_t missed = 0;
+
+        for (const auto& result : suite.get_results())
+        {
+            if (!result.skipped.empty() || result.budget <= 0.0 || result.stats.median <= result.budget)
+            {
+                continue;
+            }
+
+            ++missed;
+            fmt::print(stderr, "{:<64} {:>14.1f} ns  OVER BUDGET of {:.1f} ns\n", result.id, result.stats.median,
+                       result.budget);
+        }
+
+        return missed;
+    }
+
+    // medians against an earlier run, matched by id. returns the number of regressions
+    size_t compare(const Suite& suite, const fs::path& baseline_path)
+    {
+        simdjson::dom::parser parser;
+        simdjson::dom::element root;
+
+        if (const auto error = parser.load(baseline_path.string()).get(root))
+        {
+            throw std::runtime_error(fmt::format("Failed to parse {}: {}", baseline_path.string(),
+                                                 simdjson::error_message(error)));
+        }
+
+        simdjson::dom::array baseline;
+        if (root["benchmarks"].get_array().get(baseline))
+        {
+            throw std::runtime_error(fmt::format("{} holds no benchmark results", baseline_path.string()));
+        }
+
+        const double limit = 1.0 + suite.get_options().threshold / 100.0;
+        size_t regressions = 0;
+
+        fmt::print(stderr, "\n{:<64} {:>12} {:>12} {:>9}\n", "compared to " + baseline_path.filename().string(),
+                   "before ns", "after ns", "change");
+
+        for (const auto& result : suite.get_results())
+        {
+            if (!result.skipped.empty())
+            {
+                continue;
+            }
+
+            for (const auto entry : baseline)
+            {
+                std::string_view id;
+                double before = 0.0;
+
+                if (entry["id"].get_string().get(id) || id != result.id ||
+                    entry["stats"]["median"].get_double().get(before) || before <= 0.0)
+                {
+                    continue;
+                }
+
+                const double ratio = result.stats.median / before;
+                const bool regressed = ratio > limit;
+                regressions += regressed ? 1 : 0;
+
+                fmt::print(stderr, "{:<64} {:>12.1f} {:>12.1f} {:>+8.1f}%{}\n", result.id, before,
+                           result.stats.median, (ratio - 1.0) * 100.0, regressed ? "  REGRESSION" : "");
+                break;
+            }
+        }
+
+        return regressions;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // the analyzers log every setup at info, that would end up between the timings
+    g_logger.set_level(LogLevel::Warn);
+    g_logger.add_sink(ConsoleSink(), "[{level}] {message}", LogLevel::Warn);
+
+    try
+    {
+        const auto options = parse_arguments(std::span(argv, static_cast<size_t>(argc)));
+        if (!options)
+        {
+            return 0;
+        }
+
+        Suite suite(*options);
+
+        bench_loading(suite);
+        bench_analysis(suite);
+        bench_engines(suite);
+
+        // the state manager subscribes to the band selector's events, one scene at a time
+        if (suite.selected("state/update", STATE_PARAMS) || suite.selected("state/update_advance", STATE_PARAMS) ||
+            suite.selected("render/frame", RENDER_PARAMS) || suite.selected("render/frame_readback", RENDER_PARAMS))
+        {
+            Scene scene(options->seconds);
+            bench_state(suite, scene);
+            bench_rendering(suite, scene);
+        }
+
+        const std::string json = to_json(suite);
+
+        if (options->output.empty())
+        {
+            fmt::print("{}", json);
+        }
+        else
+        {
+            std::ofstream stream(options->output, std::ios::binary);
+            stream << json;
+
+            if (!stream)
+            {
+                throw std::runtime_error(fmt::format("Failed to write {}", options->output.string()));
+            }
+        }
+
+        size_t failures = check_budgets(suite);
+        if (!options->baseline.empty())
+        {
+            failures += compare(suite, options->baseline);
+        }
+
+        return failures > 0 ? 1 : 0;
+    }
+    catch (const std::exception& e)
+    {
+        fmt::print(stderr, "Error: {}\nRun brainviz_bench --help for usage\n", e.what());
+        return 2;
+    }
+}
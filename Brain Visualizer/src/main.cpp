@@ -7,6 +7,7 @@
 #include <data/interface.hpp>
 #include <data/json_file_source.hpp>
 #include <analysis/batch_analyzer.hpp>
+#include <analysis/statistics.hpp>
 #include <logging/logger.hpp>
 
 // TODO: sightem add crash handler
@@ -144,31 +145,28 @@ int main()
             }
         }
 
+        // one pass over every channel, moments and percentiles together
+        brainviz::analysis::ChannelStatistics statistics;
+        statistics.add_samples(*eeg_data);
+
         if (!channel_names.empty())
         {
             const auto& first_channel = eeg_data->get_channel(channel_names[0]);
 
             if (!first_channel.empty())
             {
-                double sum = 0.0;
-                double min = first_channel[0];
-                double max = first_channel[0];
-
-                for (const auto& value : first_channel)
-                {
-                    sum += value;
-                    min = std::min(min, value);
-                    max = std::max(max, value);
-                }
-
-                double avg = sum / first_channel.size();
+                const auto& [moments, quantiles] = statistics.get_channel(channel_names[0]);
 
                 fmt::print("\nBasic Statistics for Channel {}:\n", channel_names[0]);
                 fmt::print("-----------------------------------\n");
-                fmt::print("  Min value: {}\n", min);
-                fmt::print("  Max value: {}\n", max);
-                fmt::print("  Average value: {}\n", avg);
-                fmt::print("  Value range: {}\n", max - min);
+                fmt::print("  Min value: {}\n", moments.get_min());
+                fmt::print("  Max value: {}\n", moments.get_max());
+                fmt::print("  Average value: {}\n", moments.get_mean());
+                fmt::print("  Standard deviation: {}\n", moments.get_stddev());
+                fmt::print("  RMS: {}\n", moments.get_rms());
+                fmt::print("  Median: {}\n", quantiles.quantile(0.5));
+                fmt::print("  1st - 99th percentile: {} - {}\n", quantiles.quantile(0.01), quantiles.quantile(0.99));
+                fmt::print("  Value range: {}\n", moments.get_max() - moments.get_min());
             }
         }
 
@@ -213,7 +211,7 @@ int main()
                     for (const auto& info : viz_info)
                     {
                         fmt::print("  {}: radius = {:.2f}, transparency = {:.2f}\n",
-                                   frequency_band_to_string(info.band),
+                                   analyzer.get_band_set()[info.band_index].name,
                                    info.radius_multiplier,
                                    info.transparency);
                     }
@@ -222,21 +220,14 @@ int main()
                 fmt::print("\nAverage amplitudes across all time points:\n");
                 fmt::print("----------------------------------------\n");
 
-                for (int band_idx = 0; band_idx < 5; ++band_idx)
-                {
-                    const auto band = static_cast<brainviz::data::FrequencyBand>(band_idx);
-                    const auto& amplitudes = analyzer.get_band_amplitude(band, channel_to_analyze);
+                statistics.add_bands(analyzer);
 
-                    // avg amplitude
-                    double sum = 0.0;
-                    for (const auto& amp : amplitudes)
-                    {
-                        sum += amp;
-                    }
-                    double avg_amplitude = sum / amplitudes.size();
+                for (size_t band_idx = 0; band_idx < analyzer.get_band_count(); ++band_idx)
+                {
+                    const auto& [moments, quantiles] = statistics.get_band(channel_to_analyze, band_idx);
 
-                    fmt::print("  {} band: average amplitude = {:.2f}\n",
-                               frequency_band_to_string(band), avg_amplitude);
+                    fmt::print("  {} band: average amplitude = {:.2f}, 95th percentile = {:.2f}\n",
+                               analyzer.get_band_set()[band_idx].name, moments.get_mean(), quantiles.quantile(0.95));
                 }
             }
             catch (const std::exception& e)
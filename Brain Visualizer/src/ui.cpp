@@ -1,17 +1,26 @@
 #include <imgui-SFML.h>
 #include <SFML/Graphics.hpp>
 #include <vector>
+#include <limits>
 #include <memory>
 #include <iostream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <unordered_set>
 
 #include <ui/electrode_visualization.hpp>
 #include <data/interface.hpp>
 #include <data/json_file_source.hpp>
-#include <analysis/batch_analyzer.hpp>
+#include <analysis/lazy_analyzer.hpp>
+#include <analysis/preprocessor.hpp>
 #include <electrode/electrode_set.hpp>
+#include <utils/min_max_pyramid.hpp>
 
 #include <ui/frequency_band_selector.hpp>
+#include <ui/band_renderer.hpp>
 #include <ui/detail/electrode_state_manager.hpp>
 
 #include <implot.h>
@@ -175,14 +184,7 @@ public:
         m_wasLeftMousePressed = sf::Mouse::isButtonPressed(sf::Mouse::Button::Left);
 
         // normal rendering
-        if (m_stateManager.is_single_band_mode())
-        {
-            render_single_band(window, electrodePoints);
-        }
-        else
-        {
-            render_all_bands(window, electrodePoints);
-        }
+        brainviz::visualization::draw_band_circles(window, m_stateManager, electrodePoints);
 
         //if (m_showDebugBoxes)
         //{
@@ -255,6 +257,13 @@ private:
     mutable tsl::robin_map<int, bool> m_showRawWaveform;
     mutable tsl::robin_map<int, size_t> m_rawDataWindowSizes;
 
+    // min/max pyramids of the raw channels, built on first view and extended as a channel grows
+    mutable tsl::robin_map<std::string, utils::MinMaxPyramid> m_rawPyramids;
+
+    // raw plot points, reused between frames
+    mutable std::vector<double> m_rawPlotTimes;
+    mutable std::vector<double> m_rawPlotAmplitudes;
+
     // implot availability sanity check
     void initialize_implot() const
     {
@@ -288,21 +297,7 @@ private:
 
     static sf::Color get_band_color(const data::FrequencyBand band)
     {
-        switch (band)
-        {
-            case data::FrequencyBand::Delta:
-                return {170, 223, 237};
-            case data::FrequencyBand::Theta:
-                return {207, 230, 184};
-            case data::FrequencyBand::Alpha:
-                return {251, 247, 186};
-            case data::FrequencyBand::Beta:
-                return {255, 214, 166};
-            case data::FrequencyBand::Gamma:
-                return {248, 172, 174};
-            default:
-                return {255, 255, 255};
-        }
+        return brainviz::visualization::get_band_color(band);
     }
 
     static ImVec4 get_imgui_color(const sf::Color& color, float alpha = 1.0f)
@@ -315,72 +310,6 @@ private:
         );
     }
 
-    void render_single_band(sf::RenderWindow& window, const std::vector<sf::Vector2f>& electrodePoints) const
-    {
-        const brainviz::data::FrequencyBand selectedBand = m_stateManager.get_selected_band();
-        const int bandIndex = static_cast<int>(selectedBand);
-        const auto& visualizationData = m_stateManager.get_visualization_data();
-
-        const sf::Color color = get_band_color(selectedBand);
-
-        static constexpr float baseRadius = 30.0f;
-
-        for (const auto& [id, data] : visualizationData)
-        {
-            if (id < 0 || id >= static_cast<int>(electrodePoints.size()))
-                continue;
-
-            const sf::Vector2f& position = electrodePoints[id];
-
-            float radius = baseRadius * data.radii[bandIndex];
-
-            sf::Color electrodeColor = color;
-            electrodeColor.a = static_cast<uint8_t>(255 * data.alphas[bandIndex]);
-
-            sf::CircleShape circle(radius);
-            circle.setOrigin({radius, radius});
-            circle.setPosition(position);
-            circle.setFillColor(electrodeColor);
-            window.draw(circle);
-        }
-    }
-
-    void render_all_bands(sf::RenderWindow& window, const std::vector<sf::Vector2f>& electrodePoints) const
-    {
-        const brainviz::data::FrequencyBand selectedBand = m_stateManager.get_selected_band();
-        const auto& visualizationData = m_stateManager.get_visualization_data();
-
-        for (const auto& [id, data] : visualizationData)
-        {
-            if (id < 0 || id >= static_cast<int>(electrodePoints.size()))
-                continue;
-
-            const sf::Vector2f& position = electrodePoints[id];
-
-            for (int i = 0; i < 5; ++i)
-            {
-                const auto band = static_cast<brainviz::data::FrequencyBand>(i);
-
-                const float baseRadius = 6.0f + i * 3.0f;
-                float radius = baseRadius * data.radii[i];
-
-                sf::Color color = get_band_color(band);
-                color.a = static_cast<uint8_t>(255 * data.alphas[i]);
-
-                if (band == selectedBand)
-                {
-                    color.a = 255;
-                }
-
-                sf::CircleShape circle(radius);
-                circle.setOrigin({radius, radius});
-                circle.setPosition(position);
-                circle.setFillColor(color);
-                window.draw(circle);
-            }
-        }
-    }
-
     // i mean realistically this shouldnt even be here
     std::array<double, 5> get_electrode_band_amplitudes(int electrodeId, const std::string& channelName) const
     {
@@ -390,16 +319,25 @@ private:
         {
             const auto& analyzer = m_stateManager.get_analyzer();
             const size_t frameIndex = m_stateManager.get_frame_index();
+            const auto channel = analyzer.get_channel_handle(channelName);
 
-            for (int i = 0; i < 5; i++)
+            // read by frame, a lazy analyzer only keeps the frames around the playhead
+            if (frameIndex >= analyzer.get_frame_count(channel))
             {
-                const auto band = static_cast<brainviz::data::FrequencyBand>(i);
-                const auto& bandData = analyzer.get_band_amplitude(band, channelName);
+                return result;
+            }
+
+            const auto frame = analyzer.get_frame(channel, frameIndex);
 
-                if (frameIndex < bandData.size())
+            for (int i = 0; i < 5; i++)
+            {
+                const auto bandIndex = analyzer.get_band_index(static_cast<brainviz::data::FrequencyBand>(i));
+                if (!bandIndex)
                 {
-                    result[i] = bandData[frameIndex];
+                    throw std::invalid_argument("Band set has no such band");
                 }
+
+                result[i] = frame[*bandIndex];
             }
         }
         catch (const std::exception& e)
@@ -604,21 +542,28 @@ private:
                         bool dataAvailable = false;
                         try
                         {
-                            const auto& band = static_cast<brainviz::data::FrequencyBand>(selectedBand);
-                            const auto& bandData = analyzer.get_band_amplitude(band, channelName);
+                            const auto band = static_cast<brainviz::data::FrequencyBand>(selectedBand);
+                            const auto channel = analyzer.get_channel_handle(channelName);
+                            const auto bandIndex = analyzer.get_band_index(band);
+                            if (!bandIndex)
+                            {
+                                throw std::invalid_argument("Band set has no such band");
+                            }
 
                             // show the last N frames to give context
-                            const size_t numFramesToShow = std::min<size_t>(100, bandData.size());
+                            const size_t frameCount = analyzer.get_frame_count(channel);
+                            const size_t numFramesToShow = std::min<size_t>(100, frameCount);
                             const size_t startFrame = (frameIndex >= numFramesToShow)
                                                           ? (frameIndex - numFramesToShow + 1)
                                                           : 0;
 
-                            // fill the vectors with actual data
-                            for (size_t i = startFrame; i <= frameIndex && i < bandData.size(); i++)
+                            // fill the vectors with actual data, read by frame since a lazy analyzer only keeps the
+                            // blocks around the playhead
+                            for (size_t i = startFrame; i <= frameIndex && i < frameCount; i++)
                             {
                                 double timeInSeconds = (static_cast<double>(i) * hopSize) / samplingRate;
                                 times.push_back(timeInSeconds);
-                                amplitudes.push_back(bandData[i]);
+                                amplitudes.push_back(analyzer.get_frame(channel, i)[*bandIndex]);
                             }
 
                             dataAvailable = !times.empty();
@@ -684,7 +629,18 @@ private:
                     ImGui::SetNextItemWidth(200);
                     size_t& rawWindowSize = m_rawDataWindowSizes[electrodeId];
                     int windowSizeInt = static_cast<int>(rawWindowSize);
-                    if (ImGui::SliderInt("Window Size (samples)", &windowSizeInt, 100, 5000))
+
+                    // the pyramid keeps any span cheap to draw, so zooming out goes up to the whole channel
+                    const auto& eegData = analyzer.get_eeg_data();
+                    size_t channelLength = 5000;
+                    if (eegData.has_channel(channelName))
+                    {
+                        channelLength = std::max(channelLength, eegData.get_channel(channelName).size());
+                    }
+
+                    if (ImGui::SliderInt("Window Size (samples)", &windowSizeInt, 100,
+                                         static_cast<int>(std::min<size_t>(channelLength, std::numeric_limits<int>::max())), "%d",
+                                         ImGuiSliderFlags_Logarithmic))
                     {
                         rawWindowSize = static_cast<size_t>(windowSizeInt);
                     }
@@ -715,21 +671,25 @@ private:
                         // std::string plotTitle = fmt::format("Raw EEG ({:.2} - {:.2} sec)", startTimeSec, endTimeSec);
                         // TODO: come up with a nice way of displaying the time range, if we update the srting in beginplot everything falls apart
 
+                        auto& pyramid = m_rawPyramids[channelName];
+                        pyramid.append(rawChannelData);
+
+                        // about two points per horizontal pixel at any zoom
+                        const auto plotColumns = static_cast<size_t>(std::max(1.0f, ImGui::GetContentRegionAvail().x));
+
                         if (ImPlot::BeginPlot("Raw EEG", ImVec2(-1, 250)))
                         {
                             ImPlot::SetupAxes("Time (s)", "Amplitude (μV)",
                                               ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit);
 
-                            std::vector<double> timeValues;
-                            std::vector<double> amplitudeValues;
+                            auto& timeValues = m_rawPlotTimes;
+                            auto& amplitudeValues = m_rawPlotAmplitudes;
 
-                            timeValues.reserve(endIdx - startIdx);
-                            amplitudeValues.reserve(endIdx - startIdx);
+                            pyramid.query(rawChannelData, startIdx, endIdx, plotColumns, timeValues, amplitudeValues);
 
-                            for (size_t i = startIdx; i < endIdx; ++i)
+                            for (double& time : timeValues)
                             {
-                                timeValues.push_back(i / samplingRate);
-                                amplitudeValues.push_back(rawChannelData[i]);
+                                time /= samplingRate;
                             }
 
                             ImPlot::SetNextLineStyle(ImVec4(1, 1, 1, 1), 1.0f);
@@ -831,8 +791,102 @@ private:
     }
 };
 
-int main()
+// preprocessing is off unless asked for on the command line, the recording is shown as it was loaded otherwise.
+// throws on an unknown option or a bad value
+std::optional<brainviz::analysis::PreprocessingOptions> parse_preprocessing(const std::span<char*> arguments)
 {
+    std::optional<brainviz::analysis::PreprocessingOptions> options;
+
+    for (size_t i = 1; i < arguments.size(); ++i)
+    {
+        const std::string_view argument = arguments[i];
+
+        const auto value = [&]() -> std::string {
+            if (i + 1 >= arguments.size())
+            {
+                throw std::runtime_error(fmt::format("Missing value for {}", argument));
+            }
+            return arguments[++i];
+        };
+
+        // every preprocessing option turns preprocessing on, with the defaults for the ones not given
+        if (!options)
+        {
+            options.emplace();
+        }
+
+        if (argument == "--preprocess")
+        {
+            continue;
+        }
+
+        if (argument == "--mains")
+        {
+            options->line_frequency = std::stod(value());
+        }
+        else if (argument == "--high-pass")
+        {
+            options->high_pass = std::stod(value());
+        }
+        else if (argument == "--reference")
+        {
+            const std::string reference = value();
+            if (reference == "none")
+                options->reference = brainviz::analysis::Reference::None;
+            else if (reference == "average")
+                options->reference = brainviz::analysis::Reference::CommonAverage;
+            else if (reference == "mastoids")
+                options->reference = brainviz::analysis::Reference::LinkedMastoids;
+            else
+                throw std::runtime_error(fmt::format("Unknown reference: {}", reference));
+        }
+        else
+        {
+            throw std::runtime_error(fmt::format("Unknown option: {}", argument));
+        }
+    }
+
+    return options;
+}
+
+// one line for the controls window
+std::string describe_preprocessing(const std::optional<brainviz::analysis::PreprocessingOptions>& options)
+{
+    if (!options)
+    {
+        return "Preprocessing: off (raw recording)";
+    }
+
+    const char* reference = "recording reference";
+    if (options->reference == brainviz::analysis::Reference::CommonAverage)
+        reference = "common average";
+    else if (options->reference == brainviz::analysis::Reference::LinkedMastoids)
+        reference = "linked mastoids";
+
+    return fmt::format("Preprocessing: {}, {}, {}",
+                       options->line_frequency > 0.0
+                           ? fmt::format("{:g} Hz notch (harmonics to x{})", options->line_frequency, options->line_harmonics)
+                           : std::string("no notch"),
+                       options->high_pass > 0.0 ? fmt::format("{:g} Hz high-pass", options->high_pass)
+                                                : std::string("no high-pass"),
+                       reference);
+}
+
+int main(int argc, char** argv)
+{
+    std::optional<brainviz::analysis::PreprocessingOptions> preprocessing;
+    try
+    {
+        preprocessing = parse_preprocessing(std::span(argv, static_cast<size_t>(argc)));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n"
+                  << "usage: BrainViz [--preprocess] [--mains <Hz, 0 off>] [--high-pass <Hz, 0 off>] "
+                     "[--reference none|average|mastoids]" << std::endl;
+        return 2;
+    }
+
     // Get desktop resolution and set aspect ratio
     const sf::VideoMode desktopMode = sf::VideoMode::getDesktopMode();
     const unsigned int screenWidth = desktopMode.size.x;
@@ -898,12 +952,20 @@ int main()
 
     std::cout << "JSON data loaded successfully" << std::endl;
 
-    std::cout << "Processing EEG data..." << std::endl;
-    brainviz::analysis::BatchAnalyzer analyzer(*eegData, 128, 75.0);
-    analyzer.process_all_channels();
-    std::cout << "Data processing complete" << std::endl;
+    std::cout << describe_preprocessing(preprocessing) << std::endl;
+    if (preprocessing)
+    {
+        brainviz::analysis::Preprocessor preprocessor(eegData->m_samplingRate, *preprocessing);
+        preprocessor.process(*eegData);
+    }
+
+    // frames are analyzed as playback reaches them, so startup doesnt grow with the recording
+    brainviz::analysis::LazyAnalyzer analyzer(*eegData, 128, 75.0);
+    std::cout << "Analyzing " << analyzer.get_max_frame_index() + 1 << " frames on demand during playback"
+              << std::endl;
 
     FrequencyBandSelector bandSelector;
+    bandSelector.set_preprocessing_info(describe_preprocessing(preprocessing));
 
     ElectrodeStateManager stateManager(electrodeSet, analyzer);
 
@@ -0,0 +1,112 @@
+// band_renderer.cpp
+#include <cstdint>
+
+#include <ui/band_renderer.hpp>
+#include <ui/detail/electrode_state_manager.hpp>
+
+namespace brainviz::visualization
+{
+    sf::Color get_band_color(const data::FrequencyBand band)
+    {
+        switch (band)
+        {
+            case data::FrequencyBand::Delta:
+                return {170, 223, 237};
+            case data::FrequencyBand::Theta:
+                return {207, 230, 184};
+            case data::FrequencyBand::Alpha:
+                return {251, 247, 186};
+            case data::FrequencyBand::Beta:
+                return {255, 214, 166};
+            case data::FrequencyBand::Gamma:
+                return {248, 172, 174};
+            default:
+                return {255, 255, 255};
+        }
+    }
+
+    namespace
+    {
+        void draw_single_band(
+            sf::RenderTarget& window,
+            const ElectrodeStateManager& stateManager,
+            const std::vector<sf::Vector2f>& points)
+        {
+            const data::FrequencyBand selectedBand = stateManager.get_selected_band();
+            const int bandIndex = static_cast<int>(selectedBand);
+
+            const sf::Color color = get_band_color(selectedBand);
+
+            static constexpr float baseRadius = 30.0f;
+
+            for (const auto& [id, data] : stateManager.get_visualization_data())
+            {
+                if (id < 0 || id >= static_cast<int>(points.size()))
+                    continue;
+
+                const float radius = baseRadius * data.radii[bandIndex];
+
+                sf::Color electrodeColor = color;
+                electrodeColor.a = static_cast<uint8_t>(255 * data.alphas[bandIndex]);
+
+                sf::CircleShape circle(radius);
+                circle.setOrigin({radius, radius});
+                circle.setPosition(points[id]);
+                circle.setFillColor(electrodeColor);
+                window.draw(circle);
+            }
+        }
+
+        void draw_all_bands(
+            sf::RenderTarget& window,
+            const ElectrodeStateManager& stateManager,
+            const std::vector<sf::Vector2f>& points)
+        {
+            const data::FrequencyBand selectedBand = stateManager.get_selected_band();
+
+            for (const auto& [id, data] : stateManager.get_visualization_data())
+            {
+                if (id < 0 || id >= static_cast<int>(points.size()))
+                    continue;
+
+                for (int i = 0; i < 5; ++i)
+                {
+                    const auto band = static_cast<data::FrequencyBand>(i);
+
+                    const float baseRadius = 6.0f + i * 3.0f;
+                    const float radius = baseRadius * data.radii[i];
+
+                    sf::Color color = get_band_color(band);
+                    color.a = static_cast<uint8_t>(255 * data.alphas[i]);
+
+                    if (band == selectedBand)
+                    {
+                        color.a = 255;
+                    }
+
+                    sf::CircleShape circle(radius);
+                    circle.setOrigin({radius, radius});
+                    circle.setPosition(points[id]);
+                    circle.setFillColor(color);
+                    window.draw(circle);
+                }
+            }
+        }
+    } // namespace
+
+    void draw_band_circles(
+        sf::RenderTarget& window,
+        const ElectrodeStateManager& stateManager,
+        const std::vector<sf::Vector2f>& points)
+    {
+        if (stateManager.is_single_band_mode())
+        {
+            draw_single_band(window, stateManager, points);
+        }
+        else
+        {
+            draw_all_bands(window, stateManager, points);
+        }
+    }
+
+} // namespace brainviz::visualization
@@ -1,11 +1,14 @@
+#include <algorithm>
+
 #include <ui/detail/electrode_state_manager.hpp>
 
 #include <electrode/electrode_set.hpp>
 #include <ui/frequency_band_selector.hpp>
 
-ElectrodeStateManager::ElectrodeStateManager(brainviz::electrode::ElectrodeSet& electrodeSet, brainviz::analysis::BatchAnalyzer& analyzer)
+ElectrodeStateManager::ElectrodeStateManager(brainviz::electrode::ElectrodeSet& electrodeSet, brainviz::analysis::FrequencyAnalyzer& analyzer)
     : m_electrodeSet(electrodeSet),
       m_analyzer(analyzer),
+      m_baseline(analyzer),
       m_windowSize(analyzer.get_window_size()),
       m_hopSize(analyzer.get_hop_size()),
       m_frameIndex(0),
@@ -20,6 +23,12 @@ ElectrodeStateManager::ElectrodeStateManager(brainviz::electrode::ElectrodeSet&
         handle_mode_changed(singleBandMode);
     });
 
+    BaselineNormalizationChangedEvent::subscribe([this](const bool useBaseline) {
+        handle_baseline_changed(useBaseline);
+    });
+
+    m_analyzer.prepare_frame(m_frameIndex);
+    m_baseline.update(m_analyzer.time_index_to_frame(m_timeIndex));
     update_electrode_states();
     update_visualization_data();
 }
@@ -28,6 +37,7 @@ ElectrodeStateManager::~ElectrodeStateManager()
 {
     FrequencyBandSelectedEvent::unsubscribe();
     VisualizationModeChangedEvent::unsubscribe();
+    BaselineNormalizationChangedEvent::unsubscribe();
 }
 
 void ElectrodeStateManager::update(const float deltaTime, const float animationSpeed)
@@ -46,9 +56,14 @@ void ElectrodeStateManager::update(const float deltaTime, const float animationS
 
 void ElectrodeStateManager::advance_frame()
 {
-    m_frameIndex = (m_frameIndex + 1) % m_analyzer.get_max_frame_index();
+    // a streaming analyzer may not have produced any frames yet
+    const size_t maxFrameIndex = m_analyzer.get_max_frame_index();
+    m_frameIndex = (maxFrameIndex > 0) ? (m_frameIndex + 1) % maxFrameIndex : 0;
     m_timeIndex = compute_time_index(m_frameIndex);
 
+    // a lazy analyzer analyzes the frame now and prefetches the ones after it
+    m_analyzer.prepare_frame(m_frameIndex);
+    m_baseline.update(m_analyzer.time_index_to_frame(m_timeIndex));
     update_electrode_states();
 
     m_interpolationProgress = 0.0f;
@@ -88,27 +103,93 @@ void ElectrodeStateManager::advance_frame()
 
 void ElectrodeStateManager::update_electrode_states()
 {
+    // with a baked table advancing a frame is a copy per electrode, no per band math or exceptions
+    const size_t frameIndex = m_analyzer.time_index_to_frame(m_timeIndex);
+    const auto* table = m_analyzer.find_visualization_table(frameIndex);
+
+    // the electrodes draw the five standard bands, other bands of the set are left to the plots
+    std::array<std::optional<size_t>, 5> bandIndices;
+    for (int i = 0; i < 5; ++i)
+    {
+        bandIndices[i] = m_analyzer.get_band_index(static_cast<brainviz::data::FrequencyBand>(i));
+    }
+
+    const auto copyStandardBands = [&](const auto& values, std::array<float, 5>& target) {
+        for (int i = 0; i < 5; ++i)
+        {
+            target[i] = bandIndices[i] ? static_cast<float>(values[*bandIndices[i]]) : 0.0f;
+        }
+    };
+
     for (const auto& electrode : m_electrodeSet)
     {
         const int id = electrode.id();
-        const auto name = electrode.name();
+
+        auto handleIt = m_channelHandles.find(id);
+        if (handleIt == m_channelHandles.end())
+        {
+            // a streaming analyzer may not have seen this channel yet, try again next frame
+            const auto channel = m_analyzer.find_channel(electrode.name());
+            if (!channel)
+            {
+                continue;
+            }
+
+            handleIt = m_channelHandles.emplace(id, *channel).first;
+        }
+
+        // artifact frames keep the last clean frame on screen instead of a blink or muscle burst
+        if (m_analyzer.is_artifact(handleIt->second, frameIndex))
+        {
+            auto& state = m_electrodeStates[id];
+            state.previous_radii = state.current_radii;
+            state.previous_alphas = state.current_alphas;
+
+            continue;
+        }
+
+        if (m_useBaseline && handleIt->second < m_baseline.get_channel_count())
+        {
+            auto& state = m_electrodeStates[id];
+
+            state.previous_radii = state.current_radii;
+            state.previous_alphas = state.current_alphas;
+            std::ranges::copy(m_baseline.radii(handleIt->second), state.current_radii.begin());
+            std::ranges::copy(m_baseline.alphas(handleIt->second), state.current_alphas.begin());
+
+            continue;
+        }
+
+        if (table && handleIt->second < table->get_channel_count())
+        {
+            auto& state = m_electrodeStates[id];
+
+            state.previous_radii = state.current_radii;
+            state.previous_alphas = state.current_alphas;
+            copyStandardBands(table->radii(frameIndex, handleIt->second), state.current_radii);
+            copyStandardBands(table->alphas(frameIndex, handleIt->second), state.current_alphas);
+
+            continue;
+        }
 
         try
         {
-            const auto visualizationInfo = m_analyzer.get_visualization_info(name, m_timeIndex);
+            const auto visualizationInfo = m_analyzer.get_visualization_info(handleIt->second, m_timeIndex);
 
             auto& [previous_radii,
                 current_radii,
                 previous_alphas,
                 current_alphas] = m_electrodeStates[id];
 
+            previous_radii = current_radii;
+            previous_alphas = current_alphas;
+
             for (int i = 0; i < 5; ++i)
             {
-                previous_radii[i] = current_radii[i];
-                current_radii[i] = static_cast<float>(visualizationInfo[i].radius_multiplier);
+                const auto* info = bandIndices[i] ? &visualizationInfo[*bandIndices[i]] : nullptr;
 
-                previous_alphas[i] = current_alphas[i];
-                current_alphas[i] = static_cast<float>(visualizationInfo[i].transparency);
+                current_radii[i] = info ? static_cast<float>(info->radius_multiplier) : 0.0f;
+                current_alphas[i] = info ? static_cast<float>(info->transparency) : 0.0f;
             }
         }
         catch (const std::exception& e)
@@ -53,7 +53,7 @@ namespace brainviz::visualization
     }
 
     void ElectrodeFrameManager::draw_frame(
-        sf::RenderWindow& window,
+        sf::RenderTarget& window,
         const electrode::SystemType system,
         const std::vector<sf::Vector2f>& points)
     {
@@ -96,7 +96,7 @@ namespace brainviz::visualization
 
     // optimized draw frame
     void draw_frame(
-        sf::RenderWindow& window,
+        sf::RenderTarget& window,
         const electrode::SystemType system,
         const std::vector<sf::Vector2f>& points
     )
@@ -24,7 +24,7 @@ namespace brainviz::visualization
     }
 
     void ElectrodeVisualizationManager::draw_electrodes(
-        sf::RenderWindow& window,
+        sf::RenderTarget& window,
         const electrode::ElectrodeSet& electrodeSet,
         std::vector<sf::Vector2f>& points,
         const double headRadius,
@@ -114,7 +114,7 @@ namespace brainviz::visualization
     }
 
     void draw_electrodes(
-        sf::RenderWindow& window,
+        sf::RenderTarget& window,
         const electrode::ElectrodeSet& electrodeSet,
         std::vector<sf::Vector2f>& points,
         const double headRadius,
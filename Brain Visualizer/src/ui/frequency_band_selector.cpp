@@ -43,9 +43,19 @@ void FrequencyBandSelector::render()
 		}
 	}
 
+	if (ImGui::Checkbox("Normalize against baseline (z-score)", &m_baselineNormalization))
+	{
+		BaselineNormalizationChangedEvent::post(m_baselineNormalization);
+	}
+
 	ImGui::SliderFloat("Animation Speed", &m_animationSpeed, 0.1f, 5.0f, "%.1fx");
 
 	ImGui::Text("Frame: %zu/%zu", m_currentFrame, m_maxFrames);
 
+	if (!m_preprocessingInfo.empty())
+	{
+		ImGui::TextDisabled("%s", m_preprocessingInfo.c_str());
+	}
+
 	ImGui::End();
 }
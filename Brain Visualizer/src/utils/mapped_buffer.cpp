@@ -0,0 +1,194 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fmt/format.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <utils/mapped_buffer.hpp>
+
+namespace brainviz::utils
+{
+#if defined(_WIN32)
+    MappedBuffer::MappedBuffer(const size_t size, const std::filesystem::path& backing_file)
+        : m_size(size),
+          m_backing_file(backing_file)
+    {
+        if (size == 0)
+        {
+            return;
+        }
+
+        HANDLE file = INVALID_HANDLE_VALUE;
+        if (!backing_file.empty())
+        {
+            // delete on close removes the scratch file together with the last handle
+            file = CreateFileW(backing_file.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error(fmt::format("Failed to create mapping file {}: error {}",
+                                                     backing_file.string(), GetLastError()));
+            }
+            m_file = file;
+        }
+
+        const auto size_high = static_cast<DWORD>(static_cast<unsigned long long>(size) >> 32);
+        const auto size_low = static_cast<DWORD>(size & 0xffffffffu);
+
+        m_mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, size_high, size_low, nullptr);
+        if (m_mapping == nullptr)
+        {
+            const auto error = GetLastError();
+            release();
+            throw std::runtime_error(fmt::format("Failed to map {} bytes: error {}", size, error));
+        }
+
+        m_data = static_cast<std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+        if (m_data == nullptr)
+        {
+            const auto error = GetLastError();
+            release();
+            throw std::runtime_error(fmt::format("Failed to map {} bytes: error {}", size, error));
+        }
+    }
+
+    void MappedBuffer::release() noexcept
+    {
+        if (m_data != nullptr)
+        {
+            UnmapViewOfFile(m_data);
+        }
+
+        if (m_mapping != nullptr)
+        {
+            CloseHandle(m_mapping);
+        }
+
+        if (m_file != nullptr)
+        {
+            CloseHandle(m_file);
+        }
+
+        m_data = nullptr;
+        m_mapping = nullptr;
+        m_file = nullptr;
+        m_size = 0;
+        m_backing_file.clear();
+    }
+#else
+    MappedBuffer::MappedBuffer(const size_t size, const std::filesystem::path& backing_file)
+        : m_size(size),
+          m_backing_file(backing_file)
+    {
+        if (size == 0)
+        {
+            return;
+        }
+
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+        if (!backing_file.empty())
+        {
+            m_fd = open(backing_file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+            if (m_fd < 0)
+            {
+                throw std::runtime_error(fmt::format("Failed to create mapping file {}: {}",
+                                                     backing_file.string(), std::strerror(errno)));
+            }
+
+            if (ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+            {
+                const int error = errno;
+                release();
+                throw std::runtime_error(fmt::format("Failed to size mapping file to {} bytes: {}",
+                                                     size, std::strerror(error)));
+            }
+
+            flags = MAP_SHARED;
+        }
+
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, m_fd, 0);
+        if (data == MAP_FAILED)
+        {
+            const int error = errno;
+            release();
+            throw std::runtime_error(fmt::format("Failed to map {} bytes: {}", size, std::strerror(error)));
+        }
+
+        m_data = static_cast<std::byte*>(data);
+    }
+
+    void MappedBuffer::release() noexcept
+    {
+        if (m_data != nullptr)
+        {
+            munmap(m_data, m_size);
+        }
+
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+
+            std::error_code ignored;
+            std::filesystem::remove(m_backing_file, ignored);
+        }
+
+        m_data = nullptr;
+        m_fd = -1;
+        m_size = 0;
+        m_backing_file.clear();
+    }
+#endif
+
+    MappedBuffer::~MappedBuffer()
+    {
+        release();
+    }
+
+    MappedBuffer::MappedBuffer(MappedBuffer&& other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr)),
+          m_size(std::exchange(other.m_size, 0)),
+          m_backing_file(std::move(other.m_backing_file)),
+#if defined(_WIN32)
+          m_file(std::exchange(other.m_file, nullptr)),
+          m_mapping(std::exchange(other.m_mapping, nullptr))
+#else
+          m_fd(std::exchange(other.m_fd, -1))
+#endif
+    {
+        other.m_backing_file.clear();
+    }
+
+    MappedBuffer& MappedBuffer::operator=(MappedBuffer&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+            m_backing_file = std::move(other.m_backing_file);
+            other.m_backing_file.clear();
+#if defined(_WIN32)
+            m_file = std::exchange(other.m_file, nullptr);
+            m_mapping = std::exchange(other.m_mapping, nullptr);
+#else
+            m_fd = std::exchange(other.m_fd, -1);
+#endif
+        }
+
+        return *this;
+    }
+} // namespace brainviz::utils
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <limits>
+
+#include <utils/min_max_pyramid.hpp>
+
+namespace brainviz::utils
+{
+    MinMaxPyramid::MinMaxPyramid(const std::span<const double> samples)
+    {
+        append(samples);
+    }
+
+    void MinMaxPyramid::append(const std::span<const double> samples)
+    {
+        if (samples.size() <= m_sample_count)
+        {
+            return;
+        }
+
+        const size_t previous_count = m_sample_count;
+        m_sample_count = samples.size();
+
+        // first bucket of the level below that changed, in that level's buckets (raw samples for level 0)
+        size_t changed = previous_count;
+
+        for (size_t l = 0;; ++l)
+        {
+            const size_t bucket_size = (l == 0) ? FACTOR : m_levels[l - 1].bucket_size * FACTOR;
+            const size_t bucket_count = (m_sample_count + bucket_size - 1) / bucket_size;
+
+            // a level of one bucket is as coarse as it gets
+            if (l > 0 && m_levels[l - 1].min.size() <= 1)
+            {
+                break;
+            }
+
+            if (l == m_levels.size())
+            {
+                m_levels.push_back({bucket_size, {}, {}});
+            }
+
+            auto& level = m_levels[l];
+            const size_t first_changed = changed / FACTOR;
+
+            level.min.resize(bucket_count);
+            level.max.resize(bucket_count);
+
+            for (size_t b = first_changed; b < bucket_count; ++b)
+            {
+                float low = std::numeric_limits<float>::max();
+                float high = std::numeric_limits<float>::lowest();
+
+                if (l == 0)
+                {
+                    const size_t end = std::min(m_sample_count, (b + 1) * FACTOR);
+                    for (size_t i = b * FACTOR; i < end; ++i)
+                    {
+                        low = std::min(low, static_cast<float>(samples[i]));
+                        high = std::max(high, static_cast<float>(samples[i]));
+                    }
+                }
+                else
+                {
+                    const auto& below = m_levels[l - 1];
+                    const size_t end = std::min(below.min.size(), (b + 1) * FACTOR);
+                    for (size_t i = b * FACTOR; i < end; ++i)
+                    {
+                        low = std::min(low, below.min[i]);
+                        high = std::max(high, below.max[i]);
+                    }
+                }
+
+                level.min[b] = low;
+                level.max[b] = high;
+            }
+
+            changed = first_changed;
+        }
+    }
+
+    void MinMaxPyramid::query(
+        const std::span<const double> samples,
+        const size_t first,
+        size_t last,
+        const size_t columns,
+        std::vector<double>& x,
+        std::vector<double>& y) const
+    {
+        x.clear();
+        y.clear();
+
+        last = std::min({last, samples.size(), m_sample_count});
+        if (first >= last || columns == 0)
+        {
+            return;
+        }
+
+        const size_t count = last - first;
+        const double samples_per_column = static_cast<double>(count) / static_cast<double>(columns);
+
+        // the coarsest level with a bucket per column or finer
+        const Level* level = nullptr;
+        for (const auto& candidate : m_levels)
+        {
+            if (static_cast<double>(candidate.bucket_size) > samples_per_column)
+            {
+                break;
+            }
+            level = &candidate;
+        }
+
+        if (count <= 2 * columns || level == nullptr)
+        {
+            x.reserve(count);
+            y.reserve(count);
+
+            for (size_t i = first; i < last; ++i)
+            {
+                x.push_back(static_cast<double>(i));
+                y.push_back(samples[i]);
+            }
+            return;
+        }
+
+        x.reserve(2 * columns);
+        y.reserve(2 * columns);
+
+        const size_t bucket_size = level->bucket_size;
+        const size_t first_bucket = first / bucket_size;
+        const size_t last_bucket = std::min(level->min.size(), (last + bucket_size - 1) / bucket_size);
+        const double buckets_per_column = static_cast<double>(last_bucket - first_bucket) / static_cast<double>(columns);
+
+        for (size_t column = 0; column < columns; ++column)
+        {
+            const size_t begin = first_bucket + static_cast<size_t>(static_cast<double>(column) * buckets_per_column);
+            const size_t end = std::min(last_bucket, std::max(begin + 1, first_bucket +
+                                                              static_cast<size_t>(static_cast<double>(column + 1) *
+                                                                  buckets_per_column)));
+
+            float low = std::numeric_limits<float>::max();
+            float high = std::numeric_limits<float>::lowest();
+
+            for (size_t b = begin; b < end; ++b)
+            {
+                low = std::min(low, level->min[b]);
+                high = std::max(high, level->max[b]);
+            }
+
+            if (begin >= end)
+            {
+                continue;
+            }
+
+            // both at the column centre, the line then draws the column's full extent
+            const double position = 0.5 * static_cast<double>((begin + end) * bucket_size);
+            x.push_back(position);
+            y.push_back(low);
+            x.push_back(position);
+            y.push_back(high);
+        }
+    }
+} // namespace brainviz::utils